@@ -131,6 +131,10 @@ public class MainActivity extends Activity {
                 updateObjectDetection(!item.isChecked());
                 item.setChecked(!item.isChecked());
                 return true;
+            case R.id.menu_single_network:
+                updateSingleNetwork(!item.isChecked());
+                item.setChecked(!item.isChecked());
+                return true;
             case R.id.menu_zoom:
                 showZoomDialog();
                 return true;
@@ -139,6 +143,11 @@ public class MainActivity extends Activity {
     }
 
     private void updateCoreType(final int coreType) {
+        reloadModel(coreType, "Failed to update core type");
+        saveSettings("core", coreType);
+    }
+
+    private void reloadModel(final int coreType, final String errorMessage) {
         executor.execute(new Runnable() {
             @Override
             public void run() {
@@ -147,13 +156,12 @@ public class MainActivity extends Activity {
                     @Override
                     public void run() {
                         if (!result) {
-                            showErrorDialog("Failed to update core type");
+                            showErrorDialog(errorMessage);
                         }
                     }
                 });
             }
         });
-        saveSettings("core", coreType);
     }
 
     private void updateDrivableArea(boolean enable) {
@@ -171,6 +179,13 @@ public class MainActivity extends Activity {
         saveSettings("detection", enable);
     }
 
+    private void updateSingleNetwork(boolean enable) {
+        yolopv2ncnn.enableSingleNetwork(enable);
+        saveSettings("single_network", enable);
+        // YOLOPv2's detection heads are only loaded in single network mode
+        reloadModel(getCoreTypeFromSettings(), "Failed to reload model");
+    }
+
     private void setupCameraView() {
         cameraView.getHolder().setFormat(PixelFormat.RGBA_8888);
         cameraView.getHolder().addCallback(new SurfaceHolder.Callback() {
@@ -229,6 +244,11 @@ public class MainActivity extends Activity {
     }
 
     private void loadSettings() {
+        // before the first load, which picks the YOLOPv2 outputs from it
+        boolean isSingleNetwork = sharedPreferences.getBoolean("single_network", false);
+        yolopv2ncnn.enableSingleNetwork(isSingleNetwork);
+        popupMenu.getMenu().findItem(R.id.menu_single_network).setChecked(isSingleNetwork);
+
         int core = sharedPreferences.getInt("core", 0);
         updateCoreType(core);
 
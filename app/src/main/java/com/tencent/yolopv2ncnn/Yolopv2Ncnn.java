@@ -25,6 +25,7 @@ public class Yolopv2Ncnn {
     public native void enableDrivableArea(boolean enable);
     public native void enableLaneDetection(boolean enable);
     public native void enableObjectDetection(boolean enable);
+    public native void enableSingleNetwork(boolean enable);
     public native void setZoom(float zoom);
 //    public native void setOrientation(int orientation);
 
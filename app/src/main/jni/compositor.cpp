@@ -0,0 +1,273 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "compositor.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+SegOverlayStyle::SegOverlayStyle() {
+    const unsigned char c[3][3] = {{0, 0, 0}, {0, 255, 0}, {255, 0, 0}};
+    memcpy(colors, c, sizeof(colors));
+    alpha[SEG_NONE] = 0;
+    alpha[SEG_DRIVABLE_AREA] = 128;
+    alpha[SEG_LANE_LINE] = 255;
+}
+
+// (x + 127) / 255 取整, x <= 255 * 255
+static inline unsigned char div255(int x) {
+    x += 128;
+    return (unsigned char) ((x + (x >> 8)) >> 8);
+}
+
+// 一段显示像素按各自的标签混合颜色, dst = (dst * (255 - a) + color * a) / 255
+static void blend_row(unsigned char* dst, const unsigned char* labels, int n, int channels, const SegOverlayStyle& style) {
+    int i = 0;
+#if __ARM_NEON
+    // 标签超出查表范围时 vtbl 返回 0, 即不画
+    unsigned char lut[4][8] = {{0}};
+    for (int l = 0; l < 3; l++) {
+        lut[0][l] = style.colors[l][0];
+        lut[1][l] = style.colors[l][1];
+        lut[2][l] = style.colors[l][2];
+        lut[3][l] = style.alpha[l];
+    }
+    const uint8x8_t _lut0 = vld1_u8(lut[0]);
+    const uint8x8_t _lut1 = vld1_u8(lut[1]);
+    const uint8x8_t _lut2 = vld1_u8(lut[2]);
+    const uint8x8_t _luta = vld1_u8(lut[3]);
+    for (; i + 7 < n; i += 8) {
+        uint8x8_t _l = vld1_u8(labels + i);
+        uint8x8_t _a = vtbl1_u8(_luta, _l);
+        if (vget_lane_u64(vreinterpret_u64_u8(_a), 0) == 0)
+            continue;
+
+        uint8x8_t _ia = vmvn_u8(_a);
+        if (channels == 3) {
+            uint8x8x3_t _p = vld3_u8(dst + i * 3);
+            uint16x8_t _s0 = vmlal_u8(vmull_u8(_p.val[0], _ia), vtbl1_u8(_lut0, _l), _a);
+            uint16x8_t _s1 = vmlal_u8(vmull_u8(_p.val[1], _ia), vtbl1_u8(_lut1, _l), _a);
+            uint16x8_t _s2 = vmlal_u8(vmull_u8(_p.val[2], _ia), vtbl1_u8(_lut2, _l), _a);
+            _p.val[0] = vraddhn_u16(_s0, vrshrq_n_u16(_s0, 8));
+            _p.val[1] = vraddhn_u16(_s1, vrshrq_n_u16(_s1, 8));
+            _p.val[2] = vraddhn_u16(_s2, vrshrq_n_u16(_s2, 8));
+            vst3_u8(dst + i * 3, _p);
+        } else {
+            uint8x8x4_t _p = vld4_u8(dst + i * 4);
+            uint16x8_t _s0 = vmlal_u8(vmull_u8(_p.val[0], _ia), vtbl1_u8(_lut0, _l), _a);
+            uint16x8_t _s1 = vmlal_u8(vmull_u8(_p.val[1], _ia), vtbl1_u8(_lut1, _l), _a);
+            uint16x8_t _s2 = vmlal_u8(vmull_u8(_p.val[2], _ia), vtbl1_u8(_lut2, _l), _a);
+            _p.val[0] = vraddhn_u16(_s0, vrshrq_n_u16(_s0, 8));
+            _p.val[1] = vraddhn_u16(_s1, vrshrq_n_u16(_s1, 8));
+            _p.val[2] = vraddhn_u16(_s2, vrshrq_n_u16(_s2, 8));
+            vst4_u8(dst + i * 4, _p);
+        }
+    }
+#elif __SSE2__
+    // 没有字节查表, 每 16 个像素先把 alpha 和颜色展开成和像素一样的交错排列, 再逐字节混合
+    const __m128i _zero = _mm_setzero_si128();
+    const __m128i _255 = _mm_set1_epi16(255);
+    const __m128i _128 = _mm_set1_epi16(128);
+    for (; i + 15 < n; i += 16) {
+        __m128i _l = _mm_loadu_si128((const __m128i*) (labels + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_l, _zero)) == 0xffff && style.alpha[SEG_NONE] == 0)
+            continue;
+
+        unsigned char a[64];
+        unsigned char c[64];
+        for (int k = 0; k < 16; k++) {
+            const int l = labels[i + k] < 3 ? labels[i + k] : SEG_NONE;
+            const unsigned char al = labels[i + k] < 3 ? style.alpha[l] : 0;
+            for (int q = 0; q < channels; q++) {
+                a[k * channels + q] = q < 3 ? al : 0;
+                c[k * channels + q] = q < 3 ? style.colors[l][q] : 0;
+            }
+        }
+
+        unsigned char* p = dst + i * channels;
+        for (int j = 0; j < 16 * channels; j += 16) {
+            __m128i _p = _mm_loadu_si128((const __m128i*) (p + j));
+            __m128i _a = _mm_loadu_si128((const __m128i*) (a + j));
+            __m128i _c = _mm_loadu_si128((const __m128i*) (c + j));
+
+            __m128i _out[2];
+            for (int half = 0; half < 2; half++) {
+                __m128i _p16 = half == 0 ? _mm_unpacklo_epi8(_p, _zero) : _mm_unpackhi_epi8(_p, _zero);
+                __m128i _a16 = half == 0 ? _mm_unpacklo_epi8(_a, _zero) : _mm_unpackhi_epi8(_a, _zero);
+                __m128i _c16 = half == 0 ? _mm_unpacklo_epi8(_c, _zero) : _mm_unpackhi_epi8(_c, _zero);
+                __m128i _s = _mm_add_epi16(_mm_mullo_epi16(_p16, _mm_sub_epi16(_255, _a16)), _mm_mullo_epi16(_c16, _a16));
+                _s = _mm_add_epi16(_s, _128);
+                _out[half] = _mm_srli_epi16(_mm_add_epi16(_s, _mm_srli_epi16(_s, 8)), 8);
+            }
+            _mm_storeu_si128((__m128i*) (p + j), _mm_packus_epi16(_out[0], _out[1]));
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (labels[i] >= 3)
+            continue;
+
+        const int a = style.alpha[labels[i]];
+        if (a == 0)
+            continue;
+
+        const unsigned char* color = style.colors[labels[i]];
+        unsigned char* p = dst + i * channels;
+        p[0] = div255(p[0] * (255 - a) + color[0] * a);
+        p[1] = div255(p[1] * (255 - a) + color[1] * a);
+        p[2] = div255(p[2] * (255 - a) + color[2] * a);
+    }
+}
+
+void blend_seg_labels(unsigned char* pixels, int w, int h, int stride, int channels, const cv::Mat& labels,
+                      float x0, float kx, float y0, float ky, const SegOverlayStyle& style) {
+    const int mw = labels.cols;
+    const int mh = labels.rows;
+    if (mw == 0 || mh == 0 || kx <= 0.f || ky <= 0.f)
+        return;
+
+    // 每个显示列对应的标签列, 单调不减, 落在标签图内的是 [xb, xe)
+    std::vector<int> xofs(w);
+    int xb = w;
+    int xe = 0;
+    for (int x = 0; x < w; x++) {
+        int mx = (int) floorf((x + 0.5f) * kx + x0);
+        xofs[x] = std::min(std::max(mx, 0), mw - 1);
+        if (mx >= 0 && mx < mw) {
+            xb = std::min(xb, x);
+            xe = x + 1;
+        }
+    }
+    if (xb >= xe)
+        return;
+
+    // 放大时相邻的显示行落在同一标签行上, 映射好的一行标签和它的有效区间直接复用
+    std::vector<unsigned char> row(w);
+    int row_my = -1;
+    int span_b = 0;
+    int span_e = 0;
+
+    for (int y = 0; y < h; y++) {
+        int my = (int) floorf((y + 0.5f) * ky + y0);
+        if (my < 0 || my >= mh)
+            continue;
+
+        if (my != row_my) {
+            row_my = my;
+            span_b = span_e = 0;
+
+            // 标签行里第一个和最后一个非空标签, 例如地平线以上整行为空
+            const unsigned char* label_ptr = labels.ptr<unsigned char>(my);
+            int first = 0;
+            while (first < mw && label_ptr[first] == SEG_NONE)
+                first++;
+            if (first == mw)
+                continue;
+            int last = mw - 1;
+            while (label_ptr[last] == SEG_NONE)
+                last--;
+
+            span_b = (int) (std::lower_bound(xofs.begin() + xb, xofs.begin() + xe, first) - xofs.begin());
+            span_e = (int) (std::upper_bound(xofs.begin() + xb, xofs.begin() + xe, last) - xofs.begin());
+            for (int x = span_b; x < span_e; x++) {
+                row[x] = label_ptr[xofs[x]];
+            }
+        }
+
+        if (span_b >= span_e)
+            continue;
+
+        blend_row(pixels + (size_t) y * stride + span_b * channels, row.data() + span_b, span_e - span_b, channels, style);
+    }
+}
+
+void zoom_view(cv::Mat& rgb, float zoom) {
+    if (zoom <= 1.f) {
+        return;
+    }
+
+    const int img_w = rgb.cols;
+    const int img_h = rgb.rows;
+
+    // 先取中心 1/zoom 区域再直接缩放回原大小, 不生成 zoom 倍大的中间图
+    const int crop_w = std::max((int) (img_w / zoom), 1);
+    const int crop_h = std::max((int) (img_h / zoom), 1);
+    const cv::Rect crop((img_w - crop_w) / 2, (img_h - crop_h) / 2, crop_w, crop_h);
+
+    // 源和目标是同一块内存, 要经过一张原大小的临时图
+    cv::Mat zoomed;
+    cv::resize(rgb(crop), zoomed, rgb.size(), 0, 0, cv::INTER_LINEAR);
+    zoomed.copyTo(rgb);
+}
+
+void composite_result(cv::Mat& rgb, float zoom, const DetectionResult& result, TimingInfo* timing,
+                      const SegOverlayStyle& style) {
+    const int w = rgb.cols;
+    const int h = rgb.rows;
+
+    // 显示画面和结果画面都是同一个 roi 的中心放大, 之间只差一个以中心为原点的缩放
+    // 结果坐标 = (显示坐标 - 显示中心) * k + 结果中心
+    const float kx = result.zoom / zoom * result.img_w / w;
+    const float ky = result.zoom / zoom * result.img_h / h;
+
+    if (!result.seg_labels.empty()) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // 显示坐标到标签坐标
+        const float lkx = kx * result.mask_scale;
+        const float lky = ky * result.mask_scale;
+        const float lx0 = (result.img_w * 0.5f - w * 0.5f * kx) * result.mask_scale;
+        const float ly0 = (result.img_h * 0.5f - h * 0.5f * ky) * result.mask_scale;
+        blend_seg_labels(rgb.data, w, h, (int) rgb.step[0], rgb.channels(), result.seg_labels, lx0, lkx, ly0, lky, style);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        if (timing) {
+            timing->lane_area_draw = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+        }
+    }
+
+    if (result.enable_object_detection && !result.objects.empty()) {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // 检测框映射到显示坐标
+        std::vector<Object> objects = result.objects;
+        for (size_t i = 0; i < objects.size(); i++) {
+            cv::Rect_<float>& r = objects[i].rect;
+            r.x = (r.x - result.img_w * 0.5f) / kx + w * 0.5f;
+            r.y = (r.y - result.img_h * 0.5f) / ky + h * 0.5f;
+            r.width = r.width / kx;
+            r.height = r.height / ky;
+        }
+
+        Yolov8::draw(rgb, objects);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        if (timing) {
+            timing->object_drawing = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <opencv2/core/core.hpp>
+
+#include "yolopv2.h"
+
+// 显示时把最新的推理结果叠加到最新的相机画面上, 画面刷新不再受推理速度限制
+
+// 分割标签的颜色和不透明度, 下标为标签值, alpha 0 不画 ~ 255 直接覆盖
+struct SegOverlayStyle {
+    unsigned char colors[3][3];
+    unsigned char alpha[3];
+
+    // 可行驶区域半透明绿色, 车道线不透明红色
+    SegOverlayStyle();
+};
+
+// 以画面中心放大 zoom 倍, 大小不变, 只缩放中心 1/zoom 区域
+// 相机画面可以在转换时就只取中心区域, 见 NdkCameraWindow
+void zoom_view(cv::Mat& rgb, float zoom);
+
+// 按最近邻把标签图映射到 w x h 的 rgb (channels 3) 或 rgba (channels 4, a 不变) 像素上并混合颜色
+// 像素 (x, y) 取标签 (floor((x + 0.5) * kx + x0), floor((y + 0.5) * ky + y0))
+// 没有标签的行和行两端整段跳过
+void blend_seg_labels(unsigned char* pixels, int w, int h, int stride, int channels, const cv::Mat& labels,
+                      float x0, float kx, float y0, float ky, const SegOverlayStyle& style);
+
+// rgb 是转正并按 zoom 放大后的相机画面, rgb 或 rgba, 结果按各自的画面大小和 zoom 映射过来
+// timing 可选, 填 lane_area_draw 和 object_drawing
+void composite_result(cv::Mat& rgb, float zoom, const DetectionResult& result, TimingInfo* timing = 0,
+                      const SegOverlayStyle& style = SegOverlayStyle());
+
+#endif // COMPOSITOR_H
@@ -0,0 +1,525 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "detpost.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+static float fast_exp(float x)
+{
+    union {
+        uint32_t i;
+        float f;
+    } v{};
+    v.i = (1 << 23) * (1.4426950409 * x + 126.93490512f);
+    return v.f;
+}
+
+static float sigmoid(float x)
+{
+    return 1.0f / (1.0f + fast_exp(-x));
+}
+
+// for box geometry, where the few percent error of fast_exp would show
+static float sigmoid_exact(float x)
+{
+    return 1.0f / (1.0f + expf(-x));
+}
+
+// cephes exp, same polynomial as ncnn's neon/sse mathfun
+#if __ARM_NEON
+static inline float32x4_t exp_ps(float32x4_t x)
+{
+    x = vminq_f32(x, vdupq_n_f32(88.3762626647949f));
+    x = vmaxq_f32(x, vdupq_n_f32(-88.3762626647949f));
+
+    // exp(x) = exp(g + n * log(2))
+    float32x4_t fx = vmlaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(1.44269504088896341f));
+
+    // floor
+    float32x4_t tmp = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+    uint32x4_t mask = vcgtq_f32(tmp, fx);
+    mask = vandq_u32(mask, vreinterpretq_u32_f32(vdupq_n_f32(1.f)));
+    fx = vsubq_f32(tmp, vreinterpretq_f32_u32(mask));
+
+    x = vmlsq_f32(x, fx, vdupq_n_f32(0.693359375f));
+    x = vmlsq_f32(x, fx, vdupq_n_f32(-2.12194440e-4f));
+
+    float32x4_t y = vdupq_n_f32(1.9875691500E-4f);
+    y = vmlaq_f32(vdupq_n_f32(1.3981999507E-3f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(8.3334519073E-3f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(4.1665795894E-2f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(1.6666665459E-1f), y, x);
+    y = vmlaq_f32(vdupq_n_f32(5.0000001201E-1f), y, x);
+    y = vmlaq_f32(x, y, vmulq_f32(x, x));
+    y = vaddq_f32(y, vdupq_n_f32(1.f));
+
+    // 2^n
+    int32x4_t n = vcvtq_s32_f32(fx);
+    n = vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(0x7f)), 23);
+    return vmulq_f32(y, vreinterpretq_f32_s32(n));
+}
+
+static inline float reduce_max(float32x4_t v)
+{
+#if __aarch64__
+    return vmaxvq_f32(v);
+#else
+    float32x2_t m = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+    m = vpmax_f32(m, m);
+    return vget_lane_f32(m, 0);
+#endif
+}
+
+static inline float reduce_sum(float32x4_t v)
+{
+#if __aarch64__
+    return vaddvq_f32(v);
+#else
+    float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    s = vpadd_f32(s, s);
+    return vget_lane_f32(s, 0);
+#endif
+}
+#elif __SSE2__
+static inline __m128 exp_ps(__m128 x)
+{
+    x = _mm_min_ps(x, _mm_set1_ps(88.3762626647949f));
+    x = _mm_max_ps(x, _mm_set1_ps(-88.3762626647949f));
+
+    // exp(x) = exp(g + n * log(2))
+    __m128 fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)), _mm_set1_ps(0.5f));
+
+    // floor
+    __m128 tmp = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx));
+    __m128 mask = _mm_and_ps(_mm_cmpgt_ps(tmp, fx), _mm_set1_ps(1.f));
+    fx = _mm_sub_ps(tmp, mask);
+
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(0.693359375f)));
+    x = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(-2.12194440e-4f)));
+
+    __m128 y = _mm_set1_ps(1.9875691500E-4f);
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507E-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073E-3f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894E-2f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201E-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, _mm_mul_ps(x, x)), x);
+    y = _mm_add_ps(y, _mm_set1_ps(1.f));
+
+    // 2^n
+    __m128i n = _mm_cvttps_epi32(fx);
+    n = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(0x7f)), 23);
+    return _mm_mul_ps(y, _mm_castsi128_ps(n));
+}
+
+static inline float reduce_max(__m128 v)
+{
+    v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+
+static inline float reduce_sum(__m128 v)
+{
+    v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(v);
+}
+#endif
+
+static float max_value(const float* ptr, int n)
+{
+    float m = -FLT_MAX;
+    int i = 0;
+#if __ARM_NEON
+    float32x4_t _m0 = vdupq_n_f32(-FLT_MAX);
+    float32x4_t _m1 = vdupq_n_f32(-FLT_MAX);
+    for (; i + 7 < n; i += 8)
+    {
+        _m0 = vmaxq_f32(_m0, vld1q_f32(ptr + i));
+        _m1 = vmaxq_f32(_m1, vld1q_f32(ptr + i + 4));
+    }
+    for (; i + 3 < n; i += 4)
+    {
+        _m0 = vmaxq_f32(_m0, vld1q_f32(ptr + i));
+    }
+    m = reduce_max(vmaxq_f32(_m0, _m1));
+#elif __SSE2__
+    __m128 _m0 = _mm_set1_ps(-FLT_MAX);
+    __m128 _m1 = _mm_set1_ps(-FLT_MAX);
+    for (; i + 7 < n; i += 8)
+    {
+        _m0 = _mm_max_ps(_m0, _mm_loadu_ps(ptr + i));
+        _m1 = _mm_max_ps(_m1, _mm_loadu_ps(ptr + i + 4));
+    }
+    for (; i + 3 < n; i += 4)
+    {
+        _m0 = _mm_max_ps(_m0, _mm_loadu_ps(ptr + i));
+    }
+    m = reduce_max(_mm_max_ps(_m0, _m1));
+#endif
+    for (; i < n; i++)
+    {
+        m = std::max(m, ptr[i]);
+    }
+    return m;
+}
+
+// first label whose score equals the max, num_class when none does
+static int first_label_of(const float* scores, int num_class, float score)
+{
+    int label = 0;
+    while (label < num_class && scores[label] != score)
+        label++;
+    return label;
+}
+
+// sum(l * softmax(x)[l]) over the bins of one box side
+static float dfl_expectation(const float* ptr, int reg_max)
+{
+    const float m = max_value(ptr, reg_max);
+
+    float sum = 0.f;
+    float wsum = 0.f;
+    int l = 0;
+#if __ARM_NEON
+    float32x4_t _m = vdupq_n_f32(m);
+    float32x4_t _sum = vdupq_n_f32(0.f);
+    float32x4_t _wsum = vdupq_n_f32(0.f);
+    const float idx[4] = {0.f, 1.f, 2.f, 3.f};
+    float32x4_t _l = vld1q_f32(idx);
+    for (; l + 3 < reg_max; l += 4)
+    {
+        float32x4_t _e = exp_ps(vsubq_f32(vld1q_f32(ptr + l), _m));
+        _sum = vaddq_f32(_sum, _e);
+        _wsum = vmlaq_f32(_wsum, _e, _l);
+        _l = vaddq_f32(_l, vdupq_n_f32(4.f));
+    }
+    sum = reduce_sum(_sum);
+    wsum = reduce_sum(_wsum);
+#elif __SSE2__
+    __m128 _m = _mm_set1_ps(m);
+    __m128 _sum = _mm_setzero_ps();
+    __m128 _wsum = _mm_setzero_ps();
+    __m128 _l = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+    for (; l + 3 < reg_max; l += 4)
+    {
+        __m128 _e = exp_ps(_mm_sub_ps(_mm_loadu_ps(ptr + l), _m));
+        _sum = _mm_add_ps(_sum, _e);
+        _wsum = _mm_add_ps(_wsum, _mm_mul_ps(_e, _l));
+        _l = _mm_add_ps(_l, _mm_set1_ps(4.f));
+    }
+    sum = reduce_sum(_sum);
+    wsum = reduce_sum(_wsum);
+#endif
+    for (; l < reg_max; l++)
+    {
+        float e = expf(ptr[l] - m);
+        sum += e;
+        wsum += l * e;
+    }
+    return wsum / sum;
+}
+
+bool update_anchor_table(AnchorTable& table, int target_w, int target_h, const int* strides, int num_strides)
+{
+    if (table.target_w == target_w && table.target_h == target_h && !table.stride.empty())
+        return false;
+
+    table.target_w = target_w;
+    table.target_h = target_h;
+    table.cx.clear();
+    table.cy.clear();
+    table.stride.clear();
+
+    for (int i = 0; i < num_strides; i++)
+    {
+        const int stride = strides[i];
+        const int num_grid_w = target_w / stride;
+        const int num_grid_h = target_h / stride;
+        for (int g1 = 0; g1 < num_grid_h; g1++)
+        {
+            for (int g0 = 0; g0 < num_grid_w; g0++)
+            {
+                table.cx.push_back((g0 + 0.5f) * stride);
+                table.cy.push_back((g1 + 0.5f) * stride);
+                table.stride.push_back((float)stride);
+            }
+        }
+    }
+
+    return true;
+}
+
+float inverse_sigmoid(float prob)
+{
+    if (prob <= 0.f)
+        return -FLT_MAX;
+    if (prob >= 1.f)
+        return FLT_MAX;
+
+    return logf(prob / (1.f - prob));
+}
+
+void generate_dfl_proposals(const AnchorTable& anchors, const ncnn::Mat& pred, int num_class, int reg_max, float prob_threshold, std::vector<Object>& objects)
+{
+    const int num_points = std::min(anchors.size(), pred.h);
+
+    // fast_exp reads at most ~5% low, which lifts sigmoid by under 0.05 in logit space,
+    // so the gate keeps a margin and the exact test below decides the borderline anchors
+    const float logit_threshold = inverse_sigmoid(prob_threshold) - 0.125f;
+
+    for (int i = 0; i < num_points; i++)
+    {
+        const float* ptr = pred.row(i);
+        const float* scores = ptr + 4 * reg_max;
+
+        float score = max_value(scores, num_class);
+        // a nan logit can make the simd max nan, which no threshold compare rejects
+        if (!isfinite(score) || score < logit_threshold)
+            continue;
+
+        float box_prob = sigmoid(score);
+        if (box_prob < prob_threshold)
+            continue;
+
+        const int label = first_label_of(scores, num_class, score);
+        if (label == num_class)
+            continue;
+
+        const float stride = anchors.stride[i];
+        const float pb_cx = anchors.cx[i];
+        const float pb_cy = anchors.cy[i];
+
+        float x0 = pb_cx - dfl_expectation(ptr, reg_max) * stride;
+        float y0 = pb_cy - dfl_expectation(ptr + reg_max, reg_max) * stride;
+        float x1 = pb_cx + dfl_expectation(ptr + reg_max * 2, reg_max) * stride;
+        float y1 = pb_cy + dfl_expectation(ptr + reg_max * 3, reg_max) * stride;
+
+        Object obj;
+        obj.rect.x = x0;
+        obj.rect.y = y0;
+        obj.rect.width = x1 - x0;
+        obj.rect.height = y1 - y0;
+        obj.label = label;
+        obj.prob = box_prob;
+
+        objects.push_back(obj);
+    }
+}
+
+void generate_anchor_proposals(const ncnn::Mat& pred, int grid_w, int grid_h, int stride, const float* anchors, int num_anchors, int num_class, float prob_threshold, std::vector<Object>& objects)
+{
+    const int num_cells = std::min(grid_w * grid_h, pred.h);
+
+    // the class sigmoid only lowers the product, so objectness alone bounds it
+    const float logit_threshold = inverse_sigmoid(prob_threshold) - 0.125f;
+
+    for (int q = 0; q < std::min(num_anchors, pred.c); q++)
+    {
+        const ncnn::Mat feat = pred.channel(q);
+        const float anchor_w = anchors[q * 2];
+        const float anchor_h = anchors[q * 2 + 1];
+
+        for (int i = 0; i < num_cells; i++)
+        {
+            const float* ptr = feat.row(i);
+            if (!isfinite(ptr[4]) || ptr[4] < logit_threshold)
+                continue;
+
+            const float* scores = ptr + 5;
+            const float score = max_value(scores, num_class);
+            if (!isfinite(score))
+                continue;
+
+            const float box_prob = sigmoid(ptr[4]) * sigmoid(score);
+            if (box_prob < prob_threshold)
+                continue;
+
+            const int label = first_label_of(scores, num_class, score);
+            if (label == num_class)
+                continue;
+
+            const float dx = sigmoid_exact(ptr[0]);
+            const float dy = sigmoid_exact(ptr[1]);
+            const float dw = sigmoid_exact(ptr[2]);
+            const float dh = sigmoid_exact(ptr[3]);
+
+            const float pb_cx = (dx * 2.f - 0.5f + i % grid_w) * stride;
+            const float pb_cy = (dy * 2.f - 0.5f + i / grid_w) * stride;
+            const float pb_w = dw * dw * 4.f * anchor_w;
+            const float pb_h = dh * dh * 4.f * anchor_h;
+
+            Object obj;
+            obj.rect.x = pb_cx - pb_w * 0.5f;
+            obj.rect.y = pb_cy - pb_h * 0.5f;
+            obj.rect.width = pb_w;
+            obj.rect.height = pb_h;
+            obj.label = label;
+            obj.prob = box_prob;
+
+            objects.push_back(obj);
+        }
+    }
+}
+
+static bool prob_greater(const Object& a, const Object& b)
+{
+    return a.prob > b.prob;
+}
+
+void rank_proposals(std::vector<Object>& objects, int topk)
+{
+    if (topk > 0 && (int)objects.size() > topk)
+    {
+        std::nth_element(objects.begin(), objects.begin() + topk, objects.end(), prob_greater);
+        objects.resize(topk);
+    }
+
+    std::sort(objects.begin(), objects.end(), prob_greater);
+}
+
+// kept boxes of one class as structure of arrays, so one candidate is tested against 4 at a time
+struct KeptBoxes
+{
+    std::vector<float> x0;
+    std::vector<float> y0;
+    std::vector<float> x1;
+    std::vector<float> y1;
+    std::vector<float> area;
+
+    void push_back(float _x0, float _y0, float _x1, float _y1, float _area)
+    {
+        x0.push_back(_x0);
+        y0.push_back(_y0);
+        x1.push_back(_x1);
+        y1.push_back(_y1);
+        area.push_back(_area);
+    }
+};
+
+// true if iou of the box against any kept box exceeds nms_threshold
+// inter / union > t is tested as inter > t * union, no division
+static bool overlaps_any(const KeptBoxes& kept, float x0, float y0, float x1, float y1, float area, float nms_threshold)
+{
+    const int n = (int)kept.area.size();
+    const float* kx0 = kept.x0.data();
+    const float* ky0 = kept.y0.data();
+    const float* kx1 = kept.x1.data();
+    const float* ky1 = kept.y1.data();
+    const float* karea = kept.area.data();
+
+    int j = 0;
+#if __ARM_NEON
+    float32x4_t _x0 = vdupq_n_f32(x0);
+    float32x4_t _y0 = vdupq_n_f32(y0);
+    float32x4_t _x1 = vdupq_n_f32(x1);
+    float32x4_t _y1 = vdupq_n_f32(y1);
+    float32x4_t _area = vdupq_n_f32(area);
+    float32x4_t _t = vdupq_n_f32(nms_threshold);
+    float32x4_t _zero = vdupq_n_f32(0.f);
+    for (; j + 3 < n; j += 4)
+    {
+        float32x4_t _iw = vsubq_f32(vminq_f32(_x1, vld1q_f32(kx1 + j)), vmaxq_f32(_x0, vld1q_f32(kx0 + j)));
+        float32x4_t _ih = vsubq_f32(vminq_f32(_y1, vld1q_f32(ky1 + j)), vmaxq_f32(_y0, vld1q_f32(ky0 + j)));
+        float32x4_t _inter = vmulq_f32(vmaxq_f32(_iw, _zero), vmaxq_f32(_ih, _zero));
+        float32x4_t _union = vsubq_f32(vaddq_f32(_area, vld1q_f32(karea + j)), _inter);
+        uint32x4_t _mask = vcgtq_f32(_inter, vmulq_f32(_t, _union));
+#if __aarch64__
+        if (vmaxvq_u32(_mask))
+            return true;
+#else
+        uint32x2_t _m2 = vorr_u32(vget_low_u32(_mask), vget_high_u32(_mask));
+        if (vget_lane_u32(_m2, 0) | vget_lane_u32(_m2, 1))
+            return true;
+#endif
+    }
+#elif __SSE2__
+    __m128 _x0 = _mm_set1_ps(x0);
+    __m128 _y0 = _mm_set1_ps(y0);
+    __m128 _x1 = _mm_set1_ps(x1);
+    __m128 _y1 = _mm_set1_ps(y1);
+    __m128 _area = _mm_set1_ps(area);
+    __m128 _t = _mm_set1_ps(nms_threshold);
+    __m128 _zero = _mm_setzero_ps();
+    for (; j + 3 < n; j += 4)
+    {
+        __m128 _iw = _mm_sub_ps(_mm_min_ps(_x1, _mm_loadu_ps(kx1 + j)), _mm_max_ps(_x0, _mm_loadu_ps(kx0 + j)));
+        __m128 _ih = _mm_sub_ps(_mm_min_ps(_y1, _mm_loadu_ps(ky1 + j)), _mm_max_ps(_y0, _mm_loadu_ps(ky0 + j)));
+        __m128 _inter = _mm_mul_ps(_mm_max_ps(_iw, _zero), _mm_max_ps(_ih, _zero));
+        __m128 _union = _mm_sub_ps(_mm_add_ps(_area, _mm_loadu_ps(karea + j)), _inter);
+        if (_mm_movemask_ps(_mm_cmpgt_ps(_inter, _mm_mul_ps(_t, _union))))
+            return true;
+    }
+#endif
+    for (; j < n; j++)
+    {
+        float iw = std::min(x1, kx1[j]) - std::max(x0, kx0[j]);
+        float ih = std::min(y1, ky1[j]) - std::max(y0, ky0[j]);
+        float inter = std::max(iw, 0.f) * std::max(ih, 0.f);
+        if (inter > nms_threshold * (area + karea[j] - inter))
+            return true;
+    }
+    return false;
+}
+
+void nms_sorted_bboxes(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold, bool agnostic, int max_det)
+{
+    picked.clear();
+
+    const int n = (int)objects.size();
+
+    int num_buckets = 1;
+    if (!agnostic)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            num_buckets = std::max(num_buckets, objects[i].label + 1);
+        }
+    }
+
+    std::vector<KeptBoxes> kept(num_buckets);
+
+    for (int i = 0; i < n; i++)
+    {
+        const Object& a = objects[i];
+        const float x0 = a.rect.x;
+        const float y0 = a.rect.y;
+        const float x1 = a.rect.x + a.rect.width;
+        const float y1 = a.rect.y + a.rect.height;
+        const float area = a.rect.width * a.rect.height;
+
+        KeptBoxes& bucket = kept[agnostic ? 0 : a.label];
+        if (overlaps_any(bucket, x0, y0, x1, y1, area, nms_threshold))
+            continue;
+
+        bucket.push_back(x0, y0, x1, y1, area);
+        picked.push_back(i);
+
+        if (max_det > 0 && (int)picked.size() >= max_det)
+            break;
+    }
+}
@@ -0,0 +1,79 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef DETPOST_H
+#define DETPOST_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include <mat.h>
+
+struct Object
+{
+    cv::Rect_<float> rect;
+    int label;
+    float prob;
+};
+
+// center and stride of every output row of an anchor free head, in input pixels
+// rows are ordered stride by stride, then row major over the grid
+struct AnchorTable
+{
+    int target_w;
+    int target_h;
+    std::vector<float> cx;
+    std::vector<float> cy;
+    std::vector<float> stride;
+
+    AnchorTable() : target_w(0), target_h(0) {}
+
+    int size() const { return (int)stride.size(); }
+};
+
+// rebuilds the table only when the input size changed, returns true if it did
+bool update_anchor_table(AnchorTable& table, int target_w, int target_h, const int* strides, int num_strides);
+
+// logit x with sigmoid(x) == prob, +-FLT_MAX outside (0, 1)
+float inverse_sigmoid(float prob);
+
+// decode a yolov8 head, one row per anchor of 4 * reg_max dfl bins followed by num_class logits
+// an anchor is rejected by comparing its raw logits against the inverse sigmoid of prob_threshold,
+// the box of a surviving anchor is the softmax expectation over each side's bins
+void generate_dfl_proposals(const AnchorTable& anchors, const ncnn::Mat& pred, int num_class, int reg_max, float prob_threshold, std::vector<Object>& objects);
+
+// the yolov7 default anchors, (w, h) pairs for strides 8, 16 and 32, which yolopv2's detection heads use
+static const float YOLOV7_ANCHORS[3][6] = {
+    {12.f, 16.f, 19.f, 36.f, 40.f, 28.f},
+    {36.f, 75.f, 76.f, 55.f, 72.f, 146.f},
+    {142.f, 110.f, 192.f, 243.f, 459.f, 401.f}
+};
+
+// decode one level of a yolov7 style anchor head, num_anchors channels of grid_w * grid_h rows,
+// each row holding the x y w h objectness and num_class logits of one cell, cells row major
+// anchors are num_anchors (w, h) pairs in input pixels
+// a cell is rejected on its objectness logit alone, prob is sigmoid(objectness) * sigmoid(best class)
+void generate_anchor_proposals(const ncnn::Mat& pred, int grid_w, int grid_h, int stride, const float* anchors, int num_anchors, int num_class, float prob_threshold, std::vector<Object>& objects);
+
+// sort objects by prob from highest to lowest, keeping only the topk best when topk > 0
+// the best topk are selected first so only the survivors get sorted
+void rank_proposals(std::vector<Object>& objects, int topk);
+
+// greedy nms over objects sorted by prob from highest to lowest, picked gets indices into objects
+// kept boxes are bucketed per label so different classes never suppress each other, unless agnostic
+// stops once max_det boxes are kept, max_det <= 0 keeps all
+void nms_sorted_bboxes(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold, bool agnostic = false, int max_det = 0);
+
+#endif // DETPOST_H
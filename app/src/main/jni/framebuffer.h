@@ -0,0 +1,117 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// single producer single consumer exchange of the latest item through three slots
+// the producer fills write_buffer() and publishes it, the consumer acquires the newest
+// published slot and reads it through read_buffer(), only slot indices are swapped
+// an unread slot is overwritten by the next publish, so the consumer always sees the newest item
+template<typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+        : back(0), front(2), middle(1)
+    {
+    }
+
+    // producer side
+    T& write_buffer()
+    {
+        return slots[back];
+    }
+
+    // returns true if the previously published item was never acquired
+    bool publish()
+    {
+        int old = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+        back = old & INDEX_MASK;
+        return (old & FRESH) != 0;
+    }
+
+    // consumer side
+    bool has_fresh() const
+    {
+        return (middle.load(std::memory_order_acquire) & FRESH) != 0;
+    }
+
+    // returns false and keeps the current slot if nothing new was published
+    bool acquire()
+    {
+        if (!has_fresh())
+            return false;
+
+        int old = middle.exchange(front, std::memory_order_acq_rel);
+        front = old & INDEX_MASK;
+        return true;
+    }
+
+    const T& read_buffer() const
+    {
+        return slots[front];
+    }
+
+    T& read_buffer()
+    {
+        return slots[front];
+    }
+
+private:
+    enum
+    {
+        INDEX_MASK = 3,
+        FRESH = 4
+    };
+
+    T slots[3];
+    int back;
+    int front;
+    std::atomic<int> middle;
+};
+
+// process wide count of full frame pixel copies, for checking the hot path stays copy free
+// reallocs counts frame buffers meant to be reused that had to be allocated again
+struct FrameCopyCounter
+{
+    std::atomic<int64_t> count;
+    std::atomic<int64_t> bytes;
+    std::atomic<int64_t> reallocs;
+};
+
+inline FrameCopyCounter& frame_copy_counter()
+{
+    static FrameCopyCounter counter = {{0}, {0}, {0}};
+    return counter;
+}
+
+static inline void count_frame_copy(size_t bytes)
+{
+    FrameCopyCounter& c = frame_copy_counter();
+    c.count.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add((int64_t)bytes, std::memory_order_relaxed);
+}
+
+static inline void count_frame_realloc()
+{
+    frame_copy_counter().reallocs.fetch_add(1, std::memory_order_relaxed);
+}
+
+#endif // FRAMEBUFFER_H
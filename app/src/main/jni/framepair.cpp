@@ -0,0 +1,110 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "framepair.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+static int size_area(const StreamSize& s)
+{
+    return s.width * s.height;
+}
+
+StreamSizes choose_stream_sizes(const std::vector<StreamSize>& available, int window_w, int window_h, int yolopv2_target_size, int yolov8_target_size, int max_display_long)
+{
+    StreamSizes sizes;
+    sizes.display.width = 640;
+    sizes.display.height = 480;
+    sizes.inference = sizes.display;
+
+    const int model_long = std::max(yolopv2_target_size, yolov8_target_size);
+    if (available.empty() || window_w <= 0 || window_h <= 0 || model_long <= 0)
+        return sizes;
+
+    const int window_long = std::max(window_w, window_h);
+    const int window_short = std::min(window_w, window_h);
+
+    // the window aspect crop of a size decides how sharp the preview gets
+    // covering sizes compete on bandwidth, the others on how much of the window they fill
+    int display = -1;
+    bool display_covers = false;
+    int display_roi_long = 0;
+    for (int i = 0; i < (int)available.size(); i++)
+    {
+        const StreamSize& s = available[i];
+        const int size_long = std::max(s.width, s.height);
+        const int size_short = std::min(s.width, s.height);
+        if (size_long > max_display_long)
+            continue;
+
+        const int roi_long = std::min(size_long, (int)((int64_t)size_short * window_long / window_short));
+        const bool covers = roi_long >= window_long;
+
+        bool better = false;
+        if (display == -1)
+            better = true;
+        else if (covers != display_covers)
+            better = covers;
+        else if (!covers && roi_long != display_roi_long)
+            better = roi_long > display_roi_long;
+        else
+            better = size_area(s) < size_area(available[display]);
+
+        if (better)
+        {
+            display = i;
+            display_covers = covers;
+            display_roi_long = roi_long;
+        }
+    }
+
+    if (display == -1)
+        return sizes;
+
+    sizes.display = available[display];
+    sizes.inference = sizes.display;
+
+    // the roi is mapped between the streams by scaling, so the field of view has to match
+    const float aspect = (float)sizes.display.width / sizes.display.height;
+    for (int i = 0; i < (int)available.size(); i++)
+    {
+        const StreamSize& s = available[i];
+        if (fabsf((float)s.width / s.height - aspect) > aspect * 0.01f)
+            continue;
+        if (std::max(s.width, s.height) < model_long)
+            continue;
+        if (size_area(s) < size_area(sizes.inference))
+            sizes.inference = s;
+    }
+
+    return sizes;
+}
+
+Nv21Roi rescale_roi(const Nv21Roi& roi, const unsigned char* nv21, int width, int height)
+{
+    const float sx = (float)width / roi.width;
+    const float sy = (float)height / roi.height;
+
+    Nv21Roi r = roi;
+    r.nv21 = nv21;
+    r.width = width;
+    r.height = height;
+    r.roi_x = std::min((int)(roi.roi_x * sx + 0.5f) / 2 * 2, width - 2);
+    r.roi_y = std::min((int)(roi.roi_y * sy + 0.5f) / 2 * 2, height - 2);
+    r.roi_w = std::max(std::min((int)(roi.roi_w * sx + 0.5f) / 2 * 2, width - r.roi_x), 2);
+    r.roi_h = std::max(std::min((int)(roi.roi_h * sy + 0.5f) / 2 * 2, height - r.roi_y), 2);
+    return r;
+}
@@ -0,0 +1,176 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef FRAMEPAIR_H
+#define FRAMEPAIR_H
+
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+#include "yuv420.h"
+
+// the last few frames of a secondary stream, looked up by the capture timestamp of a primary stream frame
+// streams fed by the same capture request carry the same sensor timestamp
+// single producer single consumer, the slot being written and the slot being read are never handed out
+template<typename T>
+class TimestampRing
+{
+public:
+    TimestampRing()
+        : writing(-1), reading(-1)
+    {
+        for (int i = 0; i < SLOTS; i++)
+        {
+            stamps[i] = 0;
+            consumed[i] = true;
+        }
+    }
+
+    // producer side, the oldest slot not being read
+    T& write_buffer()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        int oldest = -1;
+        for (int i = 0; i < SLOTS; i++)
+        {
+            if (i == reading)
+                continue;
+            if (oldest == -1 || stamps[i] < stamps[oldest])
+                oldest = i;
+        }
+
+        writing = oldest;
+        stamps[writing] = 0;
+        return slots[writing];
+    }
+
+    void publish(int64_t timestamp)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stamps[writing] = timestamp;
+        consumed[writing] = false;
+        writing = -1;
+    }
+
+    // consumer side, every frame is handed out at most once
+    // holds the frame closest to timestamp within tolerance, false keeps the current slot
+    bool acquire(int64_t timestamp, int64_t tolerance)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        int best = -1;
+        int64_t best_diff = tolerance;
+        for (int i = 0; i < SLOTS; i++)
+        {
+            if (i == writing || stamps[i] == 0 || consumed[i])
+                continue;
+
+            const int64_t diff = stamps[i] > timestamp ? stamps[i] - timestamp : timestamp - stamps[i];
+            if (diff <= best_diff)
+            {
+                best = i;
+                best_diff = diff;
+            }
+        }
+
+        return hold(best);
+    }
+
+    // holds the newest frame not acquired before, false keeps the current slot
+    bool acquire_newest()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        int newest = -1;
+        for (int i = 0; i < SLOTS; i++)
+        {
+            if (i == writing || stamps[i] == 0 || consumed[i])
+                continue;
+            if (newest == -1 || stamps[i] > stamps[newest])
+                newest = i;
+        }
+
+        return hold(newest);
+    }
+
+    const T& read_buffer() const
+    {
+        return slots[reading];
+    }
+
+    int64_t read_timestamp() const
+    {
+        return stamps[reading];
+    }
+
+private:
+    bool hold(int slot)
+    {
+        if (slot == -1)
+            return false;
+
+        reading = slot;
+        consumed[slot] = true;
+        return true;
+    }
+
+private:
+    enum
+    {
+        // one being written, one being read, two to absorb callback jitter between the streams
+        SLOTS = 4
+    };
+
+    std::mutex mutex;
+    T slots[SLOTS];
+    int64_t stamps[SLOTS];
+    bool consumed[SLOTS];
+    int writing;
+    int reading;
+};
+
+struct StreamSize
+{
+    int width;
+    int height;
+};
+
+// output sizes of the capture session
+// display feeds the preview, inference the networks, inference equals display for a single stream
+struct StreamSizes
+{
+    StreamSize display;
+    StreamSize inference;
+
+    bool dual() const
+    {
+        return inference.width != display.width || inference.height != display.height;
+    }
+};
+
+// picks the stream sizes from the camera's yuv output sizes, landscape as the sensor reports them
+// display is the smallest size whose window aspect crop covers the window, or else the one with the largest crop,
+// at most max_display_long on the long side
+// inference is the smallest size of the same aspect ratio whose long side still reaches the larger model
+// input size, one stream is used when no such size is smaller than display
+// an unknown window or model size, or no sizes, keeps 640x480
+StreamSizes choose_stream_sizes(const std::vector<StreamSize>& available, int window_w, int window_h, int yolopv2_target_size, int yolov8_target_size, int max_display_long = 1920);
+
+// the roi of a display stream frame mapped onto the paired inference stream frame of the same field of view
+Nv21Roi rescale_roi(const Nv21Roi& roi, const unsigned char* nv21, int width, int height);
+
+#endif // FRAMEPAIR_H
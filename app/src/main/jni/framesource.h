@@ -0,0 +1,45 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <stdint.h>
+
+#include <chrono>
+
+// frame timestamps are nanoseconds of std::chrono::steady_clock (CLOCK_MONOTONIC)
+static inline int64_t frame_timestamp_now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// anything that produces nv21 frames, the camera or a recording
+class FrameSource
+{
+public:
+    virtual ~FrameSource()
+    {
+    }
+
+    virtual void close() = 0;
+
+    // called on the source thread for every frame, nv21 is only valid during the call
+    // timestamp is the capture time, see frame_timestamp_now()
+    virtual void on_image(const unsigned char* nv21, int nv21_width, int nv21_height, int64_t timestamp) const
+    {
+    }
+};
+
+#endif // FRAMESOURCE_H
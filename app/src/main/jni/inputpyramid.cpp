@@ -0,0 +1,133 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "inputpyramid.h"
+
+Letterbox make_letterbox(int img_w, int img_h, int target_size, int stride)
+{
+    Letterbox lb;
+    lb.w = img_w;
+    lb.h = img_h;
+    if (lb.w > lb.h)
+    {
+        lb.scale = (float)target_size / lb.w;
+        lb.w = target_size;
+        lb.h = lb.h * lb.scale;
+    }
+    else
+    {
+        lb.scale = (float)target_size / lb.h;
+        lb.h = target_size;
+        lb.w = lb.w * lb.scale;
+    }
+
+    const int wpad = (lb.w + stride - 1) / stride * stride - lb.w;
+    const int hpad = (lb.h + stride - 1) / stride * stride - lb.h;
+    lb.top = hpad / 2;
+    lb.bottom = hpad - hpad / 2;
+    lb.left = wpad / 2;
+    lb.right = wpad - wpad / 2;
+    return lb;
+}
+
+InputPyramid::InputPyramid()
+    : level1_valid(false), resamples(0)
+{
+}
+
+void InputPyramid::build(const Nv21Roi& roi, int w, int h)
+{
+    level0.create(w, h, 3);
+    if (level0.empty())
+        return;
+
+    const float zero_mean[3] = {0.f, 0.f, 0.f};
+    const float unit_norm[3] = {1.f, 1.f, 1.f};
+    float* planes[3] = {level0.channel(0), level0.channel(1), level0.channel(2)};
+    resampler.resample(roi, w, h, planes, w, zero_mean, unit_norm);
+
+    level1_valid = false;
+    resamples++;
+}
+
+const ncnn::Mat& InputPyramid::level(int w, int h)
+{
+    if (w == level0.w && h == level0.h)
+        return level0;
+
+    if (w == level0.w / 2 && h == level0.h / 2)
+    {
+        if (!level1_valid)
+        {
+            level1.create(w, h, 3);
+            for (int q = 0; q < 3; q++)
+            {
+                const float* src = level0.channel(q);
+                float* dst = level1.channel(q);
+                for (int y = 0; y < h; y++)
+                {
+                    const float* r0 = src + y * 2 * level0.w;
+                    const float* r1 = r0 + level0.w;
+                    for (int x = 0; x < w; x++)
+                    {
+                        dst[x] = (r0[x * 2] + r0[x * 2 + 1] + r1[x * 2] + r1[x * 2 + 1]) * 0.25f;
+                    }
+                    dst += w;
+                }
+            }
+            level1_valid = true;
+        }
+        return level1;
+    }
+
+    ncnn::resize_bilinear(level0, resized, w, h);
+    return resized;
+}
+
+void InputPyramid::make_input(const Letterbox& lb, int type, float pad_value, const float* mean_vals, const float* norm_vals, ncnn::Mat& out, ncnn::Allocator* allocator)
+{
+    const int outw = lb.w + lb.left + lb.right;
+    const int outh = lb.h + lb.top + lb.bottom;
+    out.create(outw, outh, 3, 4u, allocator);
+    if (out.empty() || level0.empty())
+        return;
+
+    const float zero_mean[3] = {0.f, 0.f, 0.f};
+    const float unit_norm[3] = {1.f, 1.f, 1.f};
+    const float* mean = mean_vals ? mean_vals : zero_mean;
+    const float* norm = norm_vals ? norm_vals : unit_norm;
+
+    fill_border(out, lb.top, lb.bottom, lb.left, lb.right, pad_value, mean, norm);
+
+    const ncnn::Mat& src = level(lb.w, lb.h);
+
+    // output channel q reads rgb plane q, or the mirrored one for bgr
+    const int swap_rb = type == ncnn::Mat::PIXEL_BGR;
+    for (int q = 0; q < 3; q++)
+    {
+        const float* sptr = src.channel(swap_rb ? 2 - q : q);
+        float* outptr = (float*)out.channel(q) + lb.top * outw + lb.left;
+        const float m = mean[q];
+        const float n = norm[q];
+        for (int y = 0; y < lb.h; y++)
+        {
+            for (int x = 0; x < lb.w; x++)
+            {
+                outptr[x] = (sptr[x] - m) * n;
+            }
+            sptr += lb.w;
+            outptr += outw;
+        }
+    }
+}
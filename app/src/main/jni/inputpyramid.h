@@ -0,0 +1,73 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef INPUTPYRAMID_H
+#define INPUTPYRAMID_H
+
+#include <mat.h>
+
+#include "yuv420.h"
+
+// placement of a resized image inside a stride aligned network input
+struct Letterbox
+{
+    int w;
+    int h;
+    int top;
+    int bottom;
+    int left;
+    int right;
+    float scale;
+};
+
+// the long side scaled to target_size, both sides padded up to a multiple of stride, centered
+Letterbox make_letterbox(int img_w, int img_h, int target_size, int stride);
+
+// the network inputs of one frame, derived from a single resample of the nv21 roi
+// level 0 is the largest input, the next level is its 2x2 box average, other sizes are resized from level 0
+// buffers and resample coefficients are kept across frames, one instance per thread
+class InputPyramid
+{
+public:
+    InputPyramid();
+
+    // resamples the roi to w x h upright rgb, the largest content size make_input will be asked for
+    void build(const Nv21Roi& roi, int w, int h);
+
+    // letterboxed planar input, mean and norm per output channel and may be null
+    // type is ncnn::Mat::PIXEL_RGB or ncnn::Mat::PIXEL_BGR
+    void make_input(const Letterbox& lb, int type, float pad_value, const float* mean_vals, const float* norm_vals, ncnn::Mat& out, ncnn::Allocator* allocator = 0);
+
+    // full resamples of the roi since construction
+    int resample_count() const
+    {
+        return resamples;
+    }
+
+private:
+    const ncnn::Mat& level(int w, int h);
+
+private:
+    Nv21Resampler resampler;
+
+    // rgb planes in 0~255
+    ncnn::Mat level0;
+    ncnn::Mat level1;
+    bool level1_valid;
+    ncnn::Mat resized;
+
+    int resamples;
+};
+
+#endif // INPUTPYRAMID_H
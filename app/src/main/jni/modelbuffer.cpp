@@ -0,0 +1,307 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "modelbuffer.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "framesource.h"
+#include "netprune.h"
+
+ModelBuffer::ModelBuffer()
+    : ptr(0), length(0), is_mapped(false),
+#if __ANDROID__
+      asset(0),
+#endif
+      map_addr(0), map_length(0)
+{
+}
+
+ModelBuffer::~ModelBuffer()
+{
+    close();
+}
+
+#if __ANDROID__
+int ModelBuffer::open(AAssetManager* mgr, const char* name)
+{
+    close();
+
+    asset = AAssetManager_open(mgr, name, AASSET_MODE_BUFFER);
+    if (!asset)
+        return -1;
+
+    const void* buffer = AAsset_getBuffer(asset);
+    if (!buffer)
+    {
+        close();
+        return -1;
+    }
+
+    // an allocated buffer means the asset was compressed and got inflated on the heap
+    adopt(buffer, (size_t)AAsset_getLength(asset), !AAsset_isAllocated(asset));
+    return 0;
+}
+#endif
+
+int ModelBuffer::open(const char* path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return -1;
+    }
+
+    void* addr = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return -1;
+
+    map_addr = addr;
+    map_length = (size_t)st.st_size;
+    adopt(addr, map_length, true);
+    return 0;
+}
+
+void ModelBuffer::close()
+{
+#if __ANDROID__
+    if (asset)
+    {
+        AAsset_close(asset);
+        asset = 0;
+    }
+#endif
+    if (map_addr)
+    {
+        munmap(map_addr, map_length);
+        map_addr = 0;
+        map_length = 0;
+    }
+    std::vector<unsigned int>().swap(copy);
+
+    ptr = 0;
+    length = 0;
+    is_mapped = false;
+}
+
+void ModelBuffer::adopt(const void* src, size_t size, bool src_mapped)
+{
+    length = size;
+    if (((uintptr_t)src & 3) == 0)
+    {
+        ptr = (const unsigned char*)src;
+        is_mapped = src_mapped;
+        return;
+    }
+
+    copy.resize((size + 3) / 4);
+    memcpy(copy.data(), src, size);
+    ptr = (const unsigned char*)copy.data();
+    is_mapped = false;
+
+#if __ANDROID__
+    if (asset)
+    {
+        AAsset_close(asset);
+        asset = 0;
+    }
+#endif
+    if (map_addr)
+    {
+        munmap(map_addr, map_length);
+        map_addr = 0;
+        map_length = 0;
+    }
+}
+
+static long status_kb(const char* key)
+{
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (!fp)
+        return 0;
+
+    const size_t len = strlen(key);
+    long kb = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (strncmp(line, key, len) == 0)
+        {
+            kb = atol(line + len);
+            break;
+        }
+    }
+    fclose(fp);
+    return kb;
+}
+
+long resident_memory_kb()
+{
+    return status_kb("VmRSS:");
+}
+
+long peak_resident_memory_kb()
+{
+    return status_kb("VmHWM:");
+}
+
+bool reset_peak_resident_memory()
+{
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if (!fp)
+        return false;
+
+    const bool ok = fputs("5", fp) >= 0;
+    return fclose(fp) == 0 && ok;
+}
+
+TimedDataReader::TimedDataReader(const ncnn::DataReader& _dr)
+    : elapsed(0), dr(_dr)
+{
+}
+
+#if NCNN_STRING
+int TimedDataReader::scan(const char* format, void* p) const
+{
+    const int64_t begin = frame_timestamp_now();
+    const int ret = dr.scan(format, p);
+    elapsed += frame_timestamp_now() - begin;
+    return ret;
+}
+#endif
+
+size_t TimedDataReader::read(void* buf, size_t size) const
+{
+    const int64_t begin = frame_timestamp_now();
+    const size_t ret = dr.read(buf, size);
+    elapsed += frame_timestamp_now() - begin;
+    return ret;
+}
+
+size_t TimedDataReader::reference(size_t size, const void** buf) const
+{
+    const int64_t begin = frame_timestamp_now();
+    const size_t ret = dr.reference(size, buf);
+    elapsed += frame_timestamp_now() - begin;
+    return ret;
+}
+
+static int load_model_timed(ncnn::Net& net, const ncnn::DataReader& dr, LoadPhases& phases)
+{
+    TimedDataReader timed(dr);
+
+    const int64_t begin = frame_timestamp_now();
+    const int ret = net.load_model(timed);
+    const int64_t total = frame_timestamp_now() - begin;
+
+    phases.weights = timed.elapsed / 1000000.0;
+    phases.pipeline = (total - timed.elapsed) / 1000000.0;
+    return ret;
+}
+
+// a .param.bin path is the binary param made by tools/ncnnparam2bin.py
+static bool is_binary_param(const char* parampath)
+{
+    const size_t len = strlen(parampath);
+    return len > 4 && strcmp(parampath + len - 4, ".bin") == 0;
+}
+
+#if __ANDROID__
+int load_net_timed(ncnn::Net& net, ModelBuffer& weights, AAssetManager* mgr, const char* parampath, const char* modelpath, bool map_weights, LoadPhases& phases, const std::vector<int>& outputs)
+{
+    phases = LoadPhases();
+
+    const int64_t begin = frame_timestamp_now();
+    const int param_ret = is_binary_param(parampath) ? net.load_param_bin(mgr, parampath) : net.load_param(mgr, parampath);
+    if (param_ret != 0)
+        return -1;
+    if (!outputs.empty())
+        phases.pruned_layers = prune_unused_layers(net, outputs, &phases.pruned_bytes);
+    phases.param = (frame_timestamp_now() - begin) / 1000000.0;
+
+    if (map_weights && weights.open(mgr, modelpath) == 0)
+    {
+        const unsigned char* mem = weights.data();
+        ncnn::DataReaderFromMemory dr(mem);
+        return load_model_timed(net, dr, phases);
+    }
+
+    AAsset* asset = AAssetManager_open(mgr, modelpath, AASSET_MODE_STREAMING);
+    if (!asset)
+        return -1;
+
+    ncnn::DataReaderFromAndroidAsset dr(asset);
+    const int ret = load_model_timed(net, dr, phases);
+    AAsset_close(asset);
+    return ret;
+}
+#else
+static int load_param_any(ncnn::Net& net, const char* parampath)
+{
+    if (!is_binary_param(parampath))
+        return net.load_param(parampath);
+
+    if (access(parampath, R_OK) == 0)
+        return net.load_param_bin(parampath);
+
+    // a model dir holding only the text param, the blob indices are the same
+    const std::string textpath(parampath, strlen(parampath) - 4);
+    return net.load_param(textpath.c_str());
+}
+
+int load_net_timed(ncnn::Net& net, ModelBuffer& weights, const char* parampath, const char* modelpath, bool map_weights, LoadPhases& phases, const std::vector<int>& outputs)
+{
+    phases = LoadPhases();
+
+    const int64_t begin = frame_timestamp_now();
+    if (load_param_any(net, parampath) != 0)
+        return -1;
+    if (!outputs.empty())
+        phases.pruned_layers = prune_unused_layers(net, outputs, &phases.pruned_bytes);
+    phases.param = (frame_timestamp_now() - begin) / 1000000.0;
+
+    if (map_weights && weights.open(modelpath) == 0)
+    {
+        const unsigned char* mem = weights.data();
+        ncnn::DataReaderFromMemory dr(mem);
+        return load_model_timed(net, dr, phases);
+    }
+
+    FILE* fp = fopen(modelpath, "rb");
+    if (!fp)
+        return -1;
+
+    ncnn::DataReaderFromStdio dr(fp);
+    const int ret = load_model_timed(net, dr, phases);
+    fclose(fp);
+    return ret;
+}
+#endif
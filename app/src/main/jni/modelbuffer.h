@@ -0,0 +1,139 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef MODELBUFFER_H
+#define MODELBUFFER_H
+
+#include <stddef.h>
+
+#include <stdint.h>
+
+#include <vector>
+
+#if __ANDROID__
+#include <android/asset_manager.h>
+#endif
+
+#include <datareader.h>
+#include <net.h>
+
+// a model file held in memory for ncnn::Net::load_model(const unsigned char*), which references
+// weights in place instead of copying them, so the buffer must outlive every net loaded from it
+// the file is mapped where possible and only copied into memory when it cannot be
+class ModelBuffer
+{
+public:
+    ModelBuffer();
+    ~ModelBuffer();
+
+#if __ANDROID__
+    // an asset stored uncompressed in the apk is mapped straight from it, a compressed one is inflated
+    int open(AAssetManager* mgr, const char* name);
+#endif
+
+    // mmap of a file on disk
+    int open(const char* path);
+
+    void close();
+
+    // 32-bit aligned as load_model requires
+    const unsigned char* data() const
+    {
+        return ptr;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+    // false when the bytes live in anonymous memory, counted in full against the process
+    bool mapped() const
+    {
+        return is_mapped;
+    }
+
+private:
+    // copies when the source is not 32-bit aligned
+    void adopt(const void* src, size_t size, bool src_mapped);
+
+private:
+    const unsigned char* ptr;
+    size_t length;
+    bool is_mapped;
+
+#if __ANDROID__
+    AAsset* asset;
+#endif
+    void* map_addr;
+    size_t map_length;
+    std::vector<unsigned int> copy;
+
+    ModelBuffer(const ModelBuffer&);
+    ModelBuffer& operator=(const ModelBuffer&);
+};
+
+// VmRSS of this process in kB, 0 where /proc is unavailable
+long resident_memory_kb();
+
+// VmHWM, the peak of VmRSS, since the start or the last successful reset
+long peak_resident_memory_kb();
+bool reset_peak_resident_memory();
+
+// startup of one net in ms
+// ncnn creates each layer's pipeline right after loading its weights, so the two are told apart
+// by timing the reader, weight conversion done by a layer counts as pipeline creation
+struct LoadPhases
+{
+    double param;           // parsing the graph
+    double weights;         // reading or referencing the weights
+    double pipeline;        // the rest of load_model
+    double first_inference; // load finished to the first extract done, with lazy per layer setup
+
+    int pruned_layers;      // layers feeding none of the outputs asked for, see prune_unused_layers
+    size_t pruned_bytes;    // the weights they would have held
+
+    LoadPhases() : param(0), weights(0), pipeline(0), first_inference(0), pruned_layers(0), pruned_bytes(0) {}
+};
+
+// forwards to another reader, adding the time spent in it to elapsed
+class TimedDataReader : public ncnn::DataReader
+{
+public:
+    explicit TimedDataReader(const ncnn::DataReader& dr);
+
+#if NCNN_STRING
+    virtual int scan(const char* format, void* p) const;
+#endif
+    virtual size_t read(void* buf, size_t size) const;
+    virtual size_t reference(size_t size, const void** buf) const;
+
+    mutable int64_t elapsed;
+
+private:
+    const ncnn::DataReader& dr;
+};
+
+// load_param then load_model with the phases recorded, the weights referenced from the mapped
+// weights buffer when map_weights and the mapping works, or else read into the net
+// a parampath ending in .bin is loaded with load_param_bin, on linux the text param next to it
+// stands in when the binary one is missing
+// non-empty outputs prune the layers feeding none of these blobs, which then cannot be extracted
+#if __ANDROID__
+int load_net_timed(ncnn::Net& net, ModelBuffer& weights, AAssetManager* mgr, const char* parampath, const char* modelpath, bool map_weights, LoadPhases& phases, const std::vector<int>& outputs = std::vector<int>());
+#else
+int load_net_timed(ncnn::Net& net, ModelBuffer& weights, const char* parampath, const char* modelpath, bool map_weights, LoadPhases& phases, const std::vector<int>& outputs = std::vector<int>());
+#endif
+
+#endif // MODELBUFFER_H
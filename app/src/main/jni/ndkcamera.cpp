@@ -2,13 +2,28 @@
 
 #include <string>
 
+#include <string.h>
+#include <time.h>
+
+#include <android/choreographer.h>
 #include <android/log.h>
 
 #include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
 
 #include "mat.h"
 
-static void onImageAvailable(void *context, AImageReader *reader) {
+#include "framebuffer.h"
+#include "yuv420.h"
+
+static int64_t clock_ns(clockid_t clock_id) {
+    struct timespec ts;
+    clock_gettime(clock_id, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// hands the newest image of either stream to the camera, as nv21 when it already is, as planes otherwise
+static void deliver_image(NdkCamera *camera, AImageReader *reader, bool inference) {
 
     AImage *image = nullptr;
     media_status_t status = AImageReader_acquireLatestImage(reader, &image);
@@ -21,6 +36,17 @@ static void onImageAvailable(void *context, AImageReader *reader) {
     int32_t format;
     AImage_getFormat(image, &format);
 
+    // bring the sensor timestamp onto the monotonic clock used for latency reporting
+    int64_t timestamp = 0;
+    AImage_getTimestamp(image, &timestamp);
+    if (camera->timestamp_source == ACAMERA_SENSOR_INFO_TIMESTAMP_SOURCE_REALTIME) {
+        // CLOCK_BOOTTIME based
+        timestamp += clock_ns(CLOCK_MONOTONIC) - clock_ns(CLOCK_BOOTTIME);
+    } else {
+        // unknown time base, fall back to the arrival time
+        timestamp = clock_ns(CLOCK_MONOTONIC);
+    }
+
     int32_t width = 0;
     int32_t height = 0;
     AImage_getWidth(image, &width);
@@ -54,77 +80,99 @@ static void onImageAvailable(void *context, AImageReader *reader) {
         u_pixelStride == 2 && v_pixelStride == 2 && y_rowStride == width && u_rowStride == width &&
         v_rowStride == width) {
         // already nv21  :)
-        ((NdkCamera *) context)->on_image((unsigned char *) y_data, (int) width, (int) height);
-    } else {
-        // construct nv21
-        unsigned char *nv21 = new unsigned char[width * height + width * height / 2];
-        {
-            // Y
-            unsigned char *yptr = nv21;
-            for (int y = 0; y < height; y++) {
-                const unsigned char *y_data_ptr = y_data + y_rowStride * y;
-                for (int x = 0; x < width; x++) {
-                    yptr[0] = y_data_ptr[0];
-                    yptr++;
-                    y_data_ptr += y_pixelStride;
-                }
-            }
-
-            // UV
-            unsigned char *uvptr = nv21 + width * height;
-            for (int y = 0; y < height / 2; y++) {
-                const unsigned char *v_data_ptr = v_data + v_rowStride * y;
-                const unsigned char *u_data_ptr = u_data + u_rowStride * y;
-                for (int x = 0; x < width / 2; x++) {
-                    uvptr[0] = v_data_ptr[0];
-                    uvptr[1] = u_data_ptr[0];
-                    uvptr += 2;
-                    v_data_ptr += v_pixelStride;
-                    u_data_ptr += u_pixelStride;
-                }
-            }
+        const unsigned char *nv21 = (const unsigned char *) y_data;
+        if (inference) {
+            camera->on_inference_image(nv21, (int) width, (int) height, timestamp);
+        } else {
+            camera->on_image(nv21, (int) width, (int) height, timestamp);
         }
-
-        ((NdkCamera *) context)->on_image((unsigned char *) nv21, (int) width, (int) height);
-
-        delete[] nv21;
+    } else {
+        Yuv420Plane y_plane = {y_data, y_rowStride, y_pixelStride};
+        Yuv420Plane u_plane = {u_data, u_rowStride, u_pixelStride};
+        Yuv420Plane v_plane = {v_data, v_rowStride, v_pixelStride};
+        camera->on_yuv420_image(y_plane, u_plane, v_plane, (int) width, (int) height, timestamp,
+                                inference);
     }
 
     AImage_delete(image);
 }
 
+static void onImageAvailable(void *context, AImageReader *reader) {
+    NdkCamera *camera = (NdkCamera *) context;
+    deliver_image(camera, reader, false);
+}
+
+static void onInferenceImageAvailable(void *context, AImageReader *reader) {
+    NdkCamera *camera = (NdkCamera *) context;
+    deliver_image(camera, reader, true);
+}
+
 NdkCamera::NdkCamera() {
     camera_facing = 0;
     camera_orientation = 0;
+    timestamp_source = ACAMERA_SENSOR_INFO_TIMESTAMP_SOURCE_UNKNOWN;
+
+    stream_sizes = choose_stream_sizes(std::vector<StreamSize>(), 0, 0, 0, 0);
+    dual_stream = false;
+
+    target_window_w = 0;
+    target_window_h = 0;
+    target_yolopv2_size = 0;
+    target_yolov8_size = 0;
 
     camera_manager = 0;
     camera_device = 0;
     image_reader = 0;
     image_reader_surface = 0;
     image_reader_target = 0;
+    inference_image_reader = 0;
+    inference_image_reader_surface = 0;
+    inference_image_reader_target = 0;
     capture_request = 0;
     capture_session_output_container = 0;
     capture_session_output = 0;
+    inference_capture_session_output = 0;
     capture_session = 0;
+}
 
-    {
-        AImageReader_new(640, 480, AIMAGE_FORMAT_YUV_420_888, /*maxImages*/2, &image_reader);
+NdkCamera::~NdkCamera() {
+    std::lock_guard<std::mutex> lock(camera_mutex);
 
-        AImageReader_ImageListener listener;
-        listener.context = this;
-        listener.onImageAvailable = onImageAvailable;
+    close_camera();
 
-        AImageReader_setImageListener(image_reader, &listener);
+    delete_image_readers();
+}
 
-        AImageReader_getWindow(image_reader, &image_reader_surface);
+static AImageReader *create_image_reader(const StreamSize &size, AImageReader_ImageCallback callback,
+                                         void *context, ANativeWindow **surface) {
+    AImageReader *reader = 0;
+    AImageReader_new(size.width, size.height, AIMAGE_FORMAT_YUV_420_888, /*maxImages*/2, &reader);
 
-        ANativeWindow_acquire(image_reader_surface);
-    }
+    AImageReader_ImageListener listener;
+    listener.context = context;
+    listener.onImageAvailable = callback;
+
+    AImageReader_setImageListener(reader, &listener);
+
+    AImageReader_getWindow(reader, surface);
+
+    ANativeWindow_acquire(*surface);
+
+    return reader;
 }
 
-NdkCamera::~NdkCamera() {
-    close();
+void NdkCamera::create_image_readers() {
+    image_reader = create_image_reader(stream_sizes.display, onImageAvailable, this,
+                                       &image_reader_surface);
+
+    if (stream_sizes.dual()) {
+        inference_image_reader = create_image_reader(stream_sizes.inference,
+                                                     onInferenceImageAvailable, this,
+                                                     &inference_image_reader_surface);
+    }
+}
 
+void NdkCamera::delete_image_readers() {
     if (image_reader) {
         AImageReader_delete(image_reader);
         image_reader = 0;
@@ -134,9 +182,60 @@ NdkCamera::~NdkCamera() {
         ANativeWindow_release(image_reader_surface);
         image_reader_surface = 0;
     }
+
+    if (inference_image_reader) {
+        AImageReader_delete(inference_image_reader);
+        inference_image_reader = 0;
+    }
+
+    if (inference_image_reader_surface) {
+        ANativeWindow_release(inference_image_reader_surface);
+        inference_image_reader_surface = 0;
+    }
+}
+
+void NdkCamera::set_display_target(int window_w, int window_h) {
+    std::lock_guard<std::mutex> lock(camera_mutex);
+    target_window_w = window_w;
+    target_window_h = window_h;
+    update_stream_sizes();
+}
+
+void NdkCamera::set_inference_targets(int yolopv2_target_size, int yolov8_target_size) {
+    std::lock_guard<std::mutex> lock(camera_mutex);
+    target_yolopv2_size = yolopv2_target_size;
+    target_yolov8_size = yolov8_target_size;
+    update_stream_sizes();
+}
+
+void NdkCamera::update_stream_sizes() {
+    if (!camera_device)
+        return;
+
+    StreamSizes sizes = choose_stream_sizes(available_sizes, target_window_w, target_window_h,
+                                            target_yolopv2_size, target_yolov8_size);
+    if (sizes.display.width == stream_sizes.display.width &&
+        sizes.display.height == stream_sizes.display.height &&
+        sizes.inference.width == stream_sizes.inference.width &&
+        sizes.inference.height == stream_sizes.inference.height)
+        return;
+
+    // 输出尺寸只能在建立会话时指定, 只重开相机, 其余线程照常运行
+    close_camera();
+    open_camera(camera_facing);
 }
 
 int NdkCamera::open(int _camera_facing) {
+    std::lock_guard<std::mutex> lock(camera_mutex);
+    return open_camera(_camera_facing);
+}
+
+void NdkCamera::close() {
+    std::lock_guard<std::mutex> lock(camera_mutex);
+    close_camera();
+}
+
+int NdkCamera::open_camera(int _camera_facing) {
 
     camera_facing = _camera_facing;
     camera_manager = ACameraManager_create();
@@ -183,6 +282,35 @@ int NdkCamera::open(int _camera_facing) {
 
             camera_orientation = orientation;
 
+            // query timestamp source
+            {
+                ACameraMetadata_const_entry e = {0};
+                if (ACameraMetadata_getConstEntry(camera_metadata,
+                                                  ACAMERA_SENSOR_INFO_TIMESTAMP_SOURCE, &e) ==
+                    ACAMERA_OK) {
+                    timestamp_source = e.data.u8[0];
+                }
+            }
+
+            // query yuv output sizes
+            available_sizes.clear();
+            {
+                ACameraMetadata_const_entry e = {0};
+                if (ACameraMetadata_getConstEntry(camera_metadata,
+                                                  ACAMERA_SCALER_AVAILABLE_STREAM_CONFIGURATIONS,
+                                                  &e) == ACAMERA_OK) {
+                    // format, width, height, input
+                    for (uint32_t j = 0; j + 3 < e.count; j += 4) {
+                        if (e.data.i32[j] != AIMAGE_FORMAT_YUV_420_888 ||
+                            e.data.i32[j + 3] != ACAMERA_SCALER_AVAILABLE_STREAM_CONFIGURATIONS_OUTPUT)
+                            continue;
+
+                        StreamSize size = {e.data.i32[j + 1], e.data.i32[j + 2]};
+                        available_sizes.push_back(size);
+                    }
+                }
+            }
+
             ACameraMetadata_free(camera_metadata);
 
             break;
@@ -191,6 +319,26 @@ int NdkCamera::open(int _camera_facing) {
         ACameraManager_deleteCameraIdList(camera_id_list);
     }
 
+    // image readers of the picked sizes, kept across reopens while the sizes stay the same
+    {
+        StreamSizes sizes = choose_stream_sizes(available_sizes, target_window_w, target_window_h,
+                                                target_yolopv2_size, target_yolov8_size);
+        if (!image_reader || sizes.display.width != stream_sizes.display.width ||
+            sizes.display.height != stream_sizes.display.height ||
+            sizes.inference.width != stream_sizes.inference.width ||
+            sizes.inference.height != stream_sizes.inference.height) {
+            delete_image_readers();
+            stream_sizes = sizes;
+            create_image_readers();
+        }
+
+        dual_stream = stream_sizes.dual();
+
+        __android_log_print(ANDROID_LOG_WARN, "NdkCamera", "display %dx%d  inference %dx%d",
+                            stream_sizes.display.width, stream_sizes.display.height,
+                            stream_sizes.inference.width, stream_sizes.inference.height);
+    }
+
     // open camera
     {
         ACameraDevice_StateCallbacks camera_device_state_callbacks;
@@ -208,6 +356,13 @@ int NdkCamera::open(int _camera_facing) {
 
         ACameraOutputTarget_create(image_reader_surface, &image_reader_target);
         ACaptureRequest_addTarget(capture_request, image_reader_target);
+
+        // both streams in one request, so their frames carry the same sensor timestamp
+        if (inference_image_reader) {
+            ACameraOutputTarget_create(inference_image_reader_surface,
+                                       &inference_image_reader_target);
+            ACaptureRequest_addTarget(capture_request, inference_image_reader_target);
+        }
     }
 
     // capture session
@@ -225,6 +380,14 @@ int NdkCamera::open(int _camera_facing) {
         ACaptureSessionOutputContainer_add(capture_session_output_container,
                                            capture_session_output);
 
+        if (inference_image_reader) {
+            ACaptureSessionOutput_create(inference_image_reader_surface,
+                                         &inference_capture_session_output);
+
+            ACaptureSessionOutputContainer_add(capture_session_output_container,
+                                               inference_capture_session_output);
+        }
+
         ACameraDevice_createCaptureSession(camera_device, capture_session_output_container,
                                            &camera_capture_session_state_callbacks,
                                            &capture_session);
@@ -247,7 +410,7 @@ int NdkCamera::open(int _camera_facing) {
     return 0;
 }
 
-void NdkCamera::close() {
+void NdkCamera::close_camera() {
     __android_log_print(ANDROID_LOG_WARN, "NdkCamera", "close");
 
     if (capture_session) {
@@ -271,6 +434,11 @@ void NdkCamera::close() {
         capture_session_output = 0;
     }
 
+    if (inference_capture_session_output) {
+        ACaptureSessionOutput_free(inference_capture_session_output);
+        inference_capture_session_output = 0;
+    }
+
     if (capture_request) {
         ACaptureRequest_free(capture_request);
         capture_request = 0;
@@ -281,6 +449,11 @@ void NdkCamera::close() {
         image_reader_target = 0;
     }
 
+    if (inference_image_reader_target) {
+        ACameraOutputTarget_free(inference_image_reader_target);
+        inference_image_reader_target = 0;
+    }
+
     if (camera_manager) {
         ACameraManager_delete(camera_manager);
         camera_manager = 0;
@@ -290,7 +463,27 @@ void NdkCamera::close() {
 void NdkCamera::on_image(const cv::Mat &rgb) const {
 }
 
-void NdkCamera::on_image(const unsigned char *nv21, int nv21_width, int nv21_height) const {
+void NdkCamera::on_yuv420_image(const Yuv420Plane &y, const Yuv420Plane &u, const Yuv420Plane &v,
+                                int width, int height, int64_t timestamp, bool inference) {
+    // construct nv21 into the reusable buffer
+    cv::Mat &buffer = inference ? inference_nv21_buffer : nv21_buffer;
+    buffer.create(height + height / 2, width, CV_8UC1);
+    yuv420_888_to_nv21(y, u, v, width, height, buffer.data);
+    count_frame_copy(buffer.total());
+
+    if (inference) {
+        on_inference_image(buffer.data, width, height, timestamp);
+    } else {
+        on_image(buffer.data, width, height, timestamp);
+    }
+}
+
+void NdkCamera::on_inference_image(const unsigned char *nv21, int nv21_width, int nv21_height,
+                                   int64_t timestamp) const {
+}
+
+void NdkCamera::on_image(const unsigned char *nv21, int nv21_width, int nv21_height,
+                         int64_t timestamp) const {
     // rotate nv21
     int w = 0;
     int h = 0;
@@ -331,11 +524,99 @@ void NdkCamera::on_image(const unsigned char *nv21, int nv21_width, int nv21_hei
 
 static const int NDKCAMERAWINDOW_ID = 233;
 
+#if __ANDROID_API__ >= 24
+// vsync from the display through AChoreographer, on a looper owned by the render thread
+class ChoreographerVsync : public VsyncSource {
+public:
+    ChoreographerVsync() : looper(0), choreographer(0), frame_time(0), woken(false) {
+    }
+
+    virtual ~ChoreographerVsync() {
+        if (looper) {
+            ALooper_release(looper);
+        }
+    }
+
+    virtual void attach() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!looper) {
+            looper = ALooper_prepare(ALOOPER_PREPARE_ALLOW_NON_CALLBACKS);
+            ALooper_acquire(looper);
+        }
+        choreographer = AChoreographer_getInstance();
+        woken = false;
+    }
+
+    virtual int64_t wait() {
+        if (!choreographer)
+            return -1;
+
+        frame_time = 0;
+        AChoreographer_postFrameCallback(choreographer, on_frame, this);
+        while (frame_time == 0) {
+            if (woken)
+                return -1;
+            ALooper_pollOnce(-1, 0, 0, 0);
+        }
+        return woken ? -1 : frame_time;
+    }
+
+    virtual void wake() {
+        std::lock_guard<std::mutex> lock(mutex);
+        woken = true;
+        if (looper) {
+            ALooper_wake(looper);
+        }
+    }
+
+private:
+    static void on_frame(long frame_time_nanos, void *data) {
+        ChoreographerVsync *vsync = (ChoreographerVsync *) data;
+
+        // long is 32 bit on armeabi-v7a, restore the high bits from the current monotonic time
+        int64_t t = frame_time_nanos;
+        if (sizeof(long) < sizeof(int64_t)) {
+            const int64_t now = frame_timestamp_now();
+            t = now - (int64_t) (uint32_t) ((uint32_t) now - (uint32_t) frame_time_nanos);
+        }
+        vsync->frame_time = t;
+    }
+
+private:
+    std::mutex mutex;
+    ALooper *looper;
+    AChoreographer *choreographer;
+    int64_t frame_time;
+    std::atomic<bool> woken;
+};
+#endif
+
+class NdkCameraWindowRenderLoop : public RenderLoop {
+public:
+    NdkCameraWindowRenderLoop(NdkCameraWindow *_window, VsyncSource *vsync)
+            : RenderLoop(vsync), window(_window) {
+    }
+
+    virtual ~NdkCameraWindowRenderLoop() {
+        stop();
+    }
+
+protected:
+    virtual bool render(int64_t vsync) {
+        return window->render_newest();
+    }
+
+private:
+    NdkCameraWindow *window;
+};
+
 NdkCameraWindow::NdkCameraWindow() : NdkCamera() {
     sensor_manager = 0;
-    sensor_event_queue = 0;
     accelerometer_sensor = 0;
+    sensor_stop = false;
+    sensor_looper = 0;
     win = 0;
+    display_zoom = 1.f;
 
     accelerometer_orientation = 0;
 
@@ -344,78 +625,205 @@ NdkCameraWindow::NdkCameraWindow() : NdkCamera() {
 
     accelerometer_sensor = ASensorManager_getDefaultSensor(sensor_manager,
                                                            ASENSOR_TYPE_ACCELEROMETER);
+
+#if __ANDROID_API__ >= 24
+    render_loop = new NdkCameraWindowRenderLoop(this, new ChoreographerVsync);
+#else
+    render_loop = new NdkCameraWindowRenderLoop(this, new PeriodicVsync);
+#endif
 }
 
 NdkCameraWindow::~NdkCameraWindow() {
-    if (accelerometer_sensor) {
-        ASensorEventQueue_disableSensor(sensor_event_queue, accelerometer_sensor);
-        accelerometer_sensor = 0;
-    }
+    stop_threads();
 
-    if (sensor_event_queue) {
-        ASensorManager_destroyEventQueue(sensor_manager, sensor_event_queue);
-        sensor_event_queue = 0;
-    }
+    delete render_loop;
+    render_loop = 0;
 
     if (win) {
         ANativeWindow_release(win);
     }
 }
 
+int NdkCameraWindow::open(int _camera_facing) {
+    start_threads();
+    return NdkCamera::open(_camera_facing);
+}
+
+void NdkCameraWindow::close() {
+    NdkCamera::close();
+    stop_threads();
+}
+
 void NdkCameraWindow::set_window(ANativeWindow *_win) {
-    if (win) {
-        ANativeWindow_release(win);
+    {
+        std::lock_guard<std::mutex> lock(window_mutex);
+
+        if (win) {
+            ANativeWindow_release(win);
+        }
+
+        win = _win;
+        ANativeWindow_acquire(win);
     }
 
-    win = _win;
-    ANativeWindow_acquire(win);
+    set_display_target(ANativeWindow_getWidth(_win), ANativeWindow_getHeight(_win));
 }
 
-void NdkCameraWindow::on_image_render(cv::Mat &rgb) const {
+void NdkCameraWindow::set_max_fps(float fps) {
+    render_loop->set_min_interval(fps > 0 ? (int64_t) (1000000000.0 / fps) : 0);
 }
 
-void NdkCameraWindow::on_image(const unsigned char *nv21, int nv21_width, int nv21_height) const {
-    // resolve orientation from camera_orientation and accelerometer_sensor
-    {
-        if (!sensor_event_queue) {
-            sensor_event_queue = ASensorManager_createEventQueue(sensor_manager, ALooper_prepare(
-                    ALOOPER_PREPARE_ALLOW_NON_CALLBACKS), NDKCAMERAWINDOW_ID, 0, 0);
+void NdkCameraWindow::set_zoom(float zoom) {
+    display_zoom = zoom;
+}
 
-            ASensorEventQueue_enableSensor(sensor_event_queue, accelerometer_sensor);
-        }
+PacingStats NdkCameraWindow::pacing_stats() const {
+    return render_loop->pacing_stats();
+}
 
-        int id = ALooper_pollAll(0, 0, 0, 0);
-        if (id == NDKCAMERAWINDOW_ID) {
-            ASensorEvent e[8];
-            ssize_t num_event = 0;
-            while (ASensorEventQueue_hasEvents(sensor_event_queue) == 1) {
-                num_event = ASensorEventQueue_getEvents(sensor_event_queue, e, 8);
-                if (num_event < 0)
-                    break;
+void NdkCameraWindow::start_threads() {
+    if (accelerometer_sensor && !sensor_thread.joinable()) {
+        sensor_stop = false;
+        sensor_thread = std::thread(&NdkCameraWindow::sensor_loop, this);
+    }
+
+    render_loop->start();
+}
+
+void NdkCameraWindow::stop_threads() {
+    render_loop->stop();
+
+    if (sensor_thread.joinable()) {
+        sensor_stop = true;
+        {
+            std::lock_guard<std::mutex> lock(sensor_mutex);
+            if (sensor_looper) {
+                ALooper_wake(sensor_looper);
             }
+        }
+        sensor_thread.join();
 
-            if (num_event > 0) {
-                float acceleration_x = e[num_event - 1].acceleration.x;
-                float acceleration_y = e[num_event - 1].acceleration.y;
-                float acceleration_z = e[num_event - 1].acceleration.z;
-//                 __android_log_print(ANDROID_LOG_WARN, "NdkCameraWindow", "x = %f, y = %f, z = %f", x, y, z);
+        ALooper_release(sensor_looper);
+        sensor_looper = 0;
+    }
+}
 
-                if (acceleration_y > 7) {
-                    accelerometer_orientation = 0;
-                }
-                if (acceleration_x < -7) {
-                    accelerometer_orientation = 90;
-                }
-                if (acceleration_y < -7) {
-                    accelerometer_orientation = 180;
-                }
-                if (acceleration_x > 7) {
-                    accelerometer_orientation = 270;
-                }
+void NdkCameraWindow::sensor_loop() {
+    ALooper *looper = ALooper_prepare(ALOOPER_PREPARE_ALLOW_NON_CALLBACKS);
+    ALooper_acquire(looper);
+    {
+        std::lock_guard<std::mutex> lock(sensor_mutex);
+        sensor_looper = looper;
+    }
+
+    ASensorEventQueue *sensor_event_queue = ASensorManager_createEventQueue(sensor_manager, looper,
+                                                                            NDKCAMERAWINDOW_ID, 0, 0);
+    ASensorEventQueue_enableSensor(sensor_event_queue, accelerometer_sensor);
+
+    // resolve orientation from the accelerometer, blocks until events arrive or stop_threads wakes us
+    while (!sensor_stop) {
+        int id = ALooper_pollOnce(-1, 0, 0, 0);
+        if (id != NDKCAMERAWINDOW_ID)
+            continue;
+
+        ASensorEvent e[8];
+        ssize_t num_event = 0;
+        while (ASensorEventQueue_hasEvents(sensor_event_queue) == 1) {
+            num_event = ASensorEventQueue_getEvents(sensor_event_queue, e, 8);
+            if (num_event < 0)
+                break;
+        }
+
+        if (num_event > 0) {
+            float acceleration_x = e[num_event - 1].acceleration.x;
+            float acceleration_y = e[num_event - 1].acceleration.y;
+            float acceleration_z = e[num_event - 1].acceleration.z;
+//             __android_log_print(ANDROID_LOG_WARN, "NdkCameraWindow", "x = %f, y = %f, z = %f", x, y, z);
+
+            if (acceleration_y > 7) {
+                accelerometer_orientation = 0;
+            }
+            if (acceleration_x < -7) {
+                accelerometer_orientation = 90;
+            }
+            if (acceleration_y < -7) {
+                accelerometer_orientation = 180;
+            }
+            if (acceleration_x > 7) {
+                accelerometer_orientation = 270;
             }
         }
     }
 
+    ASensorEventQueue_disableSensor(sensor_event_queue, accelerometer_sensor);
+    ASensorManager_destroyEventQueue(sensor_manager, sensor_event_queue);
+}
+
+void NdkCameraWindow::on_image_render(cv::Mat &rgba, float zoom, const Nv21Roi &roi,
+                                      int64_t timestamp) const {
+}
+
+// 相机回调里只写一份, 尽快把 AImage 还给 AImageReader, 其余的都在渲染线程做
+CameraFrame &NdkCameraWindow::begin_frame(int nv21_width, int nv21_height, bool inference) const {
+    CameraFrame &frame = inference ? inference_frames.write_buffer() : camera_frames.write_buffer();
+    frame.nv21.create(nv21_height + nv21_height / 2, nv21_width, CV_8UC1);
+    count_frame_copy(frame.nv21.total());
+    return frame;
+}
+
+void NdkCameraWindow::publish_frame(CameraFrame &frame, int nv21_width, int nv21_height,
+                                    int64_t timestamp, bool inference) const {
+    frame.width = nv21_width;
+    frame.height = nv21_height;
+    frame.timestamp = timestamp;
+    if (inference) {
+        inference_frames.publish(timestamp);
+    } else {
+        camera_frames.publish();
+    }
+}
+
+void NdkCameraWindow::on_image(const unsigned char *nv21, int nv21_width, int nv21_height,
+                               int64_t timestamp) const {
+    CameraFrame &frame = begin_frame(nv21_width, nv21_height, false);
+    memcpy(frame.nv21.data, nv21, frame.nv21.total());
+    publish_frame(frame, nv21_width, nv21_height, timestamp, false);
+}
+
+void NdkCameraWindow::on_inference_image(const unsigned char *nv21, int nv21_width,
+                                         int nv21_height, int64_t timestamp) const {
+    CameraFrame &frame = begin_frame(nv21_width, nv21_height, true);
+    memcpy(frame.nv21.data, nv21, frame.nv21.total());
+    publish_frame(frame, nv21_width, nv21_height, timestamp, true);
+}
+
+void NdkCameraWindow::on_yuv420_image(const Yuv420Plane &y, const Yuv420Plane &u,
+                                      const Yuv420Plane &v, int width, int height,
+                                      int64_t timestamp, bool inference) {
+    // 不是 nv21 排布时直接重排进交给渲染线程的那一份, 不经过 nv21_buffer 再拷一遍
+    CameraFrame &frame = begin_frame(width, height, inference);
+    yuv420_888_to_nv21(y, u, v, width, height, frame.nv21.data);
+    publish_frame(frame, width, height, timestamp, inference);
+}
+
+bool NdkCameraWindow::render_newest() {
+    // 没有新的相机帧就不重画
+    if (!camera_frames.acquire())
+        return false;
+
+    std::lock_guard<std::mutex> lock(window_mutex);
+    if (!win)
+        return false;
+
+    const CameraFrame &frame = camera_frames.read_buffer();
+    const unsigned char *nv21 = frame.nv21.data;
+    const int nv21_width = frame.width;
+    const int nv21_height = frame.height;
+    const int64_t timestamp = frame.timestamp;
+
+    // 一帧内只读一次方向, 传感器线程随时会改
+    const int device_orientation = accelerometer_orientation;
+
     // roi crop and rotate nv21
     int nv21_roi_x = 0;
     int nv21_roi_y = 0;
@@ -433,11 +841,11 @@ void NdkCameraWindow::on_image(const unsigned char *nv21, int nv21_width, int nv
         int win_w = ANativeWindow_getWidth(win);
         int win_h = ANativeWindow_getHeight(win);
 
-        if (accelerometer_orientation == 90 || accelerometer_orientation == 270) {
+        if (device_orientation == 90 || device_orientation == 270) {
             std::swap(win_w, win_h);
         }
 
-        const int final_orientation = (camera_orientation + accelerometer_orientation) % 360;
+        const int final_orientation = (camera_orientation + device_orientation) % 360;
 
         if (final_orientation == 0 || final_orientation == 180) {
             if (win_w * nv21_height > win_h * nv21_width) {
@@ -477,52 +885,52 @@ void NdkCameraWindow::on_image(const unsigned char *nv21, int nv21_width, int nv
         }
 
         if (camera_facing == 0) {
-            if (camera_orientation == 0 && accelerometer_orientation == 0) {
+            if (camera_orientation == 0 && device_orientation == 0) {
                 rotate_type = 2;
             }
-            if (camera_orientation == 0 && accelerometer_orientation == 90) {
+            if (camera_orientation == 0 && device_orientation == 90) {
                 rotate_type = 7;
             }
-            if (camera_orientation == 0 && accelerometer_orientation == 180) {
+            if (camera_orientation == 0 && device_orientation == 180) {
                 rotate_type = 4;
             }
-            if (camera_orientation == 0 && accelerometer_orientation == 270) {
+            if (camera_orientation == 0 && device_orientation == 270) {
                 rotate_type = 5;
             }
-            if (camera_orientation == 90 && accelerometer_orientation == 0) {
+            if (camera_orientation == 90 && device_orientation == 0) {
                 rotate_type = 5;
             }
-            if (camera_orientation == 90 && accelerometer_orientation == 90) {
+            if (camera_orientation == 90 && device_orientation == 90) {
                 rotate_type = 2;
             }
-            if (camera_orientation == 90 && accelerometer_orientation == 180) {
+            if (camera_orientation == 90 && device_orientation == 180) {
                 rotate_type = 7;
             }
-            if (camera_orientation == 90 && accelerometer_orientation == 270) {
+            if (camera_orientation == 90 && device_orientation == 270) {
                 rotate_type = 4;
             }
-            if (camera_orientation == 180 && accelerometer_orientation == 0) {
+            if (camera_orientation == 180 && device_orientation == 0) {
                 rotate_type = 4;
             }
-            if (camera_orientation == 180 && accelerometer_orientation == 90) {
+            if (camera_orientation == 180 && device_orientation == 90) {
                 rotate_type = 5;
             }
-            if (camera_orientation == 180 && accelerometer_orientation == 180) {
+            if (camera_orientation == 180 && device_orientation == 180) {
                 rotate_type = 2;
             }
-            if (camera_orientation == 180 && accelerometer_orientation == 270) {
+            if (camera_orientation == 180 && device_orientation == 270) {
                 rotate_type = 7;
             }
-            if (camera_orientation == 270 && accelerometer_orientation == 0) {
+            if (camera_orientation == 270 && device_orientation == 0) {
                 rotate_type = 7;
             }
-            if (camera_orientation == 270 && accelerometer_orientation == 90) {
+            if (camera_orientation == 270 && device_orientation == 90) {
                 rotate_type = 4;
             }
-            if (camera_orientation == 270 && accelerometer_orientation == 180) {
+            if (camera_orientation == 270 && device_orientation == 180) {
                 rotate_type = 5;
             }
-            if (camera_orientation == 270 && accelerometer_orientation == 270) {
+            if (camera_orientation == 270 && device_orientation == 270) {
                 rotate_type = 2;
             }
         } else {
@@ -540,94 +948,113 @@ void NdkCameraWindow::on_image(const unsigned char *nv21, int nv21_width, int nv
             }
         }
 
-        if (accelerometer_orientation == 0) {
+        if (device_orientation == 0) {
             render_w = roi_w;
             render_h = roi_h;
             render_rotate_type = 1;
         }
-        if (accelerometer_orientation == 90) {
+        if (device_orientation == 90) {
             render_w = roi_h;
             render_h = roi_w;
             render_rotate_type = 8;
         }
-        if (accelerometer_orientation == 180) {
+        if (device_orientation == 180) {
             render_w = roi_w;
             render_h = roi_h;
             render_rotate_type = 3;
         }
-        if (accelerometer_orientation == 270) {
+        if (device_orientation == 270) {
             render_w = roi_h;
             render_h = roi_w;
             render_rotate_type = 6;
         }
     }
 
-    // crop and rotate nv21
-    cv::Mat nv21_croprotated(roi_h + roi_h / 2, roi_w, CV_8UC1);
-    {
-        const unsigned char *srcY = nv21 + nv21_roi_y * nv21_width + nv21_roi_x;
-        unsigned char *dstY = nv21_croprotated.data;
-        ncnn::kanna_rotate_c1(srcY, nv21_roi_w, nv21_roi_h, nv21_width, dstY, roi_w, roi_h, roi_w,
-                              rotate_type);
+    ANativeWindow_setBuffersGeometry(win, render_w, render_h,
+                                     AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
+
+    ANativeWindow_Buffer buf;
+    if (ANativeWindow_lock(win, &buf, NULL) != 0)
+        return false;
 
-        const unsigned char *srcUV =
-                nv21 + nv21_width * nv21_height + nv21_roi_y * nv21_width / 2 + nv21_roi_x;
-        unsigned char *dstUV = nv21_croprotated.data + roi_w * roi_h;
-        ncnn::kanna_rotate_c2(srcUV, nv21_roi_w / 2, nv21_roi_h / 2, nv21_width, dstUV, roi_w / 2,
-                              roi_h / 2, roi_w, rotate_type);
+    if (buf.format != AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM &&
+        buf.format != AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM) {
+        ANativeWindow_unlockAndPost(win);
+        return false;
     }
 
-    // nv21_croprotated to rgb
-    cv::Mat rgb(roi_h, roi_w, CV_8UC3);
-    ncnn::yuv420sp2rgb(nv21_croprotated.data, roi_w, roi_h, rgb.data);
+    // 竖屏时转正后的画面就是窗口方向, 直接转换进窗口缓冲区并在上面叠加
+    // 其余方向叠加的文字要保持正向, 先画在复用的转正画面上, 再整体旋转进窗口
+    cv::Mat rgba;
+    if (render_rotate_type == 1) {
+        rgba = cv::Mat(roi_h, roi_w, CV_8UC4, buf.bits, buf.stride * 4);
+    } else {
+        rgba_upright.create(roi_h, roi_w, CV_8UC4);
+        rgba = rgba_upright;
+    }
 
-    on_image_render(rgb);
+    // 数码变焦只转换 nv21 中心 1/zoom 区域, 再直接缩放到显示大小
+    const float zoom = display_zoom;
+    Nv21Roi roi = {nv21, nv21_width, nv21_height, nv21_roi_x, nv21_roi_y, nv21_roi_w, nv21_roi_h,
+                   rotate_type};
+    const Nv21Roi view = nv21_roi_zoom(roi, zoom);
+    const int view_w = view.upright_w();
+    const int view_h = view.upright_h();
+
+    cv::Mat view_rgba = rgba;
+    if (view_w != roi_w || view_h != roi_h) {
+        rgba_zoomed.create(view_h, view_w, CV_8UC4);
+        view_rgba = rgba_zoomed;
+    }
 
-    // rotate to native window orientation
-    cv::Mat rgb_render(render_h, render_w, CV_8UC3);
-    ncnn::kanna_rotate_c3(rgb.data, roi_w, roi_h, rgb_render.data, render_w, render_h,
-                          render_rotate_type);
+    // crop and rotate nv21, the roi is read in place when no rotation is needed
+    const unsigned char *srcY = nv21 + view.roi_y * nv21_width + view.roi_x;
+    const unsigned char *srcUV =
+            nv21 + nv21_width * nv21_height + view.roi_y * nv21_width / 2 + view.roi_x;
+    if (rotate_type == 1) {
+        nv21_to_rgba(srcY, nv21_width, srcUV, nv21_width, view_w, view_h, view_rgba.data,
+                     (int) view_rgba.step[0]);
+    } else {
+        nv21_croprotated.create(view_h + view_h / 2, view_w, CV_8UC1);
 
-    ANativeWindow_setBuffersGeometry(win, render_w, render_h,
-                                     AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM);
+        unsigned char *dstY = nv21_croprotated.data;
+        ncnn::kanna_rotate_c1(srcY, view.roi_w, view.roi_h, nv21_width, dstY, view_w, view_h,
+                              view_w, rotate_type);
 
-    ANativeWindow_Buffer buf;
-    ANativeWindow_lock(win, &buf, NULL);
-
-    // scale to target size
-    if (buf.format == AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM ||
-        buf.format == AHARDWAREBUFFER_FORMAT_R8G8B8X8_UNORM) {
-        for (int y = 0; y < render_h; y++) {
-            const unsigned char *ptr = rgb_render.ptr<const unsigned char>(y);
-            unsigned char *outptr = (unsigned char *) buf.bits + buf.stride * 4 * y;
-
-            int x = 0;
-#if __ARM_NEON
-            for (; x + 7 < render_w; x += 8)
-            {
-                uint8x8x3_t _rgb = vld3_u8(ptr);
-                uint8x8x4_t _rgba;
-                _rgba.val[0] = _rgb.val[0];
-                _rgba.val[1] = _rgb.val[1];
-                _rgba.val[2] = _rgb.val[2];
-                _rgba.val[3] = vdup_n_u8(255);
-                vst4_u8(outptr, _rgba);
-
-                ptr += 24;
-                outptr += 32;
-            }
-#endif // __ARM_NEON
-            for (; x < render_w; x++) {
-                outptr[0] = ptr[0];
-                outptr[1] = ptr[1];
-                outptr[2] = ptr[2];
-                outptr[3] = 255;
-
-                ptr += 3;
-                outptr += 4;
-            }
+        unsigned char *dstUV = nv21_croprotated.data + view_w * view_h;
+        ncnn::kanna_rotate_c2(srcUV, view.roi_w / 2, view.roi_h / 2, nv21_width, dstUV, view_w / 2,
+                              view_h / 2, view_w, rotate_type);
+
+        nv21_to_rgba(dstY, view_w, dstUV, view_w, view_w, view_h, view_rgba.data,
+                     (int) view_rgba.step[0]);
+    }
+
+    if (view_rgba.data != rgba.data) {
+        cv::resize(view_rgba, rgba, rgba.size(), 0, 0, cv::INTER_LINEAR);
+    }
+
+    int64_t roi_timestamp = timestamp;
+    if (dual_stream) {
+        // 推理用同一次采集的小图, 还没到就用没送过的最新一帧, 两路视野相同只差缩放
+        // 时间戳换算到单调时钟时两路各算一次偏移, 留 1ms 余量
+        if (inference_frames.acquire(timestamp, 1000000) || inference_frames.acquire_newest()) {
+            const CameraFrame &inference = inference_frames.read_buffer();
+            roi = rescale_roi(roi, inference.nv21.data, inference.width, inference.height);
+            roi_timestamp = inference.timestamp;
+        } else {
+            roi.nv21 = 0;
         }
     }
+    on_image_render(rgba, zoom, roi, roi_timestamp);
+
+    // rotate to native window orientation
+    if (render_rotate_type != 1) {
+        ncnn::kanna_rotate_c4(rgba_upright.data, roi_w, roi_h, (int) rgba_upright.step[0],
+                              (unsigned char *) buf.bits, render_w, render_h, buf.stride * 4,
+                              render_rotate_type);
+    }
 
     ANativeWindow_unlockAndPost(win);
+
+    return true;
 }
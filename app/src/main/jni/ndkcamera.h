@@ -9,33 +9,95 @@
 #include <camera/NdkCameraMetadata.h>
 #include <media/NdkImageReader.h>
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <opencv2/core/core.hpp>
 
-class NdkCamera
+#include "framebuffer.h"
+#include "framepair.h"
+#include "framesource.h"
+#include "renderloop.h"
+#include "yuv420.h"
+
+class NdkCamera : public FrameSource
 {
 public:
     NdkCamera();
     virtual ~NdkCamera();
     // facing 0=front 1=back
     int open(int camera_facing = 1);
-    void close();
+    virtual void close();
     virtual void on_image(const cv::Mat& rgb) const;
-    virtual void on_image(const unsigned char* nv21, int nv21_width, int nv21_height) const;
+    virtual void on_image(const unsigned char* nv21, int nv21_width, int nv21_height, int64_t timestamp) const;
+    // frames of the smaller inference stream, only called while two streams are open
+    virtual void on_inference_image(const unsigned char* nv21, int nv21_width, int nv21_height, int64_t timestamp) const;
+    // images of either stream whose planes are not laid out as nv21
+    // the default repacks into nv21_buffer / inference_nv21_buffer and calls on_image / on_inference_image
+    virtual void on_yuv420_image(const Yuv420Plane& y, const Yuv420Plane& u, const Yuv420Plane& v, int width, int height, int64_t timestamp, bool inference);
+
+    // stream sizes are picked by choose_stream_sizes() from these, 0 keeps a single 640x480 stream
+    // an open camera is reopened when the sizes change, so call them from the thread that opens and closes it
+    void set_display_target(int window_w, int window_h);
+    void set_inference_targets(int yolopv2_target_size, int yolov8_target_size);
 
 public:
     int camera_facing;
     int camera_orientation;
+    // ACAMERA_SENSOR_INFO_TIMESTAMP_SOURCE of the opened camera
+    int timestamp_source;
+
+    // sizes of the opened session, on_image gets the display stream
+    StreamSizes stream_sizes;
+    std::atomic<bool> dual_stream;
+
+    // nv21 repack target for non-nv21 plane layouts, reused across frames
+    cv::Mat nv21_buffer;
+    cv::Mat inference_nv21_buffer;
 
 private:
+    // callers hold camera_mutex
+    int open_camera(int camera_facing);
+    void close_camera();
+    void update_stream_sizes();
+    void create_image_readers();
+    void delete_image_readers();
+
+private:
+    // yuv output sizes of the opened camera
+    std::vector<StreamSize> available_sizes;
+    int target_window_w;
+    int target_window_h;
+    int target_yolopv2_size;
+    int target_yolov8_size;
+
     ACameraManager* camera_manager;
     ACameraDevice* camera_device;
     AImageReader* image_reader;
     ANativeWindow* image_reader_surface;
     ACameraOutputTarget* image_reader_target;
+    AImageReader* inference_image_reader;
+    ANativeWindow* inference_image_reader_surface;
+    ACameraOutputTarget* inference_image_reader_target;
     ACaptureRequest* capture_request;
     ACaptureSessionOutputContainer* capture_session_output_container;
     ACaptureSessionOutput* capture_session_output;
+    ACaptureSessionOutput* inference_capture_session_output;
     ACameraCaptureSession* capture_session;
+
+    // open, close and the reopen on a size change, each runs whole
+    std::mutex camera_mutex;
+};
+
+// nv21 frame handed from the camera callback to the render thread
+struct CameraFrame
+{
+    cv::Mat nv21;
+    int width;
+    int height;
+    int64_t timestamp;
 };
 
 class NdkCameraWindow : public NdkCamera
@@ -43,18 +105,62 @@ class NdkCameraWindow : public NdkCamera
 public:
     NdkCameraWindow();
     virtual ~NdkCameraWindow();
+    // also starts the sensor and render threads
+    int open(int camera_facing = 1);
+    virtual void close();
     void set_window(ANativeWindow* win);
-    virtual void on_image_render(cv::Mat& rgb) const;
-    virtual void on_image(const unsigned char* nv21, int nv21_width, int nv21_height) const;
+    // cap the present rate, 0 presents every new camera frame on the next vsync
+    void set_max_fps(float fps);
+    PacingStats pacing_stats() const;
+    // digital zoom of the preview around its centre, only the zoomed part is converted
+    void set_zoom(float zoom);
+    // called on the render thread with the newest camera frame
+    // rgba is the upright roi zoomed by zoom, drawn in place, it may be the locked window buffer itself
+    // roi is the same region in the newest inference frame and timestamp its capture time,
+    // the display frame itself with a single stream, roi.nv21 is null when no new inference frame came
+    virtual void on_image_render(cv::Mat& rgba, float zoom, const Nv21Roi& roi, int64_t timestamp) const;
+    // camera thread, only hands the frame over to the render thread
+    virtual void on_image(const unsigned char* nv21, int nv21_width, int nv21_height, int64_t timestamp) const;
+    virtual void on_inference_image(const unsigned char* nv21, int nv21_width, int nv21_height, int64_t timestamp) const;
+    // repacks straight into the frame handed to the render thread
+    virtual void on_yuv420_image(const Yuv420Plane& y, const Yuv420Plane& u, const Yuv420Plane& v, int width, int height, int64_t timestamp, bool inference);
 
 public:
-    mutable int accelerometer_orientation;
+    std::atomic<int> accelerometer_orientation;
+
+private:
+    friend class NdkCameraWindowRenderLoop;
+
+    // camera thread, the slot of either stream to fill and its hand over
+    CameraFrame& begin_frame(int nv21_width, int nv21_height, bool inference) const;
+    void publish_frame(CameraFrame& frame, int nv21_width, int nv21_height, int64_t timestamp, bool inference) const;
+
+    // render thread, returns false if there was no new frame or no window
+    bool render_newest();
+    void sensor_loop();
+    void start_threads();
+    void stop_threads();
 
 private:
     ASensorManager* sensor_manager;
-    mutable ASensorEventQueue* sensor_event_queue;
     const ASensor* accelerometer_sensor;
+    std::thread sensor_thread;
+    std::atomic<bool> sensor_stop;
+    std::mutex sensor_mutex;
+    ALooper* sensor_looper;
+
+    std::mutex window_mutex;
     ANativeWindow* win;
+
+    mutable TripleBuffer<CameraFrame> camera_frames;
+    mutable TimestampRing<CameraFrame> inference_frames;
+    RenderLoop* render_loop;
+    std::atomic<float> display_zoom;
+
+    // render scratch reused across frames
+    cv::Mat nv21_croprotated;
+    cv::Mat rgba_upright;
+    cv::Mat rgba_zoomed;
 };
 
 #endif // NDKCAMERA_H
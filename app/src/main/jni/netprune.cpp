@@ -0,0 +1,128 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#include "netprune.h"
+
+#include <modelbin.h>
+
+// forwards to another model bin, adding up the size of what it hands out
+class CountingModelBin : public ncnn::ModelBin
+{
+public:
+    explicit CountingModelBin(const ncnn::ModelBin& _mb)
+        : bytes(0), mb(_mb)
+    {
+    }
+
+    virtual ncnn::Mat load(int w, int type) const
+    {
+        ncnn::Mat m = mb.load(w, type);
+        bytes += m.total() * m.elemsize;
+        return m;
+    }
+
+    mutable size_t bytes;
+
+private:
+    const ncnn::ModelBin& mb;
+};
+
+// stands in for a layer no output needs
+class PrunedLayer : public ncnn::Layer
+{
+public:
+    PrunedLayer(ncnn::Layer* _layer, size_t* _weight_bytes)
+        : layer(_layer), weight_bytes(_weight_bytes)
+    {
+        one_blob_only = layer->one_blob_only;
+        support_inplace = layer->support_inplace;
+        userdata = layer->userdata;
+        typeindex = layer->typeindex;
+#if NCNN_STRING
+        type = layer->type;
+        name = layer->name;
+#endif
+        bottoms = layer->bottoms;
+        tops = layer->tops;
+        featmask = layer->featmask;
+    }
+
+    virtual ~PrunedLayer()
+    {
+        delete layer;
+    }
+
+    virtual int load_model(const ncnn::ModelBin& mb)
+    {
+        // the weights follow each other in the model, so the layer still reads its own
+        CountingModelBin counting(mb);
+        const int ret = layer->load_model(counting);
+        if (weight_bytes)
+            *weight_bytes += counting.bytes;
+
+        delete layer;
+        layer = 0;
+        return ret;
+    }
+
+private:
+    ncnn::Layer* layer;
+    size_t* weight_bytes;
+};
+
+int prune_unused_layers(ncnn::Net& net, const std::vector<int>& outputs, size_t* weight_bytes)
+{
+    std::vector<ncnn::Layer*>& layers = net.mutable_layers();
+    const std::vector<ncnn::Blob>& blobs = net.blobs();
+
+    // walk from the outputs up to the inputs, a layer is needed once any of its tops is
+    std::vector<bool> needed_blob(blobs.size(), false);
+    for (size_t i = 0; i < outputs.size(); i++)
+    {
+        if (outputs[i] >= 0 && outputs[i] < (int)blobs.size())
+            needed_blob[outputs[i]] = true;
+    }
+
+    std::vector<bool> needed_layer(layers.size(), false);
+    for (int i = (int)layers.size() - 1; i >= 0; i--)
+    {
+        const ncnn::Layer* layer = layers[i];
+        for (size_t j = 0; j < layer->tops.size(); j++)
+        {
+            if (needed_blob[layer->tops[j]])
+                needed_layer[i] = true;
+        }
+
+        if (!needed_layer[i])
+            continue;
+
+        for (size_t j = 0; j < layer->bottoms.size(); j++)
+        {
+            needed_blob[layer->bottoms[j]] = true;
+        }
+    }
+
+    int pruned = 0;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        if (needed_layer[i])
+            continue;
+
+        layers[i] = new PrunedLayer(layers[i], weight_bytes);
+        pruned++;
+    }
+
+    return pruned;
+}
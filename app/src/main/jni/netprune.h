@@ -0,0 +1,33 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+
+#ifndef NETPRUNE_H
+#define NETPRUNE_H
+
+#include <stddef.h>
+
+#include <vector>
+
+#include <net.h>
+
+// between load_param and load_model, stubs out every layer that feeds none of the outputs
+// a stub reads its layer's weights from the model to stay in step and lets them go,
+// creates no pipeline and fails to forward, so extracting a pruned blob returns an error
+// ncnn only runs the producers of the blobs extracted, the rest of the graph is unaffected
+// blob and layer indices are unchanged, returns the number of layers stubbed out
+// weight_bytes, when given, gains the size of the weights let go during load_model and has to outlive it
+int prune_unused_layers(ncnn::Net& net, const std::vector<int>& outputs, size_t* weight_bytes = 0);
+
+#endif // NETPRUNE_H
@@ -0,0 +1,137 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+#include "framesource.h"
+
+// fifo of at most capacity items between two pipeline stages
+// push blocks while full so a slow stage backs up its producers instead of growing memory
+// close() wakes everyone, pop() then drains the remaining items and returns false
+template<typename T>
+class BoundedQueue
+{
+public:
+    BoundedQueue(int _capacity = 1)
+        : capacity(_capacity), closed(false)
+    {
+    }
+
+    void set_capacity(int _capacity)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        capacity = _capacity < 1 ? 1 : _capacity;
+        not_full.notify_all();
+    }
+
+    // returns false if the queue was closed, item is left untouched
+    bool push(T&& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_full.wait(lock, [this] { return closed || (int)items.size() < capacity; });
+        if (closed)
+            return false;
+
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    // returns false once the queue is closed and empty
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        not_empty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty())
+            return false;
+
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    int size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return (int)items.size();
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        not_full.notify_all();
+        not_empty.notify_all();
+    }
+
+    // drop leftovers and accept items again
+    void reopen()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        items.clear();
+        closed = false;
+    }
+
+private:
+    int capacity;
+    bool closed;
+    std::deque<T> items;
+    mutable std::mutex mutex;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+};
+
+// per stage counters, all times in nanoseconds of frame_timestamp_now()
+// queue_wait is the time a job sat in the input queue of the stage,
+// blocked is the time the stage waited for room in its output queue
+struct StageMetrics
+{
+    int64_t frames;
+    int64_t busy;
+    int64_t queue_wait;
+    int64_t blocked;
+    int64_t started;
+
+    void reset()
+    {
+        frames = 0;
+        busy = 0;
+        queue_wait = 0;
+        blocked = 0;
+        started = frame_timestamp_now();
+    }
+};
+
+// snapshot of StageMetrics for reporting
+struct StageStats
+{
+    const char* name;
+    int64_t frames;
+    int queue_size;
+    double occupancy;      // busy / wall time since reset, 0~1
+    double avg_busy;       // ms per frame
+    double avg_queue_wait; // ms per frame
+    double avg_blocked;    // ms per frame
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,211 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "renderloop.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+
+PeriodicVsync::PeriodicVsync(int64_t _period_ns)
+    : period_ns(_period_ns), next(0), woken(false)
+{
+}
+
+void PeriodicVsync::attach()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    next = frame_timestamp_now() + period_ns;
+    woken = false;
+}
+
+int64_t PeriodicVsync::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // a tick that was missed entirely is skipped, like a display would
+    const int64_t now = frame_timestamp_now();
+    if (next <= now)
+        next += (now - next) / period_ns * period_ns + period_ns;
+
+    const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(next));
+    cv.wait_until(lock, deadline, [this] { return woken; });
+    if (woken)
+        return -1;
+
+    const int64_t vsync = next;
+    next += period_ns;
+    return vsync;
+}
+
+void PeriodicVsync::wake()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    woken = true;
+    cv.notify_all();
+}
+
+RenderLoop::RenderLoop(VsyncSource* vsync)
+    : vsync_source(vsync), stop_requested(false), min_interval(0)
+{
+    reset_pacing_stats();
+}
+
+RenderLoop::~RenderLoop()
+{
+    stop();
+    delete vsync_source;
+}
+
+void RenderLoop::start()
+{
+    if (thread.joinable())
+        return;
+
+    stop_requested = false;
+    thread = std::thread(&RenderLoop::run, this);
+}
+
+void RenderLoop::stop()
+{
+    if (!thread.joinable())
+        return;
+
+    stop_requested = true;
+    vsync_source->wake();
+    thread.join();
+}
+
+void RenderLoop::set_min_interval(int64_t ns)
+{
+    min_interval = std::max(ns, (int64_t)0);
+}
+
+PacingStats RenderLoop::pacing_stats() const
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    PacingStats stats;
+    stats.vsyncs = vsyncs;
+    stats.presents = presents;
+    stats.late = late;
+    stats.interval_mean = 0;
+    stats.interval_stddev = 0;
+    stats.interval_max = interval_max;
+    stats.render_mean = presents > 0 ? render_sum / presents : 0;
+    stats.vsync_period = vsync_period > 0 ? vsync_period / 1000000.0 : 0;
+
+    if (presents > 1)
+    {
+        const int64_t n = presents - 1;
+        stats.interval_mean = interval_sum / n;
+        stats.interval_stddev = sqrt(std::max(interval_sqsum / n - stats.interval_mean * stats.interval_mean, 0.0));
+    }
+
+    return stats;
+}
+
+void RenderLoop::reset_pacing_stats()
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    vsyncs = 0;
+    presents = 0;
+    late = 0;
+    last_vsync = 0;
+    last_present = 0;
+    vsync_period = 0;
+    interval_sum = 0;
+    interval_sqsum = 0;
+    interval_max = 0;
+    render_sum = 0;
+}
+
+int64_t PeriodicVsync::period() const
+{
+    return period_ns;
+}
+
+void RenderLoop::record_vsync(int64_t vsync)
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    // the shortest gap seen is the refresh period, longer ones are missed vsyncs
+    // it overestimates while every render takes longer than a refresh, prefer the source's own
+    if (vsync_source->period() > 0)
+    {
+        vsync_period = vsync_source->period();
+    }
+    else if (last_vsync != 0 && vsync > last_vsync)
+    {
+        const int64_t period = vsync - last_vsync;
+        if (vsync_period == 0 || period < vsync_period)
+            vsync_period = period;
+    }
+
+    last_vsync = vsync;
+    vsyncs++;
+}
+
+void RenderLoop::record_present(int64_t vsync, int64_t done)
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    if (last_present != 0)
+    {
+        const double interval = (done - last_present) / 1000000.0;
+        interval_sum += interval;
+        interval_sqsum += interval * interval;
+        interval_max = std::max(interval_max, interval);
+    }
+
+    if (vsync_period > 0 && done - vsync > vsync_period)
+        late++;
+
+    render_sum += (done - vsync) / 1000000.0;
+    last_present = done;
+    presents++;
+}
+
+void RenderLoop::run()
+{
+    vsync_source->attach();
+
+    int64_t last_render_vsync = 0;
+    while (!stop_requested)
+    {
+        const int64_t vsync = vsync_source->wait();
+        if (vsync < 0)
+            break;
+
+        record_vsync(vsync);
+
+        // half a refresh of slack so a rate cap at a multiple of the period does not slip a vsync
+        int64_t period = 0;
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            period = vsync_period;
+        }
+        if (last_render_vsync != 0 && vsync - last_render_vsync < min_interval - period / 2)
+            continue;
+
+        if (!render(vsync))
+            continue;
+
+        record_present(vsync, frame_timestamp_now());
+        last_render_vsync = vsync;
+    }
+
+    vsync_source->detach();
+}
@@ -0,0 +1,141 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef RENDERLOOP_H
+#define RENDERLOOP_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "framesource.h"
+
+// source of display refresh ticks, driven from the render thread
+class VsyncSource
+{
+public:
+    virtual ~VsyncSource()
+    {
+    }
+
+    // called on the render thread before the first wait() and after the last
+    // attach() clears a previous wake(), RenderLoop checks its stop flag after attaching
+    virtual void attach()
+    {
+    }
+
+    virtual void detach()
+    {
+    }
+
+    // blocks until the next vsync and returns its time, see frame_timestamp_now()
+    // returns -1 once wake() was called
+    virtual int64_t wait() = 0;
+
+    // makes a blocked or future wait() return -1, callable from any thread
+    virtual void wake() = 0;
+
+    // refresh period in ns if known, otherwise RenderLoop estimates it from the ticks
+    virtual int64_t period() const
+    {
+        return 0;
+    }
+};
+
+// fixed rate ticks on the steady clock, for hosts without a display
+class PeriodicVsync : public VsyncSource
+{
+public:
+    PeriodicVsync(int64_t period_ns = 16666667);
+
+    virtual void attach();
+    virtual int64_t wait();
+    virtual void wake();
+    virtual int64_t period() const;
+
+private:
+    int64_t period_ns;
+    int64_t next;
+    bool woken;
+    std::mutex mutex;
+    std::condition_variable cv;
+};
+
+struct PacingStats
+{
+    int64_t vsyncs;
+    int64_t presents;
+    // presents that finished after the following vsync
+    int64_t late;
+    // ms between consecutive presents
+    double interval_mean;
+    double interval_stddev;
+    double interval_max;
+    // ms from vsync to present done
+    double render_mean;
+    // ms between vsyncs
+    double vsync_period;
+};
+
+// render thread that presents at most once per vsync
+// render() is only called when the previous present is at least min_interval old
+class RenderLoop
+{
+public:
+    // takes ownership of vsync
+    RenderLoop(VsyncSource* vsync);
+    // subclasses must call stop() in their own destructor, render() is pure
+    virtual ~RenderLoop();
+
+    void start();
+    void stop();
+
+    // 0 renders on every vsync
+    void set_min_interval(int64_t ns);
+
+    PacingStats pacing_stats() const;
+    void reset_pacing_stats();
+
+protected:
+    // draw and present the newest content, returns false if there was nothing new
+    virtual bool render(int64_t vsync) = 0;
+
+private:
+    void run();
+    void record_vsync(int64_t vsync);
+    void record_present(int64_t vsync, int64_t done);
+
+private:
+    VsyncSource* vsync_source;
+    std::thread thread;
+    std::atomic<bool> stop_requested;
+    std::atomic<int64_t> min_interval;
+
+    mutable std::mutex stats_mutex;
+    int64_t vsyncs;
+    int64_t presents;
+    int64_t late;
+    int64_t last_vsync;
+    int64_t last_present;
+    int64_t vsync_period;
+    double interval_sum;
+    double interval_sqsum;
+    double interval_max;
+    double render_sum;
+};
+
+#endif // RENDERLOOP_H
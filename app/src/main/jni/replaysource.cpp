@@ -0,0 +1,176 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "replaysource.h"
+
+#include <chrono>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "yuv420.h"
+
+ReplaySource::ReplaySource()
+{
+    format = REPLAY_NV21;
+    width = 0;
+    height = 0;
+    fps = 0.f;
+
+    fp = 0;
+
+    stop_replay = false;
+    replay_finished = false;
+}
+
+ReplaySource::~ReplaySource()
+{
+    close();
+}
+
+int ReplaySource::open(const char* path, int _format, int _width, int _height, float _fps)
+{
+    close();
+
+    format = _format;
+    width = _width;
+    height = _height;
+    fps = _fps;
+
+    if (format == REPLAY_IMAGES)
+    {
+        cv::glob(path, image_paths, false);
+        if (image_paths.empty())
+        {
+            fprintf(stderr, "no images in %s\n", path);
+            return -1;
+        }
+    }
+    else
+    {
+        if (width <= 0 || height <= 0 || width % 2 != 0 || height % 2 != 0)
+        {
+            fprintf(stderr, "raw replay needs an even frame size, got %d x %d\n", width, height);
+            return -1;
+        }
+
+        fp = fopen(path, "rb");
+        if (!fp)
+        {
+            fprintf(stderr, "fopen %s failed\n", path);
+            return -1;
+        }
+    }
+
+    stop_replay = false;
+    replay_finished = false;
+    replay_thread = std::thread(&ReplaySource::replay_thread_function, this);
+
+    return 0;
+}
+
+void ReplaySource::close()
+{
+    stop_replay = true;
+    if (replay_thread.joinable())
+    {
+        replay_thread.join();
+    }
+
+    if (fp)
+    {
+        fclose(fp);
+        fp = 0;
+    }
+
+    image_paths.clear();
+}
+
+bool ReplaySource::finished() const
+{
+    return replay_finished;
+}
+
+int ReplaySource::read_frame(int index)
+{
+    if (format == REPLAY_NV21)
+    {
+        nv21.create(height + height / 2, width, CV_8UC1);
+        size_t nread = fread(nv21.data, 1, width * height * 3 / 2, fp);
+        return nread == (size_t)(width * height * 3 / 2) ? 0 : -1;
+    }
+
+    if (format == REPLAY_YUV420P)
+    {
+        yuv420p.resize(width * height * 3 / 2);
+        size_t nread = fread(yuv420p.data(), 1, yuv420p.size(), fp);
+        if (nread != yuv420p.size())
+            return -1;
+    }
+
+    if (format == REPLAY_IMAGES)
+    {
+        if (index >= (int)image_paths.size())
+            return -1;
+
+        cv::Mat bgr = cv::imread(image_paths[index], cv::IMREAD_COLOR);
+        if (bgr.empty())
+        {
+            fprintf(stderr, "imread %s failed\n", image_paths[index].c_str());
+            return -1;
+        }
+
+        // yuv420 needs even dimensions
+        width = bgr.cols / 2 * 2;
+        height = bgr.rows / 2 * 2;
+
+        cv::Mat i420;
+        cv::cvtColor(bgr(cv::Rect(0, 0, width, height)), i420, cv::COLOR_BGR2YUV_I420);
+        yuv420p.assign(i420.data, i420.data + width * height * 3 / 2);
+    }
+
+    // planar u and v, repacked the same way as a camera image
+    const unsigned char* y = yuv420p.data();
+    const unsigned char* u = y + width * height;
+    const unsigned char* v = u + width * height / 4;
+    Yuv420Plane y_plane = {y, width, 1};
+    Yuv420Plane u_plane = {u, width / 2, 1};
+    Yuv420Plane v_plane = {v, width / 2, 1};
+
+    nv21.create(height + height / 2, width, CV_8UC1);
+    yuv420_888_to_nv21(y_plane, u_plane, v_plane, width, height, nv21.data);
+
+    return 0;
+}
+
+void ReplaySource::replay_thread_function()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; !stop_replay; i++)
+    {
+        if (read_frame(i) != 0)
+            break;
+
+        if (fps > 0.f)
+        {
+            // real time pacing against the replay start, late frames are not skipped
+            std::this_thread::sleep_until(start + std::chrono::microseconds((long long)(i * 1000000.0 / fps)));
+        }
+
+        on_image(nv21.data, width, height, frame_timestamp_now());
+    }
+
+    replay_finished = true;
+}
@@ -0,0 +1,73 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include <stdio.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "framesource.h"
+
+enum
+{
+    // concatenated nv21 frames, as dumped from on_image
+    REPLAY_NV21 = 0,
+    // concatenated planar yuv420p frames, ffmpeg -f rawvideo -pix_fmt yuv420p
+    REPLAY_YUV420P = 1,
+    // directory of images readable by cv::imread, replayed in name order
+    REPLAY_IMAGES = 2
+};
+
+// replays a recording on its own thread, paced at fps or as fast as on_image returns
+class ReplaySource : public FrameSource
+{
+public:
+    ReplaySource();
+    // subclasses must call close() in their own destructor, on_image runs on the replay thread
+    virtual ~ReplaySource();
+
+    // width and height are required for the raw formats, fps <= 0 disables pacing
+    int open(const char* path, int format, int width = 0, int height = 0, float fps = 30.f);
+    virtual void close();
+
+    // true once the last frame has been delivered
+    bool finished() const;
+
+private:
+    int read_frame(int index);
+    void replay_thread_function();
+
+private:
+    int format;
+    int width;
+    int height;
+    float fps;
+
+    FILE* fp;
+    std::vector<cv::String> image_paths;
+    std::vector<unsigned char> yuv420p;
+    cv::Mat nv21;
+
+    std::thread replay_thread;
+    std::atomic<bool> stop_replay;
+    std::atomic<bool> replay_finished;
+};
+
+#endif // REPLAYSOURCE_H
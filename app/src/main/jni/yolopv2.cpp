@@ -13,137 +13,113 @@
 // specific language governing permissions and limitations under the License.
 
 #include "yolopv2.h"
+#include "yolopv2.id.h"
+#include <algorithm>
 #include <chrono>
 
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
 #define MAX_STRIDE 32
 
+#if __ANDROID__
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, "yolopv2", __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, "yolopv2", __VA_ARGS__)
+#else
+#define LOGI(...) fprintf(stderr, __VA_ARGS__)
+#define LOGE(...) fprintf(stderr, __VA_ARGS__)
+#endif
 
-static void slice(const ncnn::Mat &in, ncnn::Mat &out, int start, int end, int axis) {
-    ncnn::Option opt;
-    opt.num_threads = 4;
-    opt.use_fp16_arithmetic = true;
-    opt.use_fp16_storage = true;
-    opt.use_fp16_packed = true;
-
-    std::unique_ptr<ncnn::Layer> op(ncnn::create_layer("Crop"));
-
-    // set param
-    ncnn::ParamDict pd;
-
-    ncnn::Mat axes = ncnn::Mat(1);
-    axes.fill(axis);
-    ncnn::Mat ends = ncnn::Mat(1);
-    ends.fill(end);
-    ncnn::Mat starts = ncnn::Mat(1);
-    starts.fill(start);
-    pd.set(9, starts);// start
-    pd.set(10, ends);// end
-    pd.set(11, axes);//axes
-
-    op->load_param(pd);
-
-    op->create_pipeline(opt);
-
-    // forward
-    op->forward(in, out, opt);
-
-    op->destroy_pipeline(opt);
-}
-
-static void interp(const ncnn::Mat &in, const float &scale, const int &out_w, const int &out_h,
-                   ncnn::Mat &out) {
-    ncnn::Option opt;
-    opt.num_threads = 4;
-    opt.use_fp16_arithmetic = true;
-    opt.use_fp16_storage = true;
-    opt.use_fp16_packed = true;
-
-    std::unique_ptr<ncnn::Layer> op(ncnn::create_layer("Interp"));
-
-    // set param
-    ncnn::ParamDict pd;
-    pd.set(0, 2);// resize_type
-    pd.set(1, scale);// height_scale
-    pd.set(2, scale);// width_scale
-    pd.set(3, out_h);// height
-    pd.set(4, out_w);// width
-
-    op->load_param(pd);
-
-    op->create_pipeline(opt);
-
-    // forward
-    op->forward(in, out, opt);
-
-    op->destroy_pipeline(opt);
-}
-
-static inline float intersection_area(const Object &a, const Object &b) {
-    cv::Rect_<float> inter = a.rect & b.rect;
-    return inter.area();
+static inline float sigmoid(float x) {
+    return static_cast<float>(1.f / (1.f + exp(-x)));
 }
 
-static void qsort_descent_inplace(std::vector<Object> &faceobjects, int left, int right) {
-    int i = left;
-    int j = right;
-    float p = faceobjects[(left + right) / 2].prob;
-
-    while (i <= j) {
-        while (faceobjects[i].prob > p)
-            i++;
 
-        while (faceobjects[j].prob < p)
-            j--;
-
-        if (i <= j) {
-            // swap
-            std::swap(faceobjects[i], faceobjects[j]);
-
-            i++;
-            j--;
+// 一行 logits 判定为标签: ll 四舍五入为 1 的是车道线, 否则 da 第 1 通道大于第 0 通道的是可行驶区域
+// da0/da1 或 ll 为空表示该项未开启
+static void seg_labels_row(const float* da0, const float* da1, const float* ll, int n, unsigned char* labels) {
+    int i = 0;
+#if __ARM_NEON
+    if (da0 && ll) {
+        const float32x4_t _lo = vdupq_n_f32(0.5f);
+        const float32x4_t _hi = vdupq_n_f32(1.5f);
+        for (; i + 7 < n; i += 8) {
+            uint32x4_t _da_0 = vcgtq_f32(vld1q_f32(da1 + i), vld1q_f32(da0 + i));
+            uint32x4_t _da_1 = vcgtq_f32(vld1q_f32(da1 + i + 4), vld1q_f32(da0 + i + 4));
+            float32x4_t _ll_0 = vld1q_f32(ll + i);
+            float32x4_t _ll_1 = vld1q_f32(ll + i + 4);
+            uint32x4_t _lane_0 = vandq_u32(vcgeq_f32(_ll_0, _lo), vcltq_f32(_ll_0, _hi));
+            uint32x4_t _lane_1 = vandq_u32(vcgeq_f32(_ll_1, _lo), vcltq_f32(_ll_1, _hi));
+            uint16x8_t _da = vcombine_u16(vmovn_u32(_da_0), vmovn_u32(_da_1));
+            uint16x8_t _lane = vcombine_u16(vmovn_u32(_lane_0), vmovn_u32(_lane_1));
+            // 车道线 2, 可行驶区域 1, 否则 0
+            uint16x8_t _label = vbslq_u16(_lane, vdupq_n_u16(SEG_LANE_LINE), vandq_u16(_da, vdupq_n_u16(SEG_DRIVABLE_AREA)));
+            vst1_u8(labels + i, vmovn_u16(_label));
         }
     }
-
-#pragma omp parallel sections
-    {
-#pragma omp section
-        {
-            if (left < j) qsort_descent_inplace(faceobjects, left, j);
+#elif __SSE2__
+    if (da0 && ll) {
+        const __m128 _lo = _mm_set1_ps(0.5f);
+        const __m128 _hi = _mm_set1_ps(1.5f);
+        const __m128i _one = _mm_set1_epi32(SEG_DRIVABLE_AREA);
+        const __m128i _two = _mm_set1_epi32(SEG_LANE_LINE);
+        for (; i + 7 < n; i += 8) {
+            __m128i _label[2];
+            for (int k = 0; k < 2; k++) {
+                __m128i _da = _mm_castps_si128(_mm_cmpgt_ps(_mm_loadu_ps(da1 + i + k * 4), _mm_loadu_ps(da0 + i + k * 4)));
+                __m128 _ll = _mm_loadu_ps(ll + i + k * 4);
+                __m128i _lane = _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(_ll, _lo), _mm_cmplt_ps(_ll, _hi)));
+                _label[k] = _mm_or_si128(_mm_and_si128(_lane, _two), _mm_andnot_si128(_lane, _mm_and_si128(_da, _one)));
+            }
+            __m128i _label16 = _mm_packs_epi32(_label[0], _label[1]);
+            _mm_storel_epi64((__m128i*) (labels + i), _mm_packus_epi16(_label16, _label16));
         }
-#pragma omp section
-        {
-            if (i < right) qsort_descent_inplace(faceobjects, i, right);
+    }
+#endif
+    for (; i < n; i++) {
+        unsigned char label = SEG_NONE;
+        if (da0 && da0[i] < da1[i]) {
+            label = SEG_DRIVABLE_AREA;
         }
+        if (ll && std::round(ll[i]) == 1.0) {
+            label = SEG_LANE_LINE;
+        }
+        labels[i] = label;
     }
 }
 
-static void qsort_descent_inplace(std::vector<Object> &faceobjects) {
-    if (faceobjects.empty())
-        return;
-
-    qsort_descent_inplace(faceobjects, 0, faceobjects.size() - 1);
-}
-
-
-static inline float sigmoid(float x) {
-    return static_cast<float>(1.f / (1.f + exp(-x)));
-}
-
-
 TimingInfo Yolopv2::getLatestTimingInfo() const {
     std::lock_guard<std::mutex> lock(timing_mutex);
     return latest_timing_info;
 }
 
 
-Yolopv2::Yolopv2() : stop_threads(false) {
+Yolopv2::Yolopv2()
+        : latest_frame_id(0), processed_count(0), displayed_count(0), dropped_before_display(0),
+          dropped_before_inference(0), processed_frame_id(0), stop_threads(false),
+          pipeline_depth(2), concurrent_nets(false), load_begin(0), load_rss_before(0),
+          prune_unused_outputs(true), yolopv2_detection_heads(true) {
+    for (int i = 0; i < NET_COUNT; i++) {
+        net_states[i] = NET_FAILED;
+        ready_times[i] = 0;
+    }
+
     blob_pool_allocator.set_size_compare_ratio(0.f);
     workspace_pool_allocator.set_size_compare_ratio(0.f);
+
+    // 默认两个网络都跑在全部大核上, 依次执行
+    yolopv2_thread_config.num_threads = ncnn::get_big_cpu_count();
+    yolopv2_thread_config.affinity = ncnn::get_cpu_thread_affinity_mask(2);
+    yolov8_thread_config = yolopv2_thread_config;
 }
 
 Yolopv2::~Yolopv2() {
+    // 加载中途没法取消, 等它结束
+    joinLoaders();
     stopThreads();
 
     std::lock_guard<std::mutex> lock(net_mutex);
@@ -153,11 +129,10 @@ Yolopv2::~Yolopv2() {
     workspace_pool_allocator.clear();
 }
 
-int Yolopv2::load(AAssetManager *mgr, bool use_gpu) {
-    std::lock_guard<std::mutex> lock(net_mutex);
-
-    // 重置并重新创建网络
+void Yolopv2::resetNet(bool use_gpu) {
+    // 重置并重新创建网络, 旧网络释放后才能释放它引用的权重
     yolopv2.reset(new ncnn::Net());
+    yolopv2_weights.close();
 
     blob_pool_allocator.clear();
     workspace_pool_allocator.clear();
@@ -176,208 +151,724 @@ int Yolopv2::load(AAssetManager *mgr, bool use_gpu) {
     yolopv2->opt.num_threads = ncnn::get_big_cpu_count();
     yolopv2->opt.blob_allocator = &blob_pool_allocator;
     yolopv2->opt.workspace_allocator = &workspace_pool_allocator;
+}
 
-    int ret = yolopv2->load_param(mgr, "yolopv2.param");
-    if (ret != 0) {
-        return ret;
+// 开启的任务需要的 yolopv2 输出, 空表示全部保留
+std::vector<int> Yolopv2::yolopv2Outputs() const {
+    std::vector<int> outputs;
+    if (!prune_unused_outputs) {
+        return outputs;
     }
-    ret = yolopv2->load_model(mgr, "yolopv2.bin");
-    if (ret != 0) {
-        return ret;
+
+    outputs.push_back(yolopv2_param_id::BLOB_677);
+    outputs.push_back(yolopv2_param_id::BLOB_769);
+    if (g_enable_single_network) {
+        outputs.push_back(yolopv2_param_id::BLOB_det0);
+        outputs.push_back(yolopv2_param_id::BLOB_det1);
+        outputs.push_back(yolopv2_param_id::BLOB_det2);
+    }
+    return outputs;
+}
+
+void Yolopv2::joinLoaders() {
+    for (int i = 0; i < NET_COUNT; i++) {
+        if (load_threads[i].joinable()) {
+            load_threads[i].join();
+        }
     }
+}
 
-    const char* modeltype = "n"; // 或 "s"
+void Yolopv2::beginLoading() {
+    joinLoaders();
 
-    const float mean_vals[3] = {103.53f, 116.28f, 123.675f};
-    const float norm_vals[3] = {1/255.f, 1/255.f, 1/255.f};
+    std::lock_guard<std::mutex> lock(load_mutex);
+    for (int i = 0; i < NET_COUNT; i++) {
+        net_states[i] = NET_LOADING;
+        ready_times[i] = 0;
+        load_phases[i] = LoadPhases();
+    }
+    // 单网络模式的目标检测用 yolopv2 的检测头, 不需要 yolov8
+    if (g_enable_single_network) {
+        net_states[NET_YOLOV8] = NET_SKIPPED;
+    }
+    load_begin = frame_timestamp_now();
+    load_rss_before = resident_memory_kb();
+    yolopv2_detection_heads = !prune_unused_outputs || g_enable_single_network;
+}
 
-    yolov8.load(mgr, modeltype, yolov8_target_size, mean_vals, norm_vals, use_gpu);
+// 在加载线程上调用, 就绪前套用当前的线程配置, 推理各级看到就绪之后才会使用该网络
+void Yolopv2::finishLoading(int net, int ret) {
+    static const char* names[NET_COUNT] = {"yolopv2", "yolov8"};
+
+    std::lock_guard<std::mutex> lock(load_mutex);
+    if (ret == 0) {
+        if (net == NET_YOLOPV2) {
+            yolopv2->opt.num_threads = yolopv2_thread_config.num_threads;
+            load_phases[net] = yolopv2_phases;
+        } else {
+            yolov8.set_num_threads(yolov8_thread_config.num_threads);
+            load_phases[net] = yolov8.load_phases();
+        }
+    }
 
+    const int64_t now = frame_timestamp_now();
+    const bool mapped = net == NET_YOLOPV2 ? yolopv2_weights.mapped() : yolov8.weights_mapped();
+    const LoadPhases& phases = load_phases[net];
+    LOGI("%s %s, 开始加载后 %.1f ms: 解析 %.1f ms 权重(%s) %.1f ms 管线 %.1f ms, 裁掉 %d 层 %.1f MB, RSS %+ld kB\n",
+         names[net], ret == 0 ? "就绪" : "加载失败", (now - load_begin) / 1000000.0,
+         phases.param, mapped ? "映射" : "拷贝", phases.weights, phases.pipeline,
+         phases.pruned_layers, phases.pruned_bytes / 1048576.0, resident_memory_kb() - load_rss_before);
+
+    ready_times[net] = ret == 0 ? now : 0;
+    net_states[net] = ret == 0 ? NET_READY : NET_FAILED;
+    load_cv.notify_all();
+}
+
+#if __ANDROID__
+void Yolopv2::startLoading(AAssetManager *mgr, bool use_gpu, bool map_weights) {
+    beginLoading();
+
+    // 用不到的输出在加载时裁掉
+    const std::vector<int> outputs = yolopv2Outputs();
+
+    load_threads[NET_YOLOPV2] = std::thread([this, mgr, use_gpu, map_weights, outputs]() {
+        std::lock_guard<std::mutex> lock(net_mutex);
+        resetNet(use_gpu);
+        // apk 里不压缩的 .bin 直接映射, 权重不再拷贝
+        int ret = load_net_timed(*yolopv2, yolopv2_weights, mgr, "yolopv2.param.bin", "yolopv2.bin", map_weights, yolopv2_phases, outputs);
+        finishLoading(NET_YOLOPV2, ret);
+    });
+
+    if (net_states[NET_YOLOV8] == NET_SKIPPED) {
+        return;
+    }
+
+    load_threads[NET_YOLOV8] = std::thread([this, mgr, use_gpu, map_weights]() {
+        const char* modeltype = "n"; // 或 "s"
+
+        const float mean_vals[3] = {103.53f, 116.28f, 123.675f};
+        const float norm_vals[3] = {1/255.f, 1/255.f, 1/255.f};
+
+        int ret = yolov8.load(mgr, modeltype, yolov8_target_size, mean_vals, norm_vals, use_gpu, map_weights);
+        finishLoading(NET_YOLOV8, ret);
+    });
+}
+
+int Yolopv2::load(AAssetManager *mgr, bool use_gpu, bool map_weights) {
+    startLoading(mgr, use_gpu, map_weights);
+    return waitLoaded();
+}
+#else
+void Yolopv2::startLoading(const char *model_dir, bool use_gpu, bool map_weights) {
+    beginLoading();
+
+    const std::string dir(model_dir);
+
+    // 用不到的输出在加载时裁掉
+    const std::vector<int> outputs = yolopv2Outputs();
+
+    load_threads[NET_YOLOPV2] = std::thread([this, dir, use_gpu, map_weights, outputs]() {
+        std::string parampath = dir + "/yolopv2.param.bin";
+        std::string modelpath = dir + "/yolopv2.bin";
+
+        std::lock_guard<std::mutex> lock(net_mutex);
+        resetNet(use_gpu);
+        // mmap .bin, 权重不再拷贝
+        int ret = load_net_timed(*yolopv2, yolopv2_weights, parampath.c_str(), modelpath.c_str(), map_weights, yolopv2_phases, outputs);
+        finishLoading(NET_YOLOPV2, ret);
+    });
+
+    if (net_states[NET_YOLOV8] == NET_SKIPPED) {
+        return;
+    }
+
+    load_threads[NET_YOLOV8] = std::thread([this, dir, use_gpu, map_weights]() {
+        const char* modeltype = "n"; // 或 "s"
+
+        const float mean_vals[3] = {103.53f, 116.28f, 123.675f};
+        const float norm_vals[3] = {1/255.f, 1/255.f, 1/255.f};
+
+        int ret = yolov8.load(dir.c_str(), modeltype, yolov8_target_size, mean_vals, norm_vals, use_gpu, map_weights);
+        finishLoading(NET_YOLOV8, ret);
+    });
+}
+
+int Yolopv2::load(const char *model_dir, bool use_gpu, bool map_weights) {
+    startLoading(model_dir, use_gpu, map_weights);
+    return waitLoaded();
+}
+#endif
+
+int Yolopv2::waitLoaded() {
+    std::unique_lock<std::mutex> lock(load_mutex);
+    load_cv.wait(lock, [this] {
+        return net_states[NET_YOLOPV2] != NET_LOADING && net_states[NET_YOLOV8] != NET_LOADING;
+    });
+    for (int i = 0; i < NET_COUNT; i++) {
+        if (net_states[i] == NET_FAILED) {
+            return -1;
+        }
+    }
     return 0;
 }
-void Yolopv2::updateLatestFrame(const cv::Mat& frame) {
-    std::lock_guard<std::mutex> lock(frame_mutex);
-    frame.copyTo(latest_frame);
+
+int Yolopv2::getNetState(int net) const {
+    return net_states[net];
+}
+
+LoadPhases Yolopv2::getLoadPhases(int net) const {
+    std::lock_guard<std::mutex> lock(load_mutex);
+    return load_phases[net];
+}
+
+// 就绪 -> 第一次推理完成, 含各层第一次运行时的惰性初始化
+void Yolopv2::logFirstInference(int net) {
+    const int64_t ready = ready_times[net].exchange(0);
+    if (ready == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(load_mutex);
+    load_phases[net].first_inference = (frame_timestamp_now() - ready) / 1000000.0;
+    LOGI("%s 首次推理 %.1f ms, 开始加载后 %.1f ms, RSS %ld kB\n", net == NET_YOLOPV2 ? "yolopv2" : "yolov8",
+         load_phases[net].first_inference, (frame_timestamp_now() - load_begin) / 1000000.0, resident_memory_kb());
+}
+
+// 保证 m 没有被别人引用再复用它的内存, 否则换一块新的, 旧的随最后一个引用释放
+static void create_unshared(cv::Mat& m, int rows, int cols, int type) {
+    if (m.empty()) {
+        m.create(rows, cols, type);
+        return;
+    }
+    if (m.u && m.u->refcount > 1) {
+        m.release();
+    }
+    const unsigned char* data = m.data;
+    m.create(rows, cols, type);
+    if (m.data != data) {
+        count_frame_realloc();
+    }
+}
+
+int Yolopv2::updateLatestFrame(const Nv21Roi& roi, int64_t timestamp) {
+    InputSlot& slot = input_frames.write_buffer();
+
+    // 传入的 nv21 在渲染返回后就会被下一帧覆盖, 推理用的 roi 要拷贝一份
+    create_unshared(slot.nv21, roi.roi_h + roi.roi_h / 2, roi.roi_w, CV_8UC1);
+    nv21_roi_crop(roi, slot.nv21.data);
+    count_frame_copy(slot.nv21.total());
+
+    slot.roi = roi;
+    slot.roi.nv21 = slot.nv21.data;
+    slot.roi.width = roi.roi_w;
+    slot.roi.height = roi.roi_h;
+    slot.roi.roi_x = 0;
+    slot.roi.roi_y = 0;
+    slot.timestamp = timestamp;
+    slot.updated = frame_timestamp_now();
+    slot.frame_id = ++latest_frame_id;
+
+    // 上一帧还没被推理线程取走
+    if (input_frames.publish()) {
+        dropped_before_inference++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex);
+    }
     frame_cv.notify_one();
+
+    return latest_frame_id;
+}
+
+void Yolopv2::waitProcessedFrame(int frame_id) {
+    std::unique_lock<std::mutex> lock(frame_mutex);
+    processed_cv.wait(lock, [this, frame_id] { return processed_frame_id >= frame_id || stop_threads; });
+}
+
+void Yolopv2::setPipelineDepth(int depth) {
+    pipeline_depth = std::max(depth, 1);
+}
+
+void Yolopv2::setNetThreads(const NetThreadConfig& yolopv2_config, const NetThreadConfig& yolov8_config, bool concurrent) {
+    std::lock_guard<std::mutex> lock(load_mutex);
+    yolopv2_thread_config = yolopv2_config;
+    yolov8_thread_config = yolov8_config;
+    yolopv2_thread_config.num_threads = std::max(yolopv2_thread_config.num_threads, 1);
+    yolov8_thread_config.num_threads = std::max(yolov8_thread_config.num_threads, 1);
+    concurrent_nets = concurrent;
+}
+
+// 在网络所在的线程上调用, openmp 线程池是每个调用线程各自的
+static void apply_thread_config(const NetThreadConfig& config) {
+    ncnn::set_omp_num_threads(config.num_threads);
+    if (config.affinity.num_enabled() > 0) {
+        ncnn::set_cpu_thread_affinity(config.affinity);
+    }
 }
 
 void Yolopv2::startThreads() {
     stop_threads = false;
-    inference_thread = std::thread(&Yolopv2::inferenceThreadFunction, this);
+
+    // 还在加载的网络在就绪时自己套用
+    {
+        std::lock_guard<std::mutex> lock(load_mutex);
+        if (netReady(NET_YOLOPV2)) {
+            yolopv2->opt.num_threads = yolopv2_thread_config.num_threads;
+        }
+        if (netReady(NET_YOLOV8)) {
+            yolov8.set_num_threads(yolov8_thread_config.num_threads);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(metrics_mutex);
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            stage_metrics[i].reset();
+        }
+    }
+
+    for (int i = 0; i < STAGE_COUNT - 1; i++) {
+        stage_queues[i].reopen();
+        stage_queues[i].set_capacity(pipeline_depth);
+    }
+    yolov8_fork.reopen();
+    yolov8_join.reopen();
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        stage_threads[i] = std::thread(&Yolopv2::stageThreadFunction, this, i);
+    }
 }
 
 void Yolopv2::stopThreads() {
-    stop_threads = true;
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex);
+        stop_threads = true;
+    }
     frame_cv.notify_all();
-    if (inference_thread.joinable()) {
-        inference_thread.join();
+    processed_cv.notify_all();
+
+    // 唤醒阻塞在队列上的各级
+    for (int i = 0; i < STAGE_COUNT - 1; i++) {
+        stage_queues[i].close();
+    }
+    // join 不关闭, yolov8 级会把已经拿到的帧做完再退出, yolopv2 级一定能取回
+    yolov8_fork.close();
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        if (stage_threads[i].joinable()) {
+            stage_threads[i].join();
+        }
     }
 }
 
-void Yolopv2::inferenceThreadFunction() {
-    while (!stop_threads) {
-        cv::Mat frame;
-        {
-            std::unique_lock<std::mutex> lock(frame_mutex);
-            frame_cv.wait(lock, [this] { return !latest_frame.empty() || stop_threads; });
-            if (stop_threads) break;
-            latest_frame.copyTo(frame);
+std::vector<StageStats> Yolopv2::getStageStats() const {
+    static const char* stage_names[STAGE_COUNT] = {"pre", "yolopv2", "yolov8", "post", "compose"};
+
+    const int64_t now = frame_timestamp_now();
+
+    std::vector<StageStats> stats(STAGE_COUNT);
+
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const StageMetrics& m = stage_metrics[i];
+        const double n = std::max(m.frames, (int64_t) 1);
+
+        stats[i].name = stage_names[i];
+        stats[i].frames = m.frames;
+        stats[i].queue_size = i == 0 ? 0 : stage_queues[i - 1].size();
+        stats[i].occupancy = now > m.started ? (double) m.busy / (now - m.started) : 0.0;
+        stats[i].avg_busy = m.busy / n / 1000000.0;
+        stats[i].avg_queue_wait = m.queue_wait / n / 1000000.0;
+        stats[i].avg_blocked = m.blocked / n / 1000000.0;
+    }
+
+    return stats;
+}
+
+std::unique_ptr<Yolopv2::FrameJob> Yolopv2::takeLatestFrame() {
+    std::unique_ptr<FrameJob> job;
+
+    // 只处理新到的帧, 旧帧在这里被覆盖, 不会堆积在队列里
+    {
+        std::unique_lock<std::mutex> lock(frame_mutex);
+        frame_cv.wait(lock, [this] { return input_frames.has_fresh() || stop_threads; });
+        if (stop_threads) {
+            return job;
         }
+    }
 
-        if (frame.empty()) {
-            LOGE("Empty frame in inference thread");
-            continue;
+    input_frames.acquire();
+    const InputSlot& slot = input_frames.read_buffer();
+
+    job.reset(new FrameJob());
+    job->frame_id = slot.frame_id;
+    job->enqueued = slot.updated;
+    job->timing = TimingInfo();
+    job->timing.capture_timestamp = slot.timestamp;
+
+    // 共享像素, 预处理读完就释放, 推理忙时采集线程也能原地复用这个槽位
+    job->nv21 = slot.nv21;
+    job->roi = slot.roi;
+
+    return job;
+}
+
+void Yolopv2::recordStage(int stage, int64_t begin, int64_t end, int64_t queue_wait, int64_t blocked) {
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    StageMetrics& m = stage_metrics[stage];
+    m.frames++;
+    m.busy += end - begin;
+    m.queue_wait += queue_wait;
+    m.blocked += blocked;
+}
+
+void Yolopv2::yolov8ForkThreadFunction() {
+    FrameJob* job = 0;
+    while (yolov8_fork.pop(job)) {
+        const int64_t begin = frame_timestamp_now();
+        const int64_t queue_wait = begin - job->enqueued;
+
+        runYolov8(*job);
+
+        const int64_t end = frame_timestamp_now();
+        yolov8_join.push(std::move(job));
+
+        recordStage(STAGE_YOLOV8, begin, end, queue_wait, 0);
+    }
+}
+
+void Yolopv2::stageThreadFunction(int stage) {
+    if (stage == STAGE_YOLOPV2) {
+        apply_thread_config(yolopv2_thread_config);
+    }
+    if (stage == STAGE_YOLOV8) {
+        apply_thread_config(yolov8_thread_config);
+        if (concurrent_nets) {
+            yolov8ForkThreadFunction();
+            return;
+        }
+    }
+
+    // 并行模式下 yolopv2 级的输出直接进入后处理
+    const int output_queue = concurrent_nets && stage == STAGE_YOLOPV2 ? STAGE_YOLOV8 : stage;
+
+    while (true) {
+        std::unique_ptr<FrameJob> job;
+        if (stage == STAGE_PREPROCESS) {
+            job = takeLatestFrame();
+            if (!job) break;
+        } else {
+            if (!stage_queues[stage - 1].pop(job)) break;
         }
 
-        TimingInfo timing;
-        int ret = detect(frame, timing);
-        if (ret != 0) {
-            LOGE("Detection failed with error code: %d", ret);
-            continue;
+        const int64_t begin = frame_timestamp_now();
+        const int64_t queue_wait = begin - job->enqueued;
+
+        switch (stage) {
+            case STAGE_PREPROCESS:
+                preprocess(*job);
+                break;
+            case STAGE_YOLOPV2:
+                if (concurrent_nets && job->enable_object_detection) {
+                    // 同一帧的两个网络同时跑, 在这里汇合
+                    FrameJob* forked = job.get();
+                    job->enqueued = begin;
+                    if (!yolov8_fork.push(std::move(forked))) {
+                        runYolopv2(*job);
+                        break;
+                    }
+                    runYolopv2(*job);
+                    yolov8_join.pop(forked);
+                } else {
+                    runYolopv2(*job);
+                }
+                break;
+            case STAGE_YOLOV8:
+                runYolov8(*job);
+                break;
+            case STAGE_POSTPROCESS:
+                postprocess(*job);
+                break;
+            case STAGE_COMPOSE:
+                compose(*job);
+                break;
         }
 
-        {
-            std::lock_guard<std::mutex> lock(frame_mutex);
-            latest_processed_frame = frame;
+        const int64_t end = frame_timestamp_now();
+
+        bool pushed = true;
+        if (stage + 1 < STAGE_COUNT) {
+            job->enqueued = end;
+            pushed = stage_queues[output_queue].push(std::move(job));
         }
+
+        recordStage(stage, begin, end, queue_wait, frame_timestamp_now() - end);
+
+        if (!pushed) break;
     }
 }
 
-cv::Mat Yolopv2::getLatestProcessedFrame() {
-    std::lock_guard<std::mutex> lock(frame_mutex);
-    return latest_processed_frame.clone();
+bool Yolopv2::getLatestResult(DetectionResult& result, TimingInfo* timing) {
+    if (result_frames.acquire()) {
+        const int count = result_frames.read_buffer().count;
+
+        // 两次显示之间推理完成的其他帧都被丢掉了
+        if (displayed_count > 0 && count > displayed_count + 1) {
+            dropped_before_display += count - displayed_count - 1;
+        }
+        displayed_count = count;
+    }
+
+    if (displayed_count == 0) {
+        return false;
+    }
+
+    const ResultSlot& slot = result_frames.read_buffer();
+
+    result = slot.result;
+
+    if (timing) {
+        *timing = slot.timing;
+        timing->dropped_before_inference = dropped_before_inference;
+        timing->dropped_before_display = dropped_before_display;
+    }
+
+    return true;
 }
 
 
-int Yolopv2::detect(cv::Mat &rgb, TimingInfo& timing) {
+void Yolopv2::preprocess(FrameJob& job) {
+    job.start = frame_timestamp_now();
+    job.timing.capture_to_inference = (job.start - job.timing.capture_timestamp) / 1000000.0;
+
+    // 开关在这一帧进入流水线时确定, 之后各级保持一致
+    // 还没加载好的网络, 它的任务这一帧先不做
+    job.single_network = g_enable_single_network;
+    job.enable_drivable_area = g_enable_drivable_area && netReady(NET_YOLOPV2);
+    job.enable_lane_detection = g_enable_lane_detection && netReady(NET_YOLOPV2);
+    // 裁掉了检测头的 yolopv2 重新加载之前不出检测结果
+    job.enable_object_detection = g_enable_object_detection &&
+            (job.single_network ? netReady(NET_YOLOPV2) && yolopv2_detection_heads : netReady(NET_YOLOV8));
+
+    // 只有预处理读像素, 函数返回后任务不再引用槽位的内存, 采集线程下次写这个槽位时可以原地复用
+    const cv::Mat nv21 = job.nv21;
+    job.nv21.release();
+    const Nv21Roi roi = job.roi;
+
+    // 图像信息, 结果都在转正后的画面坐标里
+    int img_w = roi.upright_w();
+    int img_h = roi.upright_h();
+    job.img_w = img_w;
+    job.img_h = img_h;
+    job.zoom = g_zoom;
+
+    // 网络输入直接取 nv21 中心 1/zoom 区域
+    const Nv21Roi zoom_roi = nv21_roi_zoom(roi, g_zoom);
+    job.roi = zoom_roi;
+    job.roi.nv21 = 0;
+
+    const bool run_yolopv2 = job.enable_drivable_area || job.enable_lane_detection || (job.enable_object_detection && job.single_network);
+    const bool run_yolov8 = job.enable_object_detection && !job.single_network;
+    if (!run_yolopv2 && !run_yolov8) {
+        return;
+    }
+
+    // 两个网络同一宽高比, 各自的 letterbox 只差缩放
+    const Letterbox lb = make_letterbox(img_w, img_h, yolopv2_target_size, MAX_STRIDE);
+    job.v8_letterbox = make_letterbox(img_w, img_h, yolov8_target_size, 32);
+    job.scale = lb.scale;
+    job.wpad = lb.left + lb.right;
+    job.hpad = lb.top + lb.bottom;
+
+    //每帧只对 nv21 做一次裁剪/旋转/转换/缩放, 得到最大的那个输入, 小的输入从它派生
+    auto pre_start = std::chrono::high_resolution_clock::now();
+    int level0_w = 0;
+    int level0_h = 0;
+    if (run_yolopv2) {
+        level0_w = lb.w;
+        level0_h = lb.h;
+    }
+    if (run_yolov8 && job.v8_letterbox.w > level0_w) {
+        level0_w = job.v8_letterbox.w;
+        level0_h = job.v8_letterbox.h;
+    }
+    input_pyramid.build(zoom_roi, level0_w, level0_h);
+
+    // padding/通道顺序/归一化, 输入从池分配器取, 每帧复用同样大小的内存
+    if (run_yolopv2) {
+        input_pyramid.make_input(lb, ncnn::Mat::PIXEL_BGR, 114.f, 0, norm_vals, job.in_pad, &blob_pool_allocator);
+    }
+    if (run_yolov8) {
+        input_pyramid.make_input(job.v8_letterbox, ncnn::Mat::PIXEL_BGR, 0.f, 0, norm_vals, job.in_pad_v8, &blob_pool_allocator);
+    }
+    auto pre_end = std::chrono::high_resolution_clock::now();
+    job.timing.preprocess = std::chrono::duration_cast<std::chrono::microseconds>(pre_end - pre_start).count() / 1000.0;
+}
+
+void Yolopv2::runYolopv2(FrameJob& job) {
+    const bool segment = job.enable_drivable_area || job.enable_lane_detection;
+    const bool detect = job.enable_object_detection && job.single_network;
+    if (!segment && !detect) {
+        return;
+    }
 
-    std::lock_guard<std::mutex> lock(net_mutex);  // 保护网络访问
     auto start = std::chrono::high_resolution_clock::now();
 
-    // 清空检测结果
-    {
-        std::lock_guard<std::mutex> lock(objects_mutex);
-        objects.clear();
-    }
-    ncnn::Mat da_seg_mask, ll_seg_mask;
-
-    // 图像信息
-    int img_w = rgb.cols;
-    int img_h = rgb.rows;
-
-    // 应用缩放
-    cv::Mat zoomed;
-    cv::resize(rgb, zoomed, cv::Size(), g_zoom, g_zoom, cv::INTER_LINEAR);
-
-    // 裁剪到原始大小
-    int crop_x = (zoomed.cols - img_w) / 2;
-    int crop_y = (zoomed.rows - img_h) / 2;
-    cv::Rect roi(crop_x, crop_y, img_w, img_h);
-    zoomed(roi).copyTo(rgb);
-
-    // 图像缩放
-    int w = img_w;
-    int h = img_h;
-    float scale = 1.f;
-    if (w > h) {
-        scale = (float) yolopv2_target_size / w;
-        w = yolopv2_target_size;
-        h = h * scale;
-    } else {
-        scale = (float) yolopv2_target_size / h;
-        h = yolopv2_target_size;
-        w = w * scale;
-    }
-    int wpad = (w + MAX_STRIDE - 1) / MAX_STRIDE * MAX_STRIDE - w;
-    int hpad = (h + MAX_STRIDE - 1) / MAX_STRIDE * MAX_STRIDE - h;
-
-    //输入tmp图像
-    ncnn::Mat in, in_pad;
-
-    //padding
-    in = ncnn::Mat::from_pixels_resize(rgb.data, ncnn::Mat::PIXEL_BGR2RGB, img_w, img_h, w, h);
-    ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2,
-                           ncnn::BORDER_CONSTANT, 114.f);
-    in_pad.substract_mean_normalize(0, norm_vals);
-
-    //run network
-    {
-        auto model_start = std::chrono::high_resolution_clock::now();
+    //run network, 单网络模式下同一个 extractor 顺带取出检测头
+    ncnn::Extractor ex = yolopv2->create_extractor();
+    ex.input(yolopv2_param_id::BLOB_images, job.in_pad);
+    if (segment) {
+        ex.extract(yolopv2_param_id::BLOB_677, job.da);
+        ex.extract(yolopv2_param_id::BLOB_769, job.ll);
+    }
 
-        ncnn::Extractor ex = yolopv2->create_extractor();
-        ex.input("images", in_pad);
+    auto end = std::chrono::high_resolution_clock::now();
+    job.timing.lane_and_area = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
 
-        if (g_enable_object_detection) {
-            auto obj_start = std::chrono::high_resolution_clock::now();
+    if (detect) {
+        decodeYolopv2Detections(ex, job);
+        job.timing.object_detection = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::high_resolution_clock::now() - end).count() / 1000.0;
+    }
 
-            std::vector<Object> detected_objects;
-            yolov8.detect(rgb, detected_objects);
+    job.in_pad.release();
+    logFirstInference(NET_YOLOPV2);
+}
 
-            {
-                std::lock_guard<std::mutex> lock(objects_mutex);
-                objects = detected_objects; // 更新类成员
-            }
+void Yolopv2::decodeYolopv2Detections(ncnn::Extractor& ex, FrameJob& job) {
+    const float prob_threshold = 0.3f;
+    const float nms_threshold = 0.45f;
+    const int max_det = 300;
+    const int pre_nms_topk = 1000;
 
-            yolov8.draw(rgb, detected_objects);
+    // det0/1/2 是 stride 8/16/32 的 yolov7 检测头, 每个 anchor 一个通道, 每个格子一行 85 个 logit
+    const int heads[3] = {yolopv2_param_id::BLOB_det0, yolopv2_param_id::BLOB_det1, yolopv2_param_id::BLOB_det2};
+    const int strides[3] = {8, 16, 32};
 
-            auto obj_end = std::chrono::high_resolution_clock::now();
-            timing.object_detection = std::chrono::duration_cast<std::chrono::milliseconds>(obj_end - obj_start).count();
+    std::vector<Object> proposals;
+    for (int i = 0; i < 3; i++) {
+        ncnn::Mat det;
+        if (ex.extract(heads[i], det) != 0) {
+            continue;
         }
+        generate_anchor_proposals(det, job.in_pad.w / strides[i], job.in_pad.h / strides[i], strides[i],
+                                  YOLOV7_ANCHORS[i], 3, 80, prob_threshold, proposals);
+    }
 
+    rank_proposals(proposals, pre_nms_topk);
+
+    std::vector<int> picked;
+    nms_sorted_bboxes(proposals, picked, nms_threshold, false, max_det);
+
+    // 去掉 padding, 映射回画面坐标
+    const float left = job.wpad / 2;
+    const float top = job.hpad / 2;
+    job.objects.resize(picked.size());
+    for (size_t i = 0; i < picked.size(); i++) {
+        Object& obj = job.objects[i];
+        obj = proposals[picked[i]];
+
+        float x0 = (obj.rect.x - left) / job.scale;
+        float y0 = (obj.rect.y - top) / job.scale;
+        float x1 = (obj.rect.x + obj.rect.width - left) / job.scale;
+        float y1 = (obj.rect.y + obj.rect.height - top) / job.scale;
+
+        x0 = std::max(std::min(x0, (float) (job.img_w - 1)), 0.f);
+        y0 = std::max(std::min(y0, (float) (job.img_h - 1)), 0.f);
+        x1 = std::max(std::min(x1, (float) (job.img_w - 1)), 0.f);
+        y1 = std::max(std::min(y1, (float) (job.img_h - 1)), 0.f);
+
+        obj.rect.x = x0;
+        obj.rect.y = y0;
+        obj.rect.width = x1 - x0;
+        obj.rect.height = y1 - y0;
+    }
 
-        if (g_enable_drivable_area || g_enable_lane_detection) {
-            auto da_ll_start = std::chrono::high_resolution_clock::now();
-            //make mask for da,ll
-            ncnn::Mat da, ll;
-            ex.extract("677", da);
-            ex.extract("769", ll);
-            slice(da, da_seg_mask, hpad / 2, in_pad.h - hpad / 2, 1);
-            slice(ll, ll_seg_mask, hpad / 2, in_pad.h - hpad / 2, 1);
-            slice(da_seg_mask, da_seg_mask, wpad / 2, in_pad.w - wpad / 2, 2);
-            slice(ll_seg_mask, ll_seg_mask, wpad / 2, in_pad.w - wpad / 2, 2);
-            interp(da_seg_mask, 1 / scale, 0, 0, da_seg_mask);
-            interp(ll_seg_mask, 1 / scale, 0, 0, ll_seg_mask);
-            auto da_ll_end = std::chrono::high_resolution_clock::now();
-            timing.lane_and_area = std::chrono::duration_cast<std::chrono::milliseconds>(da_ll_end - da_ll_start).count();
-        }
+    // 和 yolov8 一样按面积从大到小, 小框画在上面
+    std::sort(job.objects.begin(), job.objects.end(), [](const Object& a, const Object& b) {
+        return a.rect.area() > b.rect.area();
+    });
+}
 
-        auto model_end = std::chrono::high_resolution_clock::now();
-        timing.model_inference = std::chrono::duration_cast<std::chrono::milliseconds>(model_end - model_start).count();
+void Yolopv2::runYolov8(FrameJob& job) {
+    if (!job.enable_object_detection || job.single_network) {
+        return;
     }
 
+    auto start = std::chrono::high_resolution_clock::now();
 
-    if (g_enable_drivable_area || g_enable_lane_detection) {
-        auto da_ll_start = std::chrono::high_resolution_clock::now();
+    yolov8.detect(job.in_pad_v8, job.v8_letterbox, job.img_w, job.img_h, job.objects);
+    job.in_pad_v8.release();
+    logFirstInference(NET_YOLOV8);
 
-        const float* da_ptr = (float*)da_seg_mask.data;
-        const float* ll_ptr = (float*)ll_seg_mask.data;
-        int ww = da_seg_mask.w;
-        int hh = da_seg_mask.h;
-        for (int i = 0; i < hh; i++) {
-            auto* image_ptr = rgb.ptr<cv::Vec3b>(i);
-            for (int j = 0; j < ww; j++) {
-                if (g_enable_drivable_area && da_ptr[i * ww + j] < da_ptr[ww * hh + i * ww + j]) {
-                    image_ptr[j] = cv::Vec3b(0, 255, 0);
-                }
+    auto end = std::chrono::high_resolution_clock::now();
+    job.timing.object_detection = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+}
 
-                if (g_enable_lane_detection && std::round(ll_ptr[i * ww + j]) == 1.0) {
-                    image_ptr[j] = cv::Vec3b(255, 0, 0);
-                }
-            }
-        }
+void Yolopv2::postprocess(FrameJob& job) {
+    if ((!job.enable_drivable_area && !job.enable_lane_detection) || job.da.empty() || job.ll.empty()) {
+        return;
+    }
 
-        auto end = std::chrono::high_resolution_clock::now();
-        if (g_enable_drivable_area || g_enable_lane_detection) {
-            timing.lane_area_draw = std::chrono::duration_cast<std::chrono::milliseconds>(end - da_ll_start).count();
-        }
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // 在网络分辨率上直接判定标签, 读的时候跳过 padding, 显示时再把 uint8 标签映射到画面
+    const int left = job.wpad / 2;
+    const int top = job.hpad / 2;
+    const int out_w = job.da.w - job.wpad / 2 * 2;
+    const int out_h = job.da.h - job.hpad / 2 * 2;
+    job.seg_labels.create(out_h, out_w, CV_8UC1);
+
+    const ncnn::Mat da0 = job.da.channel(0);
+    const ncnn::Mat da1 = job.da.channel(1);
+    const ncnn::Mat ll = job.ll.channel(0);
+    for (int y = 0; y < out_h; y++) {
+        seg_labels_row(job.enable_drivable_area ? da0.row(top + y) + left : 0,
+                       job.enable_drivable_area ? da1.row(top + y) + left : 0,
+                       job.enable_lane_detection ? ll.row(top + y) + left : 0,
+                       out_w, job.seg_labels.ptr<unsigned char>(y));
     }
 
+    job.da.release();
+    job.ll.release();
+
     auto end = std::chrono::high_resolution_clock::now();
-    timing.total_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    job.timing.lane_and_area += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+}
+
+void Yolopv2::compose(FrameJob& job) {
+    // 只打包发布结果, 绘制在显示时由 compositor 完成
+    job.timing.model_inference = job.timing.lane_and_area + job.timing.object_detection;
+    job.timing.total_time = (frame_timestamp_now() - job.start) / 1000000.0;
+
+    job.timing.dropped_before_inference = dropped_before_inference;
+
+    ResultSlot& slot = result_frames.write_buffer();
+    DetectionResult& result = slot.result;
+    result.frame_id = job.frame_id;
+    result.capture_timestamp = job.timing.capture_timestamp;
+    result.img_w = job.img_w;
+    result.img_h = job.img_h;
+    result.zoom = job.zoom;
+    result.enable_drivable_area = job.enable_drivable_area;
+    result.enable_lane_detection = job.enable_lane_detection;
+    result.enable_object_detection = job.enable_object_detection;
+    result.objects.swap(job.objects);
+    result.seg_labels = job.seg_labels;
+    result.mask_scale = job.scale;
+    slot.timing = job.timing;
+    slot.count = ++processed_count;
+    result_frames.publish();
+
     {
         std::lock_guard<std::mutex> lock(timing_mutex);
-        latest_timing_info = timing;
+        latest_timing_info = job.timing;
     }
 
-    return 0;
-}
\ No newline at end of file
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex);
+        processed_frame_id = job.frame_id;
+    }
+    processed_cv.notify_all();
+}
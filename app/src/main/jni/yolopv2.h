@@ -15,7 +15,9 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#if __ANDROID__
 #include <android/log.h>
+#endif
 #include <net.h>
 #include "cpu.h"
 #include "layer.h"
@@ -25,11 +27,18 @@
 #include <atomic>
 #include <condition_variable>
 #include "yolov8.h" // 添加这行
+#include "framebuffer.h"
+#include "framesource.h"
+#include "inputpyramid.h"
+#include "modelbuffer.h"
+#include "pipeline.h"
+#include "yuv420.h"
 
 
 extern bool g_enable_drivable_area;
 extern bool g_enable_lane_detection;
 extern bool g_enable_object_detection;
+extern bool g_enable_single_network;  // 目标检测改用 yolopv2 自带的检测头, 不跑 yolov8
 extern float g_zoom;
 
 //struct Object {
@@ -38,52 +47,264 @@ extern float g_zoom;
 //    float prob;
 //};
 
+// 时间单位均为 ms, 精度 us
 struct TimingInfo {
+    double preprocess;
     double model_inference;
-    double lane_area_draw;
+    double lane_area_draw;        // 显示时叠加分割结果
     double lane_and_area;
     double object_detection;
-    double object_drawing;
-    double total_time;
+    double object_drawing;        // 显示时绘制检测框
+    double total_time;            // 进入预处理 -> 结果发布, 含各级队列等待
+
+    int64_t capture_timestamp;    // 该帧采集时间, 见 frame_timestamp_now()
+    double capture_to_inference;  // 采集 -> 开始推理
+
+    int dropped_before_inference; // 没来得及推理就被新帧覆盖的帧数, 累计
+    int dropped_before_display;   // 推理完成但没被显示就被覆盖的帧数, 累计
+};
+
+// 一帧的推理结果, 显示时由 compositor 叠加到最新的相机画面上
+// 结果所在的画面: 相机 roi 转正后为 img_w x img_h, 再以中心放大 zoom 倍
+struct DetectionResult {
+    int frame_id;
+    int64_t capture_timestamp;
+
+    int img_w;
+    int img_h;
+    float zoom;
+
+    bool enable_drivable_area;
+    bool enable_lane_detection;
+    bool enable_object_detection;
+
+    // 画面坐标
+    std::vector<Object> objects;
+
+    // 网络分辨率的 CV_8UC1 标签图, 已去掉 padding, 画面坐标乘 mask_scale 得到标签坐标
+    cv::Mat seg_labels;
+    float mask_scale;
+};
+
+// seg_labels 的取值, 车道线覆盖可行驶区域
+enum {
+    SEG_NONE = 0,
+    SEG_DRIVABLE_AREA = 1,
+    SEG_LANE_LINE = 2
+};
+
+// 流水线各级, 相邻两级之间是一个有界队列, 不同级可以同时处理相邻的帧
+enum {
+    STAGE_PREPROCESS = 0,
+    STAGE_YOLOPV2,
+    STAGE_YOLOV8,
+    STAGE_POSTPROCESS,
+    STAGE_COMPOSE,
+    STAGE_COUNT
+};
+
+// 两个网络及其加载状态, 两个网络并行加载, 先就绪的先开始推理
+enum {
+    NET_YOLOPV2 = 0,   // 可行驶区域和车道线, 单网络模式下还有目标检测
+    NET_YOLOV8,        // 目标检测
+    NET_COUNT
+};
+
+enum {
+    NET_LOADING = 0,
+    NET_READY,
+    NET_FAILED,
+    NET_SKIPPED    // 开始加载时用不到, 没有加载
+};
+
+// 一个网络使用的线程数和绑定的核
+struct NetThreadConfig {
+    int num_threads;
+    ncnn::CpuSet affinity;  // 为空时不改变绑核
 };
 
 class Yolopv2 {
 public:
     Yolopv2();
     ~Yolopv2();
-    int load(AAssetManager* mgr, bool use_gpu = false);
+    // 在后台线程里同时加载两个网络, 立即返回, 之后马上可以 startThreads, 哪个网络先就绪就先跑它的任务
+    // 此时处于单网络模式则不加载 yolov8, 它的状态为 NET_SKIPPED, 之后切回双网络模式要重新加载
+    // map_weights 时 .bin 映射进内存后原地引用, 不再读一份拷贝到网络里
+#if __ANDROID__
+    void startLoading(AAssetManager* mgr, bool use_gpu = false, bool map_weights = true);
+#else
+    // model_dir 下需要 yolopv2.param/bin 和 yolov8n.param/bin
+    void startLoading(const char* model_dir, bool use_gpu = false, bool map_weights = true);
+#endif
+    // 阻塞到开始加载的网络都加载结束, 都成功返回 0
+    int waitLoaded();
+    // startLoading + waitLoaded
+#if __ANDROID__
+    int load(AAssetManager* mgr, bool use_gpu = false, bool map_weights = true);
+#else
+    int load(const char* model_dir, bool use_gpu = false, bool map_weights = true);
+#endif
+    // NET_LOADING / NET_READY / NET_FAILED / NET_SKIPPED
+    int getNetState(int net) const;
+    // 解析/权重/管线创建/首次推理各阶段耗时, 首次推理在就绪后的第一次推理完成时填上
+    LoadPhases getLoadPhases(int net) const;
+    // 加载时裁掉 yolopv2 里只通向用不到的输出的层, 省下它们的权重和管线创建
+    // 分割输出总是保留, 检测头只在 startLoading 时处于单网络模式才保留, 之后切到单网络模式要重新加载
+    // 需要在 startLoading 之前设置, 默认裁剪
+    void setPruneUnusedOutputs(bool prune) { prune_unused_outputs = prune; }
+    // 可以在加载期间调用, 线程运行期间不能再次加载
     void startThreads();
     void stopThreads();
-    cv::Mat getLatestProcessedFrame();
-    void updateLatestFrame(const cv::Mat& frame);
+    // 每级输入队列的容量, 需要在 startThreads 之前设置
+    void setPipelineDepth(int depth);
+    // 两个网络各自的线程池配置, 需要在 startThreads 之前设置
+    // concurrent 为 true 时同一帧的 yolopv2 和 yolov8 同时运行, 两边都完成后再进入后处理,
+    // 此时两个网络应该绑在不相交的核上
+    void setNetThreads(const NetThreadConfig& yolopv2_config, const NetThreadConfig& yolov8_config, bool concurrent);
+    // 各级的占用率和队列等待, 从 startThreads 开始累计
+    std::vector<StageStats> getStageStats() const;
+    // 只能在一个线程(显示线程)里调用, 还没有结果时返回 false
+    // timing 可选, 返回与该结果对应的时间信息
+    bool getLatestResult(DetectionResult& result, TimingInfo* timing = 0);
+    // 只能在一个线程(采集线程)里调用, roi 的 nv21 只需要在调用期间有效
+    // 返回该帧的 id
+    int updateLatestFrame(const Nv21Roi& roi, int64_t timestamp);
+    // 阻塞直到 frame_id 或更新的帧处理完成
+    void waitProcessedFrame(int frame_id);
     TimingInfo getLatestTimingInfo() const;
+    // 两个网络的输入边长, 用来挑选相机的推理流尺寸, 与模型是否加载无关
+    static int getYolopv2TargetSize() { return yolopv2_target_size; }
+    static int getYolov8TargetSize() { return yolov8_target_size; }
 
 private:
+    // 一帧在流水线中的全部中间状态, 依次经过各级
+    struct FrameJob {
+        int frame_id;
+        int64_t start;     // 进入预处理的时间
+        int64_t enqueued;  // 进入当前队列的时间
+
+        cv::Mat nv21;      // roi 区域的紧凑 nv21 拷贝, 预处理之后释放
+        Nv21Roi roi;       // 网络输入区域, 已按 zoom 裁剪, 预处理之后不再指向像素
+        int img_w;         // 画面大小, 即 roi 转正后的大小
+        int img_h;
+        float zoom;
+
+        bool enable_drivable_area;
+        bool enable_lane_detection;
+        bool enable_object_detection;
+        bool single_network;
+
+        float scale;
+        int wpad;
+        int hpad;
+        ncnn::Mat in_pad;
+        Letterbox v8_letterbox;
+        ncnn::Mat in_pad_v8;
+
+        ncnn::Mat da;
+        ncnn::Mat ll;
+        cv::Mat seg_labels;
+        std::vector<Object> objects;
+
+        TimingInfo timing;
+    };
+
     Yolov8 yolov8; // 添加这个成员
 
+    ModelBuffer yolopv2_weights;         // 网络引用着它, 要在网络之后释放
+    LoadPhases yolopv2_phases;           // 加载线程写, 就绪时拷到 load_phases
     std::unique_ptr<ncnn::Net> yolopv2;  // 使用智能指针管理 ncnn::Net
     std::mutex net_mutex;                // 添加互斥锁保护网络访问
 
-    ncnn::UnlockedPoolAllocator blob_pool_allocator;
+    // 输出 blob 会在下一级线程里释放, 需要线程安全的分配器
+    ncnn::PoolAllocator blob_pool_allocator;
     ncnn::PoolAllocator workspace_pool_allocator;
 
-    const int yolopv2_target_size = 320;
-    const int yolov8_target_size = 640;
+    static const int yolopv2_target_size = 320;
+    static const int yolov8_target_size = 640;
     const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
 
-    std::vector<Object> objects;
-    std::mutex objects_mutex;
+    // 两个网络的输入由同一次 nv21 重采样派生, 只在预处理线程使用
+    InputPyramid input_pyramid;
 
-    cv::Mat latest_frame;
-    cv::Mat latest_processed_frame;
+    // 采集 -> 流水线
+    struct InputSlot {
+        cv::Mat nv21;      // roi 区域的紧凑 nv21 拷贝
+        Nv21Roi roi;
+        int64_t timestamp;
+        int64_t updated;
+        int frame_id;
+    };
+
+    // 流水线 -> 显示
+    struct ResultSlot {
+        DetectionResult result;
+        TimingInfo timing;
+        int count;
+    };
+
+    // 两端都只交换槽位下标, 像素和 mask 按引用计数共享
+    TripleBuffer<InputSlot> input_frames;
+    TripleBuffer<ResultSlot> result_frames;
+
+    int latest_frame_id;                        // 采集线程
+    int processed_count;                        // 发布线程
+    int displayed_count;                        // 显示线程
+    int dropped_before_display;                 // 显示线程
+    std::atomic<int> dropped_before_inference;
+
+    // 只用于睡眠和唤醒, 不保护像素
     std::mutex frame_mutex;
     std::condition_variable frame_cv;
+    std::condition_variable processed_cv;
+    int processed_frame_id;
 
-    std::thread inference_thread;
+    std::thread stage_threads[STAGE_COUNT];
     std::atomic<bool> stop_threads;
 
-    void inferenceThreadFunction();
-    int detect(cv::Mat& rgb, TimingInfo& timing);
+    // stage_queues[i] 是第 i + 1 级的输入
+    int pipeline_depth;
+    BoundedQueue<std::unique_ptr<FrameJob> > stage_queues[STAGE_COUNT - 1];
+    StageMetrics stage_metrics[STAGE_COUNT];
+    mutable std::mutex metrics_mutex;
+
+    NetThreadConfig yolopv2_thread_config;
+    NetThreadConfig yolov8_thread_config;
+    bool concurrent_nets;
+    // 并行模式下 yolopv2 级把帧交给 yolov8 级, 再从 join 取回
+    BoundedQueue<FrameJob*> yolov8_fork;
+    BoundedQueue<FrameJob*> yolov8_join;
+
+    void resetNet(bool use_gpu);
+    std::vector<int> yolopv2Outputs() const;
+    void beginLoading();
+    void finishLoading(int net, int ret);
+    void joinLoaders();
+    void logFirstInference(int net);
+    bool netReady(int net) const { return net_states[net] == NET_READY; }
+
+    // 加载线程写, 就绪之前推理各级不碰对应的网络
+    std::thread load_threads[NET_COUNT];
+    std::atomic<int> net_states[NET_COUNT];
+    std::atomic<int64_t> ready_times[NET_COUNT];  // 第一次推理完成后清零
+    LoadPhases load_phases[NET_COUNT];
+    int64_t load_begin;
+    long load_rss_before;
+    bool prune_unused_outputs;
+    std::atomic<bool> yolopv2_detection_heads;   // 加载的 yolopv2 带着检测头
+    mutable std::mutex load_mutex;                // 保护 load_phases, 线程配置和网络的线程数
+    std::condition_variable load_cv;
+
+    void stageThreadFunction(int stage);
+    void yolov8ForkThreadFunction();
+    void recordStage(int stage, int64_t begin, int64_t end, int64_t queue_wait, int64_t blocked);
+    std::unique_ptr<FrameJob> takeLatestFrame();
+    void preprocess(FrameJob& job);
+    void runYolopv2(FrameJob& job);
+    void runYolov8(FrameJob& job);
+    void decodeYolopv2Detections(ncnn::Extractor& ex, FrameJob& job);
+    void postprocess(FrameJob& job);
+    void compose(FrameJob& job);
     mutable std::mutex timing_mutex;
     TimingInfo latest_timing_info;
 };
\ No newline at end of file
@@ -0,0 +1,417 @@
+// generated by tools/ncnnparam2bin.py from yolopv2.param, do not edit
+#ifndef NCNN_INCLUDE_GUARD_yolopv2_id_h
+#define NCNN_INCLUDE_GUARD_yolopv2_id_h
+namespace yolopv2_param_id {
+const int BLOB_images = 0;
+const int BLOB_model_105_ia_0_implicit = 1;
+const int BLOB_model_105_ia_1_implicit = 2;
+const int BLOB_model_105_ia_2_implicit = 3;
+const int BLOB_model_105_im_0_implicit = 4;
+const int BLOB_model_105_im_1_implicit = 5;
+const int BLOB_model_105_im_2_implicit = 6;
+const int BLOB_input0 = 7;
+const int BLOB_onnx__Conv_297 = 8;
+const int BLOB_input = 9;
+const int BLOB_onnx__Conv_300 = 10;
+const int BLOB_input_3 = 11;
+const int BLOB_onnx__Conv_303 = 12;
+const int BLOB_input_7 = 13;
+const int BLOB_onnx__Conv_306 = 14;
+const int BLOB_onnx__Conv_306_splitncnn_0 = 15;
+const int BLOB_onnx__Conv_306_splitncnn_1 = 16;
+const int BLOB_input_11 = 17;
+const int BLOB_onnx__Concat_309 = 18;
+const int BLOB_input_15 = 19;
+const int BLOB_onnx__Conv_312 = 20;
+const int BLOB_onnx__Conv_312_splitncnn_0 = 21;
+const int BLOB_onnx__Conv_312_splitncnn_1 = 22;
+const int BLOB_input_19 = 23;
+const int BLOB_onnx__Conv_315 = 24;
+const int BLOB_input_23 = 25;
+const int BLOB_onnx__Conv_318 = 26;
+const int BLOB_onnx__Conv_318_splitncnn_0 = 27;
+const int BLOB_onnx__Conv_318_splitncnn_1 = 28;
+const int BLOB_input_27 = 29;
+const int BLOB_onnx__Conv_321 = 30;
+const int BLOB_input_31 = 31;
+const int BLOB_onnx__Concat_324 = 32;
+const int BLOB_onnx__Conv_325 = 33;
+const int BLOB_input_35 = 34;
+const int BLOB_onnx__MaxPool_328 = 35;
+const int BLOB_onnx__MaxPool_328_splitncnn_0 = 36;
+const int BLOB_onnx__MaxPool_328_splitncnn_1 = 37;
+const int BLOB_input_39 = 38;
+const int BLOB_input_43 = 39;
+const int BLOB_onnx__Concat_332 = 40;
+const int BLOB_input_47 = 41;
+const int BLOB_onnx__Conv_335 = 42;
+const int BLOB_input_51 = 43;
+const int BLOB_onnx__Concat_338 = 44;
+const int BLOB_input_55 = 45;
+const int BLOB_input_55_splitncnn_0 = 46;
+const int BLOB_input_55_splitncnn_1 = 47;
+const int BLOB_input_59 = 48;
+const int BLOB_onnx__Concat_342 = 49;
+const int BLOB_input_63 = 50;
+const int BLOB_onnx__Conv_345 = 51;
+const int BLOB_onnx__Conv_345_splitncnn_0 = 52;
+const int BLOB_onnx__Conv_345_splitncnn_1 = 53;
+const int BLOB_input_67 = 54;
+const int BLOB_onnx__Conv_348 = 55;
+const int BLOB_input_71 = 56;
+const int BLOB_onnx__Conv_351 = 57;
+const int BLOB_onnx__Conv_351_splitncnn_0 = 58;
+const int BLOB_onnx__Conv_351_splitncnn_1 = 59;
+const int BLOB_input_75 = 60;
+const int BLOB_onnx__Conv_354 = 61;
+const int BLOB_input_79 = 62;
+const int BLOB_onnx__Concat_357 = 63;
+const int BLOB_onnx__Conv_358 = 64;
+const int BLOB_input_83 = 65;
+const int BLOB_onnx__MaxPool_361 = 66;
+const int BLOB_onnx__MaxPool_361_splitncnn_0 = 67;
+const int BLOB_onnx__MaxPool_361_splitncnn_1 = 68;
+const int BLOB_onnx__MaxPool_361_splitncnn_2 = 69;
+const int BLOB_input_87 = 70;
+const int BLOB_input_91 = 71;
+const int BLOB_onnx__Concat_365 = 72;
+const int BLOB_input_95 = 73;
+const int BLOB_onnx__Conv_368 = 74;
+const int BLOB_input_99 = 75;
+const int BLOB_onnx__Concat_371 = 76;
+const int BLOB_input_104 = 77;
+const int BLOB_input_104_splitncnn_0 = 78;
+const int BLOB_input_104_splitncnn_1 = 79;
+const int BLOB_input_108 = 80;
+const int BLOB_onnx__Concat_375 = 81;
+const int BLOB_input_112 = 82;
+const int BLOB_onnx__Conv_378 = 83;
+const int BLOB_onnx__Conv_378_splitncnn_0 = 84;
+const int BLOB_onnx__Conv_378_splitncnn_1 = 85;
+const int BLOB_input_116 = 86;
+const int BLOB_onnx__Conv_381 = 87;
+const int BLOB_input_120 = 88;
+const int BLOB_onnx__Conv_384 = 89;
+const int BLOB_onnx__Conv_384_splitncnn_0 = 90;
+const int BLOB_onnx__Conv_384_splitncnn_1 = 91;
+const int BLOB_input_124 = 92;
+const int BLOB_onnx__Conv_387 = 93;
+const int BLOB_input_128 = 94;
+const int BLOB_onnx__Concat_390 = 95;
+const int BLOB_onnx__Conv_391 = 96;
+const int BLOB_input_132 = 97;
+const int BLOB_onnx__MaxPool_394 = 98;
+const int BLOB_onnx__MaxPool_394_splitncnn_0 = 99;
+const int BLOB_onnx__MaxPool_394_splitncnn_1 = 100;
+const int BLOB_onnx__MaxPool_394_splitncnn_2 = 101;
+const int BLOB_input_136 = 102;
+const int BLOB_input_140 = 103;
+const int BLOB_onnx__Concat_398 = 104;
+const int BLOB_input_144 = 105;
+const int BLOB_onnx__Conv_401 = 106;
+const int BLOB_input_148 = 107;
+const int BLOB_onnx__Concat_404 = 108;
+const int BLOB_input_152 = 109;
+const int BLOB_input_152_splitncnn_0 = 110;
+const int BLOB_input_152_splitncnn_1 = 111;
+const int BLOB_input_156 = 112;
+const int BLOB_onnx__Concat_408 = 113;
+const int BLOB_input_160 = 114;
+const int BLOB_onnx__Conv_411 = 115;
+const int BLOB_onnx__Conv_411_splitncnn_0 = 116;
+const int BLOB_onnx__Conv_411_splitncnn_1 = 117;
+const int BLOB_input_164 = 118;
+const int BLOB_onnx__Conv_414 = 119;
+const int BLOB_input_168 = 120;
+const int BLOB_onnx__Conv_417 = 121;
+const int BLOB_onnx__Conv_417_splitncnn_0 = 122;
+const int BLOB_onnx__Conv_417_splitncnn_1 = 123;
+const int BLOB_input_172 = 124;
+const int BLOB_onnx__Conv_420 = 125;
+const int BLOB_input_176 = 126;
+const int BLOB_onnx__Concat_423 = 127;
+const int BLOB_onnx__Conv_424 = 128;
+const int BLOB_input_180 = 129;
+const int BLOB_onnx__Conv_427 = 130;
+const int BLOB_onnx__Conv_427_splitncnn_0 = 131;
+const int BLOB_onnx__Conv_427_splitncnn_1 = 132;
+const int BLOB_input_184 = 133;
+const int BLOB_onnx__Conv_430 = 134;
+const int BLOB_input_188 = 135;
+const int BLOB_onnx__Conv_433 = 136;
+const int BLOB_input_192 = 137;
+const int BLOB_onnx__MaxPool_436 = 138;
+const int BLOB_onnx__MaxPool_436_splitncnn_0 = 139;
+const int BLOB_onnx__MaxPool_436_splitncnn_1 = 140;
+const int BLOB_onnx__MaxPool_436_splitncnn_2 = 141;
+const int BLOB_onnx__MaxPool_436_splitncnn_3 = 142;
+const int BLOB_onnx__Concat_437 = 143;
+const int BLOB_onnx__Concat_438 = 144;
+const int BLOB_onnx__Concat_439 = 145;
+const int BLOB_input_196 = 146;
+const int BLOB_input0_3 = 147;
+const int BLOB_onnx__Conv_443 = 148;
+const int BLOB_input_200 = 149;
+const int BLOB_onnx__Concat_446 = 150;
+const int BLOB_input_204 = 151;
+const int BLOB_onnx__Concat_449 = 152;
+const int BLOB_input0_7 = 153;
+const int BLOB_input0_11 = 154;
+const int BLOB_onnx__Conv_453 = 155;
+const int BLOB_onnx__Conv_453_splitncnn_0 = 156;
+const int BLOB_onnx__Conv_453_splitncnn_1 = 157;
+const int BLOB_input_208 = 158;
+const int BLOB_onnx__Resize_456 = 159;
+const int BLOB_onnx__Concat_461 = 160;
+const int BLOB_input_212 = 161;
+const int BLOB_onnx__Concat_464 = 162;
+const int BLOB_input_216 = 163;
+const int BLOB_input_216_splitncnn_0 = 164;
+const int BLOB_input_216_splitncnn_1 = 165;
+const int BLOB_input_216_splitncnn_2 = 166;
+const int BLOB_input_220 = 167;
+const int BLOB_onnx__Concat_468 = 168;
+const int BLOB_input_224 = 169;
+const int BLOB_onnx__Conv_471 = 170;
+const int BLOB_onnx__Conv_471_splitncnn_0 = 171;
+const int BLOB_onnx__Conv_471_splitncnn_1 = 172;
+const int BLOB_input_228 = 173;
+const int BLOB_onnx__Conv_474 = 174;
+const int BLOB_onnx__Conv_474_splitncnn_0 = 175;
+const int BLOB_onnx__Conv_474_splitncnn_1 = 176;
+const int BLOB_input_232 = 177;
+const int BLOB_onnx__Conv_477 = 178;
+const int BLOB_onnx__Conv_477_splitncnn_0 = 179;
+const int BLOB_onnx__Conv_477_splitncnn_1 = 180;
+const int BLOB_input_236 = 181;
+const int BLOB_onnx__Conv_480 = 182;
+const int BLOB_onnx__Conv_480_splitncnn_0 = 183;
+const int BLOB_onnx__Conv_480_splitncnn_1 = 184;
+const int BLOB_input_240 = 185;
+const int BLOB_onnx__Concat_483 = 186;
+const int BLOB_onnx__Conv_484 = 187;
+const int BLOB_input_244 = 188;
+const int BLOB_onnx__Conv_487 = 189;
+const int BLOB_onnx__Conv_487_splitncnn_0 = 190;
+const int BLOB_onnx__Conv_487_splitncnn_1 = 191;
+const int BLOB_input_248 = 192;
+const int BLOB_onnx__Resize_490 = 193;
+const int BLOB_onnx__Concat_495 = 194;
+const int BLOB_input_252 = 195;
+const int BLOB_onnx__Concat_498 = 196;
+const int BLOB_input_256 = 197;
+const int BLOB_input_256_splitncnn_0 = 198;
+const int BLOB_input_256_splitncnn_1 = 199;
+const int BLOB_input_256_splitncnn_2 = 200;
+const int BLOB_input_256_splitncnn_3 = 201;
+const int BLOB_input_256_splitncnn_4 = 202;
+const int BLOB_input_260 = 203;
+const int BLOB_onnx__Concat_502 = 204;
+const int BLOB_input_264 = 205;
+const int BLOB_onnx__Conv_505 = 206;
+const int BLOB_onnx__Conv_505_splitncnn_0 = 207;
+const int BLOB_onnx__Conv_505_splitncnn_1 = 208;
+const int BLOB_input_268 = 209;
+const int BLOB_onnx__Conv_508 = 210;
+const int BLOB_onnx__Conv_508_splitncnn_0 = 211;
+const int BLOB_onnx__Conv_508_splitncnn_1 = 212;
+const int BLOB_input_272 = 213;
+const int BLOB_onnx__Conv_511 = 214;
+const int BLOB_onnx__Conv_511_splitncnn_0 = 215;
+const int BLOB_onnx__Conv_511_splitncnn_1 = 216;
+const int BLOB_input_276 = 217;
+const int BLOB_onnx__Conv_514 = 218;
+const int BLOB_onnx__Conv_514_splitncnn_0 = 219;
+const int BLOB_onnx__Conv_514_splitncnn_1 = 220;
+const int BLOB_input_280 = 221;
+const int BLOB_onnx__Concat_517 = 222;
+const int BLOB_onnx__Conv_518 = 223;
+const int BLOB_input_284 = 224;
+const int BLOB_onnx__MaxPool_521 = 225;
+const int BLOB_onnx__MaxPool_521_splitncnn_0 = 226;
+const int BLOB_onnx__MaxPool_521_splitncnn_1 = 227;
+const int BLOB_onnx__MaxPool_521_splitncnn_2 = 228;
+const int BLOB_input_288 = 229;
+const int BLOB_input_292 = 230;
+const int BLOB_onnx__Concat_525 = 231;
+const int BLOB_input_296 = 232;
+const int BLOB_onnx__Conv_528 = 233;
+const int BLOB_input_300 = 234;
+const int BLOB_onnx__Concat_531 = 235;
+const int BLOB_onnx__Conv_532 = 236;
+const int BLOB_onnx__Conv_532_splitncnn_0 = 237;
+const int BLOB_onnx__Conv_532_splitncnn_1 = 238;
+const int BLOB_input_304 = 239;
+const int BLOB_onnx__Concat_535 = 240;
+const int BLOB_input_308 = 241;
+const int BLOB_onnx__Conv_538 = 242;
+const int BLOB_onnx__Conv_538_splitncnn_0 = 243;
+const int BLOB_onnx__Conv_538_splitncnn_1 = 244;
+const int BLOB_input_312 = 245;
+const int BLOB_onnx__Conv_541 = 246;
+const int BLOB_onnx__Conv_541_splitncnn_0 = 247;
+const int BLOB_onnx__Conv_541_splitncnn_1 = 248;
+const int BLOB_input_316 = 249;
+const int BLOB_onnx__Conv_544 = 250;
+const int BLOB_onnx__Conv_544_splitncnn_0 = 251;
+const int BLOB_onnx__Conv_544_splitncnn_1 = 252;
+const int BLOB_input_320 = 253;
+const int BLOB_onnx__Conv_547 = 254;
+const int BLOB_onnx__Conv_547_splitncnn_0 = 255;
+const int BLOB_onnx__Conv_547_splitncnn_1 = 256;
+const int BLOB_input_324 = 257;
+const int BLOB_onnx__Concat_550 = 258;
+const int BLOB_onnx__Conv_551 = 259;
+const int BLOB_input_328 = 260;
+const int BLOB_onnx__MaxPool_554 = 261;
+const int BLOB_onnx__MaxPool_554_splitncnn_0 = 262;
+const int BLOB_onnx__MaxPool_554_splitncnn_1 = 263;
+const int BLOB_onnx__MaxPool_554_splitncnn_2 = 264;
+const int BLOB_input_332 = 265;
+const int BLOB_input_336 = 266;
+const int BLOB_onnx__Concat_558 = 267;
+const int BLOB_input_340 = 268;
+const int BLOB_onnx__Conv_561 = 269;
+const int BLOB_input_344 = 270;
+const int BLOB_onnx__Concat_564 = 271;
+const int BLOB_onnx__Conv_565 = 272;
+const int BLOB_onnx__Conv_565_splitncnn_0 = 273;
+const int BLOB_onnx__Conv_565_splitncnn_1 = 274;
+const int BLOB_input_348 = 275;
+const int BLOB_onnx__Concat_568 = 276;
+const int BLOB_input_352 = 277;
+const int BLOB_onnx__Conv_571 = 278;
+const int BLOB_onnx__Conv_571_splitncnn_0 = 279;
+const int BLOB_onnx__Conv_571_splitncnn_1 = 280;
+const int BLOB_input_356 = 281;
+const int BLOB_onnx__Conv_574 = 282;
+const int BLOB_onnx__Conv_574_splitncnn_0 = 283;
+const int BLOB_onnx__Conv_574_splitncnn_1 = 284;
+const int BLOB_input_360 = 285;
+const int BLOB_onnx__Conv_577 = 286;
+const int BLOB_onnx__Conv_577_splitncnn_0 = 287;
+const int BLOB_onnx__Conv_577_splitncnn_1 = 288;
+const int BLOB_input_364 = 289;
+const int BLOB_onnx__Conv_580 = 290;
+const int BLOB_onnx__Conv_580_splitncnn_0 = 291;
+const int BLOB_onnx__Conv_580_splitncnn_1 = 292;
+const int BLOB_input_368 = 293;
+const int BLOB_onnx__Concat_583 = 294;
+const int BLOB_onnx__Conv_584 = 295;
+const int BLOB_input_372 = 296;
+const int BLOB_onnx__Conv_587 = 297;
+const int BLOB_input_376 = 298;
+const int BLOB_onnx__Add_590 = 299;
+const int BLOB_input_380 = 300;
+const int BLOB_onnx__Add_593 = 301;
+const int BLOB_input_384 = 302;
+const int BLOB_onnx__Add_596 = 303;
+const int BLOB_input_388 = 304;
+const int BLOB_x = 305;
+const int BLOB_onnx__SequenceConstruct_599 = 306;
+const int BLOB_input_392 = 307;
+const int BLOB_x_3 = 308;
+const int BLOB_onnx__SequenceConstruct_602 = 309;
+const int BLOB_input_396 = 310;
+const int BLOB_x_7 = 311;
+const int BLOB_onnx__SequenceConstruct_605 = 312;
+const int BLOB_input_400 = 313;
+const int BLOB_onnx__Resize_611 = 314;
+const int BLOB_input_404 = 315;
+const int BLOB_input_404_splitncnn_0 = 316;
+const int BLOB_input_404_splitncnn_1 = 317;
+const int BLOB_input_408 = 318;
+const int BLOB_onnx__Conv_619 = 319;
+const int BLOB_input_412 = 320;
+const int BLOB_onnx__Conv_622 = 321;
+const int BLOB_input_416 = 322;
+const int BLOB_onnx__Conv_625 = 323;
+const int BLOB_y1 = 324;
+const int BLOB_y2 = 325;
+const int BLOB_input_420 = 326;
+const int BLOB_input0_15 = 327;
+const int BLOB_onnx__Conv_630 = 328;
+const int BLOB_input_424 = 329;
+const int BLOB_onnx__Conv_633 = 330;
+const int BLOB_input_428 = 331;
+const int BLOB_onnx__Resize_636 = 332;
+const int BLOB_input_432 = 333;
+const int BLOB_input_436 = 334;
+const int BLOB_onnx__Resize_644 = 335;
+const int BLOB_input_440 = 336;
+const int BLOB_input_444 = 337;
+const int BLOB_onnx__Conv_652 = 338;
+const int BLOB_onnx__Conv_652_splitncnn_0 = 339;
+const int BLOB_onnx__Conv_652_splitncnn_1 = 340;
+const int BLOB_input_448 = 341;
+const int BLOB_onnx__Conv_655 = 342;
+const int BLOB_input_452 = 343;
+const int BLOB_onnx__Conv_658 = 344;
+const int BLOB_input_456 = 345;
+const int BLOB_onnx__Conv_661 = 346;
+const int BLOB_y1_3 = 347;
+const int BLOB_y2_3 = 348;
+const int BLOB_input_460 = 349;
+const int BLOB_input0_19 = 350;
+const int BLOB_onnx__Conv_666 = 351;
+const int BLOB_input_464 = 352;
+const int BLOB_onnx__Resize_669 = 353;
+const int BLOB_input_468 = 354;
+const int BLOB_677 = 355;
+const int BLOB_10000 = 356;
+const int BLOB_input0_23 = 357;
+const int BLOB_onnx__MatMul_694 = 358;
+const int BLOB_onnx__Reshape_697 = 359;
+const int BLOB_y1_7 = 360;
+const int BLOB_input1 = 361;
+const int BLOB_input0_27 = 362;
+const int BLOB_onnx__ConvTranspose_714 = 363;
+const int BLOB_input_492 = 364;
+const int BLOB_onnx__Conv_718 = 365;
+const int BLOB_onnx__Conv_718_splitncnn_0 = 366;
+const int BLOB_onnx__Conv_718_splitncnn_1 = 367;
+const int BLOB_input_496 = 368;
+const int BLOB_onnx__Conv_721 = 369;
+const int BLOB_input_500 = 370;
+const int BLOB_onnx__Conv_724 = 371;
+const int BLOB_input_504 = 372;
+const int BLOB_onnx__Conv_727 = 373;
+const int BLOB_y1_11 = 374;
+const int BLOB_y2_7 = 375;
+const int BLOB_input_508 = 376;
+const int BLOB_input0_31 = 377;
+const int BLOB_onnx__Conv_732 = 378;
+const int BLOB_input_512 = 379;
+const int BLOB_onnx__Conv_735 = 380;
+const int BLOB_input_516 = 381;
+const int BLOB_onnx__ConvTranspose_738 = 382;
+const int BLOB_input_524 = 383;
+const int BLOB_onnx__Conv_742 = 384;
+const int BLOB_input_528 = 385;
+const int BLOB_onnx__Conv_745 = 386;
+const int BLOB_onnx__Conv_745_splitncnn_0 = 387;
+const int BLOB_onnx__Conv_745_splitncnn_1 = 388;
+const int BLOB_input_532 = 389;
+const int BLOB_onnx__Conv_748 = 390;
+const int BLOB_input_536 = 391;
+const int BLOB_onnx__Conv_751 = 392;
+const int BLOB_input_540 = 393;
+const int BLOB_onnx__Conv_754 = 394;
+const int BLOB_y1_15 = 395;
+const int BLOB_y2_11 = 396;
+const int BLOB_input_544 = 397;
+const int BLOB_input0_35 = 398;
+const int BLOB_onnx__Conv_759 = 399;
+const int BLOB_input_548 = 400;
+const int BLOB_onnx__ConvTranspose_762 = 401;
+const int BLOB_input_556 = 402;
+const int BLOB_onnx__Conv_766 = 403;
+const int BLOB_769 = 404;
+const int BLOB_1177 = 405;
+const int BLOB_det0 = 406;
+const int BLOB_1178 = 407;
+const int BLOB_det1 = 408;
+const int BLOB_1179 = 409;
+const int BLOB_det2 = 410;
+} // namespace yolopv2_param_id
+#endif // NCNN_INCLUDE_GUARD_yolopv2_id_h
@@ -0,0 +1,2076 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// host side micro benchmarks of the per-frame kernels
+// usage: yolopv2bench [case] [loops] [model_dir]
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cpu.h>
+#include <layer.h>
+#include <mat.h>
+#include <net.h>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "compositor.h"
+#include "detpost.h"
+#include "framebuffer.h"
+#include "framepair.h"
+#include "inputpyramid.h"
+#include "modelbuffer.h"
+#include "pipeline.h"
+#include "renderloop.h"
+#include "yuv420.h"
+
+#include "yolopv2.id.h"
+#include "yolov8n.id.h"
+
+static int g_loops = 100;
+// set by the cases that check results, main exits non-zero
+static int g_failed = 0;
+
+template<typename T>
+static double bench_ms(T func)
+{
+    // warm up
+    func();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < g_loops; i++)
+    {
+        func();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0 / g_loops;
+}
+
+// smooth synthetic nv21 frame, so resampling differences stay meaningful
+static void fill_nv21(std::vector<unsigned char>& nv21, int width, int height)
+{
+    nv21.resize(width * height * 3 / 2);
+
+    unsigned char* y = nv21.data();
+    for (int i = 0; i < height; i++)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            y[i * width + j] = (unsigned char)(128 + 100 * sinf(i * 0.05f) * cosf(j * 0.03f));
+        }
+    }
+
+    unsigned char* vu = nv21.data() + width * height;
+    for (int i = 0; i < height / 2; i++)
+    {
+        for (int j = 0; j < width / 2; j++)
+        {
+            vu[i * width + j * 2] = (unsigned char)(128 + 60 * sinf(j * 0.04f));
+            vu[i * width + j * 2 + 1] = (unsigned char)(128 + 60 * cosf(i * 0.06f));
+        }
+    }
+}
+
+static float max_abs_diff(const ncnn::Mat& a, const ncnn::Mat& b)
+{
+    if (a.w != b.w || a.h != b.h || a.c != b.c)
+        return -1.f;
+
+    float d = 0.f;
+    for (int q = 0; q < a.c; q++)
+    {
+        const float* pa = a.channel(q);
+        const float* pb = b.channel(q);
+        for (int i = 0; i < a.w * a.h; i++)
+        {
+            d = std::max(d, fabsf(pa[i] - pb[i]));
+        }
+    }
+    return d;
+}
+
+// letterbox one network input from an upright rgb image, the chain the app used before the fused kernel
+static void letterbox_chain(const unsigned char* rgb, int img_w, int img_h, int target_size, int pixel_type, float pad_value, const float* norm_vals, ncnn::Mat& in_pad)
+{
+    int w = img_w;
+    int h = img_h;
+    if (w > h)
+    {
+        h = h * target_size / w;
+        w = target_size;
+    }
+    else
+    {
+        w = w * target_size / h;
+        h = target_size;
+    }
+    int wpad = (w + 31) / 32 * 32 - w;
+    int hpad = (h + 31) / 32 * 32 - h;
+
+    ncnn::Mat in = ncnn::Mat::from_pixels_resize(rgb, pixel_type, img_w, img_h, w, h);
+    ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, pad_value);
+    in_pad.substract_mean_normalize(0, norm_vals);
+}
+
+static void letterbox_fused(Nv21Resampler& resampler, const Nv21Roi& roi, int target_size, float pad_value, const float* norm_vals, ncnn::Mat& in_pad)
+{
+    int w = roi.upright_w();
+    int h = roi.upright_h();
+    if (w > h)
+    {
+        h = h * target_size / w;
+        w = target_size;
+    }
+    else
+    {
+        w = w * target_size / h;
+        h = target_size;
+    }
+    int wpad = (w + 31) / 32 * 32 - w;
+    int hpad = (h + 31) / 32 * 32 - h;
+
+    nv21_roi_to_tensor(resampler, roi, ncnn::Mat::PIXEL_BGR, w, h, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, pad_value, 0, norm_vals, in_pad);
+}
+
+// the scalar repack onImageAvailable used before yuv420_888_to_nv21
+static void yuv420_888_to_nv21_reference(const Yuv420Plane& y, const Yuv420Plane& u, const Yuv420Plane& v, int width, int height, unsigned char* nv21)
+{
+    unsigned char* yptr = nv21;
+    for (int i = 0; i < height; i++)
+    {
+        const unsigned char* y_data_ptr = y.data + y.row_stride * i;
+        for (int j = 0; j < width; j++)
+        {
+            yptr[0] = y_data_ptr[0];
+            yptr++;
+            y_data_ptr += y.pixel_stride;
+        }
+    }
+
+    unsigned char* uvptr = nv21 + width * height;
+    for (int i = 0; i < height / 2; i++)
+    {
+        const unsigned char* v_data_ptr = v.data + v.row_stride * i;
+        const unsigned char* u_data_ptr = u.data + u.row_stride * i;
+        for (int j = 0; j < width / 2; j++)
+        {
+            uvptr[0] = v_data_ptr[0];
+            uvptr[1] = u_data_ptr[0];
+            uvptr += 2;
+            v_data_ptr += v.pixel_stride;
+            u_data_ptr += u.pixel_stride;
+        }
+    }
+}
+
+// every plane layout a camera hal hands out, with and without row padding, byte exact against the old loop
+static void bench_yuv420_888()
+{
+    struct Layout
+    {
+        const char* name;
+        int y_pixel_stride;
+        // 0 planar u v, 1 interleaved vu, 2 interleaved uv, 3 separate planes of pixel stride 2
+        int chroma;
+    };
+    const Layout layouts[] = {
+        {"vu", 1, 1},
+        {"uv", 1, 2},
+        {"planar", 1, 0},
+        {"strided", 2, 3},
+    };
+    const int sizes[][2] = {{640, 480}, {1000, 562}, {1920, 1080}};
+    const int row_pads[] = {0, 64};
+
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    for (int s = 0; s < 3; s++)
+    {
+        const int width = sizes[s][0];
+        const int height = sizes[s][1];
+
+        for (int l = 0; l < 4; l++)
+        {
+            for (int p = 0; p < 2; p++)
+            {
+                const Layout& layout = layouts[l];
+                const int pad = row_pads[p];
+
+                // padding bytes are random too, reading them shows up as a mismatch
+                Yuv420Plane y_plane = {0, width * layout.y_pixel_stride + pad, layout.y_pixel_stride};
+                std::vector<unsigned char> y_data(y_plane.row_stride * height);
+
+                const int chroma_pixel_stride = layout.chroma == 0 ? 1 : 2;
+                const int chroma_row_stride = width / 2 * chroma_pixel_stride + pad;
+                std::vector<unsigned char> u_data(chroma_row_stride * height / 2);
+                std::vector<unsigned char> v_data(chroma_row_stride * height / 2);
+
+                for (size_t i = 0; i < y_data.size(); i++)
+                    y_data[i] = (unsigned char)byte(rng);
+                for (size_t i = 0; i < u_data.size(); i++)
+                {
+                    u_data[i] = (unsigned char)byte(rng);
+                    v_data[i] = (unsigned char)byte(rng);
+                }
+
+                y_plane.data = y_data.data();
+                Yuv420Plane u_plane = {u_data.data(), chroma_row_stride, chroma_pixel_stride};
+                Yuv420Plane v_plane = {v_data.data(), chroma_row_stride, chroma_pixel_stride};
+                if (layout.chroma == 1)
+                {
+                    // one vu buffer, u is the odd bytes
+                    v_plane.data = u_data.data();
+                    u_plane.data = u_data.data() + 1;
+                }
+                if (layout.chroma == 2)
+                {
+                    v_plane.data = u_data.data() + 1;
+                }
+
+                std::vector<unsigned char> reference(width * height * 3 / 2);
+                std::vector<unsigned char> nv21(width * height * 3 / 2);
+
+                double old_ms = bench_ms([&]() {
+                    yuv420_888_to_nv21_reference(y_plane, u_plane, v_plane, width, height, reference.data());
+                });
+                double new_ms = bench_ms([&]() {
+                    yuv420_888_to_nv21(y_plane, u_plane, v_plane, width, height, nv21.data());
+                });
+
+                int mismatch = 0;
+                for (size_t i = 0; i < nv21.size(); i++)
+                {
+                    mismatch += nv21[i] != reference[i];
+                }
+                if (mismatch)
+                    g_failed = 1;
+
+                fprintf(stderr, "yuv420_888  %4dx%-4d %-7s row pad %2d  scalar %7.3f ms  repack %7.3f ms  mismatch %d bytes  %s\n",
+                        width, height, layout.name, pad, old_ms, new_ms, mismatch, mismatch == 0 ? "ok" : "FAILED");
+            }
+        }
+    }
+}
+
+static void bench_nv21_tensor()
+{
+    // 640x480 back camera frame rotated to portrait, full frame roi
+    const int width = 640;
+    const int height = 480;
+    const int rotate_type = 6;
+    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
+
+    std::vector<unsigned char> nv21;
+    fill_nv21(nv21, width, height);
+
+    const Nv21Roi roi = {nv21.data(), width, height, 0, 0, width, height, rotate_type};
+    const int roi_w = roi.upright_w();
+    const int roi_h = roi.upright_h();
+
+    std::vector<unsigned char> nv21_croprotated(roi_w * roi_h * 3 / 2);
+    std::vector<unsigned char> rgb(roi_w * roi_h * 3);
+
+    ncnn::Mat chain_320, chain_640;
+    double chain_ms = bench_ms([&]() {
+        ncnn::kanna_rotate_c1(nv21.data(), width, height, width, nv21_croprotated.data(), roi_w, roi_h, roi_w, rotate_type);
+        ncnn::kanna_rotate_c2(nv21.data() + width * height, width / 2, height / 2, width, nv21_croprotated.data() + roi_w * roi_h, roi_w / 2, roi_h / 2, roi_w, rotate_type);
+        ncnn::yuv420sp2rgb(nv21_croprotated.data(), roi_w, roi_h, rgb.data());
+        letterbox_chain(rgb.data(), roi_w, roi_h, 320, ncnn::Mat::PIXEL_BGR2RGB, 114.f, norm_vals, chain_320);
+        letterbox_chain(rgb.data(), roi_w, roi_h, 640, ncnn::Mat::PIXEL_RGB2BGR, 0.f, norm_vals, chain_640);
+    });
+
+    // one resampler per output size, so each keeps its tables
+    Nv21Resampler resampler_320, resampler_640;
+    ncnn::Mat fused_320, fused_640;
+    double fused_ms = bench_ms([&]() {
+        letterbox_fused(resampler_320, roi, 320, 114.f, norm_vals, fused_320);
+        letterbox_fused(resampler_640, roi, 640, 0.f, norm_vals, fused_640);
+    });
+
+    fprintf(stderr, "nv21_tensor  %dx%d rotate %d\n", width, height, rotate_type);
+    fprintf(stderr, "  chain  %8.3f ms\n", chain_ms);
+    fprintf(stderr, "  fused  %8.3f ms\n", fused_ms);
+    fprintf(stderr, "  max abs diff 320 = %.4f  640 = %.4f\n", max_abs_diff(chain_320, fused_320), max_abs_diff(chain_640, fused_640));
+}
+
+// runs one network forever on its own thread, so its openmp pool and affinity persist across frames
+class NetRunner
+{
+public:
+    NetRunner(ncnn::Net& _net, const char* _input, const char* _output0, const char* _output1, const ncnn::Mat& _in)
+        : net(_net), input(_input), output0(_output0), output1(_output1), in(_in)
+    {
+    }
+
+    void start(int num_threads, const ncnn::CpuSet& affinity)
+    {
+        go.reopen();
+        done.reopen();
+        thread = std::thread([this, num_threads, affinity]() {
+            ncnn::set_omp_num_threads(num_threads);
+            ncnn::set_cpu_thread_affinity(affinity);
+            net.opt.num_threads = num_threads;
+
+            int token;
+            while (go.pop(token))
+            {
+                run();
+                done.push(std::move(token));
+            }
+        });
+    }
+
+    void stop()
+    {
+        go.close();
+        thread.join();
+    }
+
+    void run()
+    {
+        ncnn::Extractor ex = net.create_extractor();
+        ex.input(input, in);
+
+        ncnn::Mat out;
+        ex.extract(output0, out);
+        if (output1)
+            ex.extract(output1, out);
+    }
+
+    void kick()
+    {
+        int token = 0;
+        go.push(std::move(token));
+    }
+
+    void join()
+    {
+        int token;
+        done.pop(token);
+    }
+
+private:
+    ncnn::Net& net;
+    const char* input;
+    const char* output0;
+    const char* output1;
+    ncnn::Mat in;
+
+    BoundedQueue<int> go;
+    BoundedQueue<int> done;
+    std::thread thread;
+};
+
+static ncnn::CpuSet cpu_range(int begin, int end)
+{
+    ncnn::CpuSet mask;
+    mask.disable_all();
+    for (int i = begin; i < end; i++)
+    {
+        mask.enable(i);
+    }
+    return mask;
+}
+
+static int load_net(ncnn::Net& net, const std::string& model_dir, const char* name)
+{
+    net.opt.use_fp16_arithmetic = true;
+    net.opt.use_fp16_packed = true;
+    net.opt.use_fp16_storage = true;
+
+    std::string parampath = model_dir + "/" + name + ".param";
+    std::string modelpath = model_dir + "/" + name + ".bin";
+    if (net.load_param(parampath.c_str()) != 0 || net.load_model(modelpath.c_str()) != 0)
+    {
+        fprintf(stderr, "load %s from %s failed\n", name, model_dir.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+// one network of the model_load case, loaded with its phases recorded
+struct LoadCase
+{
+    const char* name;
+    int input;
+    int output;
+    ncnn::Mat in;
+
+    // before the net, which references it until destroyed
+    ModelBuffer weights;
+    ncnn::Net net;
+    LoadPhases phases;
+    int ret;
+
+    void run(const std::string& model_dir, bool map_weights)
+    {
+        net.opt.use_fp16_arithmetic = true;
+        net.opt.use_fp16_packed = true;
+        net.opt.use_fp16_storage = true;
+
+        std::string parampath = model_dir + "/" + name + ".param.bin";
+        std::string modelpath = model_dir + "/" + name + ".bin";
+        ret = load_net_timed(net, weights, parampath.c_str(), modelpath.c_str(), map_weights, phases);
+        if (ret != 0)
+            return;
+
+        const int64_t loaded = frame_timestamp_now();
+
+        ncnn::Extractor ex = net.create_extractor();
+        ex.input(input, in);
+        ncnn::Mat out;
+        ex.extract(output, out);
+
+        phases.first_inference = (frame_timestamp_now() - loaded) / 1000000.0;
+    }
+};
+
+// copied vs mapped weights, one network after the other vs both at once
+// per network phases, wall time until both have run once, and resident memory
+static void bench_model_load(const char* model_dir)
+{
+    fprintf(stderr, "model_load  yolopv2 + yolov8n from %s\n", model_dir);
+    for (int m = 1; m >= 0; m--)
+    {
+        for (int parallel = 0; parallel < 2; parallel++)
+        {
+            const bool map_weights = m == 1;
+            const long rss_before = resident_memory_kb();
+
+            LoadCase cases[2];
+            cases[0].name = "yolopv2";
+            cases[0].input = yolopv2_param_id::BLOB_images;
+            cases[0].output = yolopv2_param_id::BLOB_677;
+            cases[0].in.create(320, 192, 3);
+            cases[1].name = "yolov8n";
+            cases[1].input = yolov8n_param_id::BLOB_images;
+            cases[1].output = yolov8n_param_id::BLOB_output;
+            cases[1].in.create(640, 384, 3);
+            cases[0].in.fill(0.5f);
+            cases[1].in.fill(0.5f);
+
+            const int64_t begin = frame_timestamp_now();
+            if (parallel)
+            {
+                std::thread other([&]() { cases[1].run(model_dir, map_weights); });
+                cases[0].run(model_dir, map_weights);
+                other.join();
+            }
+            else
+            {
+                cases[0].run(model_dir, map_weights);
+                cases[1].run(model_dir, map_weights);
+            }
+            const double wall_ms = (frame_timestamp_now() - begin) / 1000000.0;
+
+            if (cases[0].ret != 0 || cases[1].ret != 0)
+            {
+                fprintf(stderr, "load from %s failed\n", model_dir);
+                return;
+            }
+
+            fprintf(stderr, "  %s %s  both ran once after %8.2f ms  rss %+7ld kB\n",
+                    map_weights ? "mapped" : "copied", parallel ? "parallel" : "serial  ", wall_ms, resident_memory_kb() - rss_before);
+            for (int i = 0; i < 2; i++)
+            {
+                const LoadPhases& p = cases[i].phases;
+                fprintf(stderr, "    %-8s param %7.2f  weights %7.2f  pipeline %7.2f  first inference %7.2f ms\n",
+                        cases[i].name, p.param, p.weights, p.pipeline, p.first_inference);
+            }
+        }
+    }
+}
+
+// the whole yolopv2 graph vs the one the dual network mode loads, with the layers only det0/1/2 need pruned
+// load time, resident and peak memory until the first inference, and whether the segmentation stays the same
+static void bench_prune_heads(const char* model_dir)
+{
+    std::vector<int> seg_outputs;
+    seg_outputs.push_back(yolopv2_param_id::BLOB_677);
+    seg_outputs.push_back(yolopv2_param_id::BLOB_769);
+
+    ncnn::Mat in(320, 192, 3);
+    for (int q = 0; q < 3; q++)
+    {
+        float* ptr = in.channel(q);
+        for (int i = 0; i < in.w * in.h; i++)
+        {
+            ptr[i] = 0.5f + 0.4f * sinf(i * 0.013f + q);
+        }
+    }
+
+    const std::string parampath = std::string(model_dir) + "/yolopv2.param.bin";
+    const std::string modelpath = std::string(model_dir) + "/yolopv2.bin";
+    const int loops = std::max(g_loops, 1);
+
+    fprintf(stderr, "prune_heads  yolopv2 from %s, %d loads each\n", model_dir, loops);
+
+    ncnn::Mat whole_da, whole_ll;
+    for (int pruned = 0; pruned < 2; pruned++)
+    {
+        double load_ms = 0;
+        double first_ms = 0;
+        long rss_kb = 0;
+        long peak_kb = 0;
+        LoadPhases phases;
+        bool heads = false;
+        float seg_diff = 0.f;
+
+        for (int i = 0; i < loops; i++)
+        {
+            const long rss_before = resident_memory_kb();
+            reset_peak_resident_memory();
+            const long peak_before = peak_resident_memory_kb();
+
+            // before the net, which references it until destroyed
+            ModelBuffer weights;
+            ncnn::Net net;
+            net.opt.use_fp16_arithmetic = true;
+            net.opt.use_fp16_packed = true;
+            net.opt.use_fp16_storage = true;
+
+            const int64_t begin = frame_timestamp_now();
+            if (load_net_timed(net, weights, parampath.c_str(), modelpath.c_str(), true, phases, pruned ? seg_outputs : std::vector<int>()) != 0)
+            {
+                fprintf(stderr, "load yolopv2 from %s failed\n", model_dir);
+                return;
+            }
+            const int64_t loaded = frame_timestamp_now();
+
+            ncnn::Extractor ex = net.create_extractor();
+            ex.input(yolopv2_param_id::BLOB_images, in);
+            ncnn::Mat da, ll;
+            ex.extract(yolopv2_param_id::BLOB_677, da);
+            ex.extract(yolopv2_param_id::BLOB_769, ll);
+            const int64_t ran = frame_timestamp_now();
+
+            load_ms += (loaded - begin) / 1000000.0;
+            first_ms += (ran - loaded) / 1000000.0;
+            rss_kb += resident_memory_kb() - rss_before;
+            peak_kb += peak_resident_memory_kb() - peak_before;
+
+            // a pruned head fails to extract
+            ncnn::Mat det;
+            heads = ex.extract(yolopv2_param_id::BLOB_det0, det) == 0;
+
+            if (!pruned)
+            {
+                whole_da = da.clone();
+                whole_ll = ll.clone();
+            }
+            else
+            {
+                seg_diff = std::max(max_abs_diff(whole_da, da), max_abs_diff(whole_ll, ll));
+            }
+        }
+
+        fprintf(stderr, "  %s  pruned %3d layers %7.2f MB  load %8.2f ms  first inference %8.2f ms  rss %+7ld kB  peak %+7ld kB  det0 %s",
+                pruned ? "pruned" : "whole ", phases.pruned_layers, phases.pruned_bytes / 1048576.0, load_ms / loops, first_ms / loops,
+                rss_kb / loops, peak_kb / loops, heads ? "extracted" : "gone");
+        if (pruned)
+            fprintf(stderr, "  seg max diff %.6f", seg_diff);
+        fprintf(stderr, "\n");
+    }
+}
+
+// objects from yolopv2's own anchor heads vs a second yolov8n pass, frame time and memory
+// yolopv2 alone is measured first, so the memory of the second network is the later delta
+static void bench_single_net(const char* model_dir)
+{
+    // network inputs of a 1280x720 frame
+    const Letterbox lb_yolopv2 = make_letterbox(1280, 720, 320, 32);
+    const Letterbox lb_yolov8 = make_letterbox(1280, 720, 640, 32);
+    ncnn::Mat in_yolopv2(lb_yolopv2.w + lb_yolopv2.left + lb_yolopv2.right, lb_yolopv2.h + lb_yolopv2.top + lb_yolopv2.bottom, 3);
+    ncnn::Mat in_yolov8(lb_yolov8.w + lb_yolov8.left + lb_yolov8.right, lb_yolov8.h + lb_yolov8.top + lb_yolov8.bottom, 3);
+    in_yolopv2.fill(0.5f);
+    in_yolov8.fill(0.5f);
+
+    const long rss_base = resident_memory_kb();
+
+    ncnn::Net yolopv2;
+    ncnn::PoolAllocator yolopv2_blob_allocator;
+    ncnn::PoolAllocator yolopv2_workspace_allocator;
+    yolopv2.opt.blob_allocator = &yolopv2_blob_allocator;
+    yolopv2.opt.workspace_allocator = &yolopv2_workspace_allocator;
+    if (load_net(yolopv2, model_dir, "yolopv2") != 0)
+        return;
+
+    const long rss_yolopv2_loaded = resident_memory_kb();
+
+    std::vector<Object> proposals;
+    std::vector<int> picked;
+    int single_count = 0;
+    double single_ms = bench_ms([&]() {
+        ncnn::Extractor ex = yolopv2.create_extractor();
+        ex.input("images", in_yolopv2);
+
+        ncnn::Mat da, ll;
+        ex.extract("677", da);
+        ex.extract("769", ll);
+
+        const char* heads[3] = {"det0", "det1", "det2"};
+        const int strides[3] = {8, 16, 32};
+        proposals.clear();
+        for (int i = 0; i < 3; i++)
+        {
+            ncnn::Mat det;
+            ex.extract(heads[i], det);
+            generate_anchor_proposals(det, in_yolopv2.w / strides[i], in_yolopv2.h / strides[i], strides[i], YOLOV7_ANCHORS[i], 3, 80, 0.3f, proposals);
+        }
+        rank_proposals(proposals, 1000);
+        nms_sorted_bboxes(proposals, picked, 0.45f, false, 300);
+        single_count = (int)picked.size();
+    });
+
+    const long rss_single = resident_memory_kb();
+
+    ncnn::Net yolov8;
+    ncnn::PoolAllocator yolov8_blob_allocator;
+    ncnn::PoolAllocator yolov8_workspace_allocator;
+    yolov8.opt.blob_allocator = &yolov8_blob_allocator;
+    yolov8.opt.workspace_allocator = &yolov8_workspace_allocator;
+    if (load_net(yolov8, model_dir, "yolov8n") != 0)
+        return;
+
+    const long rss_yolov8_loaded = resident_memory_kb();
+
+    AnchorTable anchors;
+    int two_count = 0;
+    double two_ms = bench_ms([&]() {
+        {
+            ncnn::Extractor ex = yolopv2.create_extractor();
+            ex.input("images", in_yolopv2);
+
+            ncnn::Mat da, ll;
+            ex.extract("677", da);
+            ex.extract("769", ll);
+        }
+
+        ncnn::Extractor ex = yolov8.create_extractor();
+        ex.input("images", in_yolov8);
+
+        ncnn::Mat out;
+        ex.extract("output", out);
+
+        const int strides[3] = {8, 16, 32};
+        update_anchor_table(anchors, in_yolov8.w, in_yolov8.h, strides, 3);
+        proposals.clear();
+        generate_dfl_proposals(anchors, out, 80, 16, 0.3f, proposals);
+        rank_proposals(proposals, 1000);
+        nms_sorted_bboxes(proposals, picked, 0.45f, false, 300);
+        two_count = (int)picked.size();
+    });
+
+    const long rss_two = resident_memory_kb();
+
+    fprintf(stderr, "single_net  inputs %dx%d + %dx%d\n", in_yolopv2.w, in_yolopv2.h, in_yolov8.w, in_yolov8.h);
+    fprintf(stderr, "  single  %8.3f ms  %3d objects  rss model %6ld kB  running %6ld kB\n",
+            single_ms, single_count, rss_yolopv2_loaded - rss_base, rss_single - rss_base);
+    fprintf(stderr, "  two     %8.3f ms  %3d objects  rss model %6ld kB  running %6ld kB  (yolov8n adds %ld kB)\n",
+            two_ms, two_count, rss_yolov8_loaded - rss_single + rss_yolopv2_loaded - rss_base, rss_two - rss_base, rss_two - rss_single);
+}
+
+// serial: yolopv2 then yolov8 with all cores each
+// concurrent: both at once on disjoint core ranges, joined per frame
+static void bench_nets(const char* model_dir)
+{
+    ncnn::Net yolopv2;
+    ncnn::Net yolov8;
+    if (load_net(yolopv2, model_dir, "yolopv2") != 0 || load_net(yolov8, model_dir, "yolov8n") != 0)
+        return;
+
+    // letterboxed inputs of a 640x480 frame
+    ncnn::Mat in_yolopv2(320, 256, 3);
+    ncnn::Mat in_yolov8(640, 480, 3);
+    in_yolopv2.fill(0.5f);
+    in_yolov8.fill(0.5f);
+
+    NetRunner yolopv2_runner(yolopv2, "images", "677", "769", in_yolopv2);
+    NetRunner yolov8_runner(yolov8, "images", "output", 0, in_yolov8);
+
+    const int cpu_count = ncnn::get_cpu_count();
+
+    fprintf(stderr, "nets  %d cpus\n", cpu_count);
+
+    {
+        const ncnn::CpuSet all = cpu_range(0, cpu_count);
+
+        yolopv2_runner.start(cpu_count, all);
+        yolov8_runner.start(cpu_count, all);
+
+        double yolopv2_ms = bench_ms([&]() {
+            yolopv2_runner.kick();
+            yolopv2_runner.join();
+        });
+        double yolov8_ms = bench_ms([&]() {
+            yolov8_runner.kick();
+            yolov8_runner.join();
+        });
+        double serial_ms = bench_ms([&]() {
+            yolopv2_runner.kick();
+            yolopv2_runner.join();
+            yolov8_runner.kick();
+            yolov8_runner.join();
+        });
+
+        yolopv2_runner.stop();
+        yolov8_runner.stop();
+
+        fprintf(stderr, "  serial      %2d + %2d  %8.3f ms  (yolopv2 %.3f  yolov8 %.3f)\n", cpu_count, cpu_count, serial_ms, yolopv2_ms, yolov8_ms);
+    }
+
+    for (int k = 1; k < cpu_count; k++)
+    {
+        yolopv2_runner.start(k, cpu_range(0, k));
+        yolov8_runner.start(cpu_count - k, cpu_range(k, cpu_count));
+
+        double concurrent_ms = bench_ms([&]() {
+            yolopv2_runner.kick();
+            yolov8_runner.kick();
+            yolopv2_runner.join();
+            yolov8_runner.join();
+        });
+
+        yolopv2_runner.stop();
+        yolov8_runner.stop();
+
+        fprintf(stderr, "  concurrent  %2d + %2d  %8.3f ms\n", k, cpu_count - k, concurrent_ms);
+    }
+}
+
+// producer and consumer hammer a triple buffer of preallocated buffers,
+// every buffer is filled with its sequence number so a torn or stale read shows up
+static void bench_triple_buffer()
+{
+    struct Slot
+    {
+        int seq;
+        std::vector<int> pixels;
+    };
+
+    const int total = 100000 * std::max(g_loops / 100, 1);
+    const int pixel_count = 64 * 64;
+
+    TripleBuffer<Slot> buffer;
+
+    std::thread producer([&]() {
+        for (int seq = 1; seq <= total; seq++)
+        {
+            Slot& slot = buffer.write_buffer();
+            slot.pixels.resize(pixel_count);
+            std::fill(slot.pixels.begin(), slot.pixels.end(), seq);
+            slot.seq = seq;
+            buffer.publish();
+        }
+    });
+
+    int last_seq = 0;
+    int received = 0;
+    int torn = 0;
+    int reordered = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    while (last_seq < total)
+    {
+        if (!buffer.acquire())
+            continue;
+
+        const Slot& slot = buffer.read_buffer();
+        for (int i = 0; i < pixel_count; i++)
+        {
+            if (slot.pixels[i] != slot.seq)
+            {
+                torn++;
+                break;
+            }
+        }
+        if (slot.seq <= last_seq)
+            reordered++;
+
+        last_seq = slot.seq;
+        received++;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    producer.join();
+
+    const double ms = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+
+    fprintf(stderr, "triple_buffer  %d published  %d received  %.1f ms\n", total, received, ms);
+    if (torn || reordered)
+        g_failed = 1;
+
+    fprintf(stderr, "  torn %d  reordered %d  %s\n", torn, reordered, torn == 0 && reordered == 0 ? "ok" : "FAILED");
+}
+
+static ncnn::Layer* create_softmax(const ncnn::Option& opt)
+{
+    ncnn::Layer* op = ncnn::create_layer("Softmax");
+
+    ncnn::ParamDict pd;
+    pd.set(0, 1); // axis
+    pd.set(1, 1);
+    op->load_param(pd);
+
+    op->create_pipeline(opt);
+    return op;
+}
+
+static void destroy_layer(ncnn::Layer* op, const ncnn::Option& opt)
+{
+    op->destroy_pipeline(opt);
+    delete op;
+}
+
+static float fast_exp(float x)
+{
+    union {
+        uint32_t i;
+        float f;
+    } v{};
+    v.i = (1 << 23) * (1.4426950409 * x + 126.93490512f);
+    return v.f;
+}
+
+static float sigmoid(float x)
+{
+    return 1.0f / (1.0f + fast_exp(-x));
+}
+
+// the yolov8 decoder before the simd one, grids rebuilt per frame and a softmax layer per box
+static void generate_proposals_reference(const int* strides, int num_strides, int target_w, int target_h, const ncnn::Mat& pred, float prob_threshold, std::vector<Object>& objects)
+{
+    const int num_class = 80;
+    const int reg_max_1 = 16;
+
+    std::vector<int> grid0, grid1, grid_stride;
+    for (int s = 0; s < num_strides; s++)
+    {
+        for (int g1 = 0; g1 < target_h / strides[s]; g1++)
+        {
+            for (int g0 = 0; g0 < target_w / strides[s]; g0++)
+            {
+                grid0.push_back(g0);
+                grid1.push_back(g1);
+                grid_stride.push_back(strides[s]);
+            }
+        }
+    }
+
+    ncnn::Option opt;
+    opt.num_threads = 1;
+    opt.use_packing_layout = false;
+
+    ncnn::Layer* softmax = create_softmax(opt);
+
+    for (int i = 0; i < (int)grid0.size(); i++)
+    {
+        const float* scores = pred.row(i) + 4 * reg_max_1;
+
+        int label = -1;
+        float score = -FLT_MAX;
+        for (int k = 0; k < num_class; k++)
+        {
+            if (scores[k] > score)
+            {
+                label = k;
+                score = scores[k];
+            }
+        }
+        float box_prob = sigmoid(score);
+        if (box_prob < prob_threshold)
+            continue;
+
+        // keep pred intact for the other decoder
+        ncnn::Mat bbox_pred = ncnn::Mat(reg_max_1, 4, (void*)pred.row(i)).clone();
+        softmax->forward_inplace(bbox_pred, opt);
+
+        float pred_ltrb[4];
+        for (int k = 0; k < 4; k++)
+        {
+            float dis = 0.f;
+            const float* dis_after_sm = bbox_pred.row(k);
+            for (int l = 0; l < reg_max_1; l++)
+            {
+                dis += l * dis_after_sm[l];
+            }
+            pred_ltrb[k] = dis * grid_stride[i];
+        }
+
+        float pb_cx = (grid0[i] + 0.5f) * grid_stride[i];
+        float pb_cy = (grid1[i] + 0.5f) * grid_stride[i];
+
+        float x0 = pb_cx - pred_ltrb[0];
+        float y0 = pb_cy - pred_ltrb[1];
+        float x1 = pb_cx + pred_ltrb[2];
+        float y1 = pb_cy + pred_ltrb[3];
+
+        Object obj;
+        obj.rect.x = x0;
+        obj.rect.y = y0;
+        obj.rect.width = x1 - x0;
+        obj.rect.height = y1 - y0;
+        obj.label = label;
+        obj.prob = box_prob;
+        objects.push_back(obj);
+    }
+
+    destroy_layer(softmax, opt);
+}
+
+// yolov8 head output of a 640x480 frame, mostly background with a few hundred anchors above threshold
+static void bench_dfl_decode()
+{
+    const int target_w = 480;
+    const int target_h = 640;
+    const int strides[3] = {8, 16, 32};
+
+    AnchorTable anchors;
+    update_anchor_table(anchors, target_w, target_h, strides, 3);
+
+    const int num_points = anchors.size();
+    ncnn::Mat pred(144, num_points);
+    srand(7);
+    for (int i = 0; i < num_points; i++)
+    {
+        float* ptr = pred.row(i);
+        for (int k = 0; k < 64; k++)
+        {
+            ptr[k] = (rand() % 2000) / 200.f - 5.f;
+        }
+        // about 3% of the anchors carry an object
+        const bool hit = rand() % 32 == 0;
+        for (int k = 0; k < 80; k++)
+        {
+            ptr[64 + k] = (rand() % 1000) / 100.f - (hit ? 8.f : 16.f);
+        }
+    }
+
+    const float prob_threshold = 0.3f;
+
+    std::vector<Object> reference;
+    double reference_ms = bench_ms([&]() {
+        reference.clear();
+        generate_proposals_reference(strides, 3, target_w, target_h, pred, prob_threshold, reference);
+    });
+
+    std::vector<Object> decoded;
+    double simd_ms = bench_ms([&]() {
+        decoded.clear();
+        generate_dfl_proposals(anchors, pred, 80, 16, prob_threshold, decoded);
+    });
+
+    std::vector<Object> decoded_rebuild;
+    double rebuild_ms = bench_ms([&]() {
+        AnchorTable table;
+        update_anchor_table(table, target_w, target_h, strides, 3);
+        decoded_rebuild.clear();
+        generate_dfl_proposals(table, pred, 80, 16, prob_threshold, decoded_rebuild);
+    });
+
+    int label_mismatch = 0;
+    float box_diff = 0.f;
+    float prob_diff = 0.f;
+    if (reference.size() == decoded.size())
+    {
+        for (size_t i = 0; i < decoded.size(); i++)
+        {
+            const cv::Rect_<float>& a = reference[i].rect;
+            const cv::Rect_<float>& b = decoded[i].rect;
+            label_mismatch += reference[i].label != decoded[i].label;
+            box_diff = std::max(box_diff, std::max(std::max(fabsf(a.x - b.x), fabsf(a.y - b.y)), std::max(fabsf(a.width - b.width), fabsf(a.height - b.height))));
+            prob_diff = std::max(prob_diff, fabsf(reference[i].prob - decoded[i].prob));
+        }
+    }
+
+    // the same candidates, boxes only differ by the rounding of the polynomial exp
+    const bool ok = reference.size() == decoded.size() && label_mismatch == 0 && box_diff < 0.01f && prob_diff < 1e-5f;
+    if (!ok)
+        g_failed = 1;
+
+    fprintf(stderr, "dfl_decode  %d anchors  %d / %d proposals\n", num_points, (int)reference.size(), (int)decoded.size());
+    fprintf(stderr, "  reference %8.3f ms  simd %8.3f ms  simd + anchor rebuild %8.3f ms\n", reference_ms, simd_ms, rebuild_ms);
+    fprintf(stderr, "  label mismatch %d  max box diff %.4f px  max prob diff %.6f  %s\n", label_mismatch, box_diff, prob_diff, ok ? "ok" : "FAILED");
+}
+
+// the class agnostic nms before the simd one
+static void nms_reference(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold)
+{
+    picked.clear();
+
+    const int n = objects.size();
+
+    std::vector<float> areas(n);
+    for (int i = 0; i < n; i++)
+    {
+        areas[i] = objects[i].rect.width * objects[i].rect.height;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        const Object& a = objects[i];
+
+        int keep = 1;
+        for (int j = 0; j < (int)picked.size(); j++)
+        {
+            const Object& b = objects[picked[j]];
+
+            float inter_area = (a.rect & b.rect).area();
+            float union_area = areas[i] + areas[picked[j]] - inter_area;
+            if (inter_area / union_area > nms_threshold)
+                keep = 0;
+        }
+
+        if (keep)
+            picked.push_back(i);
+    }
+}
+
+// the per class nms before the buckets, the reference run on each label alone and merged back in score order
+static void nms_reference_per_class(const std::vector<Object>& objects, std::vector<int>& picked, float nms_threshold, int max_det)
+{
+    picked.clear();
+
+    int num_labels = 0;
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        num_labels = std::max(num_labels, objects[i].label + 1);
+    }
+
+    for (int label = 0; label < num_labels; label++)
+    {
+        std::vector<int> indices;
+        std::vector<Object> subset;
+        for (size_t i = 0; i < objects.size(); i++)
+        {
+            if (objects[i].label != label)
+                continue;
+
+            indices.push_back(i);
+            subset.push_back(objects[i]);
+        }
+
+        std::vector<int> subset_picked;
+        nms_reference(subset, subset_picked, nms_threshold);
+
+        for (size_t i = 0; i < subset_picked.size(); i++)
+        {
+            picked.push_back(indices[subset_picked[i]]);
+        }
+    }
+
+    // objects are sorted by score, so index order is score order
+    std::sort(picked.begin(), picked.end());
+
+    if (max_det > 0 && (int)picked.size() > max_det)
+        picked.resize(max_det);
+}
+
+// proposals clustered around a few dozen objects, like a busy street, sorted by score
+static void make_proposals(std::vector<Object>& objects, int count)
+{
+    srand(11);
+
+    const int num_centers = 40;
+    std::vector<Object> centers(num_centers);
+    for (int i = 0; i < num_centers; i++)
+    {
+        centers[i].rect = cv::Rect_<float>(rand() % 560, rand() % 560, 20 + rand() % 100, 20 + rand() % 100);
+        centers[i].label = rand() % 8;
+    }
+
+    objects.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        const Object& c = centers[rand() % num_centers];
+        Object& obj = objects[i];
+        obj.rect.x = c.rect.x + (rand() % 200) / 10.f - 10.f;
+        obj.rect.y = c.rect.y + (rand() % 200) / 10.f - 10.f;
+        obj.rect.width = c.rect.width * (0.8f + (rand() % 40) / 100.f);
+        obj.rect.height = c.rect.height * (0.8f + (rand() % 40) / 100.f);
+        // a few boxes take a neighbouring class of the same object
+        obj.label = rand() % 10 == 0 ? (c.label + 1) % 8 : c.label;
+        obj.prob = (rand() % 10000) / 10000.f;
+    }
+
+    std::sort(objects.begin(), objects.end(), [](const Object& a, const Object& b) { return a.prob > b.prob; });
+}
+
+static void bench_nms()
+{
+    const int counts[3] = {100, 1000, 10000};
+    const float nms_threshold = 0.45f;
+
+    for (int c = 0; c < 3; c++)
+    {
+        std::vector<Object> objects;
+        make_proposals(objects, counts[c]);
+
+        std::vector<int> picked_reference;
+        double reference_ms = bench_ms([&]() {
+            nms_reference(objects, picked_reference, nms_threshold);
+        });
+
+        std::vector<int> picked_agnostic;
+        double agnostic_ms = bench_ms([&]() {
+            nms_sorted_bboxes(objects, picked_agnostic, nms_threshold, true);
+        });
+
+        std::vector<int> picked_class;
+        double class_ms = bench_ms([&]() {
+            nms_sorted_bboxes(objects, picked_class, nms_threshold);
+        });
+
+        std::vector<int> picked_capped;
+        double capped_ms = bench_ms([&]() {
+            nms_sorted_bboxes(objects, picked_capped, nms_threshold, false, 20);
+        });
+
+        std::vector<int> picked_class_reference;
+        double class_reference_ms = bench_ms([&]() {
+            nms_reference_per_class(objects, picked_class_reference, nms_threshold, 0);
+        });
+
+        std::vector<int> picked_capped_reference;
+        nms_reference_per_class(objects, picked_capped_reference, nms_threshold, 20);
+
+        const bool same_agnostic = picked_reference == picked_agnostic;
+        const bool same_class = picked_class_reference == picked_class;
+        const bool same_capped = picked_capped_reference == picked_capped;
+        if (!same_agnostic || !same_class || !same_capped)
+            g_failed = 1;
+
+        fprintf(stderr, "nms  %5d proposals\n", counts[c]);
+        fprintf(stderr, "  reference %8.3f ms  simd agnostic %8.3f ms  same picks = %s\n", reference_ms, agnostic_ms, same_agnostic ? "yes" : "no");
+        fprintf(stderr, "  reference %8.3f ms  simd per class %8.3f ms  %d kept  same picks = %s\n", class_reference_ms, class_ms, (int)picked_class.size(), same_class ? "yes" : "no");
+        fprintf(stderr, "  capped at 20 %8.3f ms  same picks = %s\n", capped_ms, same_capped ? "yes" : "no");
+    }
+}
+
+// the proposal sort before top-k ranking, an omp team per recursion level
+static void qsort_descent_reference(std::vector<Object>& objects, int left, int right)
+{
+    int i = left;
+    int j = right;
+    float p = objects[(left + right) / 2].prob;
+
+    while (i <= j)
+    {
+        while (objects[i].prob > p)
+            i++;
+
+        while (objects[j].prob < p)
+            j--;
+
+        if (i <= j)
+        {
+            std::swap(objects[i], objects[j]);
+
+            i++;
+            j--;
+        }
+    }
+
+    #pragma omp parallel sections
+    {
+        #pragma omp section
+        {
+            if (left < j) qsort_descent_reference(objects, left, j);
+        }
+        #pragma omp section
+        {
+            if (i < right) qsort_descent_reference(objects, i, right);
+        }
+    }
+}
+
+// dense frames, most of the 8400 anchors of a 640x640 input above threshold
+static void bench_rank()
+{
+    const int counts[3] = {1000, 4000, 8400};
+    const int topk = 1000;
+
+    for (int c = 0; c < 3; c++)
+    {
+        std::vector<Object> proposals;
+        make_proposals(proposals, counts[c]);
+        std::shuffle(proposals.begin(), proposals.end(), std::mt19937(5));
+
+        std::vector<Object> sorted;
+        double qsort_ms = bench_ms([&]() {
+            sorted = proposals;
+            qsort_descent_reference(sorted, 0, (int)sorted.size() - 1);
+        });
+
+        std::vector<Object> ranked;
+        double rank_ms = bench_ms([&]() {
+            ranked = proposals;
+            rank_proposals(ranked, topk);
+        });
+
+        // same scores in the same order, ties may be swapped
+        bool same = (int)ranked.size() == std::min(counts[c], topk);
+        for (size_t i = 0; same && i < ranked.size(); i++)
+        {
+            same = ranked[i].prob == sorted[i].prob;
+        }
+        if (!same)
+            g_failed = 1;
+
+        fprintf(stderr, "rank  %d proposals  top %d\n", counts[c], topk);
+        fprintf(stderr, "  omp qsort %8.3f ms  top-k %8.3f ms  same head = %s\n", qsort_ms, rank_ms, same ? "yes" : "no");
+    }
+}
+
+// the label overlay before blending, nearest lookup and a hard overwrite per pixel
+static void overlay_reference(cv::Mat& rgb, const cv::Mat& labels, float x0, float kx, float y0, float ky)
+{
+    static const cv::Vec3b label_colors[3] = {cv::Vec3b(0, 0, 0), cv::Vec3b(0, 255, 0), cv::Vec3b(255, 0, 0)};
+
+    std::vector<int> xofs(rgb.cols);
+    for (int x = 0; x < rgb.cols; x++)
+    {
+        int mx = (int)floorf((x + 0.5f) * kx + x0);
+        xofs[x] = mx >= 0 && mx < labels.cols ? mx : -1;
+    }
+
+    for (int y = 0; y < rgb.rows; y++)
+    {
+        int my = (int)floorf((y + 0.5f) * ky + y0);
+        if (my < 0 || my >= labels.rows)
+            continue;
+
+        const unsigned char* label_ptr = labels.ptr<unsigned char>(my);
+        cv::Vec3b* image_ptr = rgb.ptr<cv::Vec3b>(y);
+        for (int x = 0; x < rgb.cols; x++)
+        {
+            if (xofs[x] < 0)
+                continue;
+
+            const unsigned char label = label_ptr[xofs[x]];
+            if (label != SEG_NONE)
+                image_ptr[x] = label_colors[label];
+        }
+    }
+}
+
+// road scene at network resolution, empty above the horizon, a drivable trapezoid and two lane lines below
+static void make_road_labels(cv::Mat& labels, float horizon)
+{
+    labels.create(320, 240, CV_8UC1);
+    labels.setTo(SEG_NONE);
+
+    const int top = (int)(labels.rows * horizon);
+    for (int y = top; y < labels.rows; y++)
+    {
+        const float t = (y - top + 1.f) / (labels.rows - top);
+        const int half = (int)(labels.cols * 0.5f * t);
+        unsigned char* ptr = labels.ptr<unsigned char>(y);
+        for (int x = labels.cols / 2 - half; x < labels.cols / 2 + half; x++)
+        {
+            ptr[x] = SEG_DRIVABLE_AREA;
+        }
+        for (int k = -1; k <= 1; k += 2)
+        {
+            const int lx = labels.cols / 2 + k * half * 2 / 3;
+            for (int x = std::max(lx - 1, 0); x <= std::min(lx + 1, labels.cols - 1); x++)
+            {
+                ptr[x] = SEG_LANE_LINE;
+            }
+        }
+    }
+}
+
+static void bench_seg_blend()
+{
+    const int sizes[2][2] = {{720, 1280}, {1080, 1920}};
+    const float horizons[2] = {0.45f, 0.f};
+
+    SegOverlayStyle opaque;
+    opaque.alpha[SEG_DRIVABLE_AREA] = 255;
+    opaque.alpha[SEG_LANE_LINE] = 255;
+    SegOverlayStyle style;
+
+    for (int h = 0; h < 2; h++)
+    {
+        cv::Mat labels;
+        make_road_labels(labels, horizons[h]);
+
+        for (int s = 0; s < 2; s++)
+        {
+            const int w = sizes[s][0];
+            const int ht = sizes[s][1];
+            const float kx = (float)labels.cols / w;
+            const float ky = (float)labels.rows / ht;
+            const double mpix = w * ht / 1000000.0;
+
+            cv::Mat frame(ht, w, CV_8UC3, cv::Scalar(90, 90, 90));
+            cv::Mat frame_rgba(ht, w, CV_8UC4, cv::Scalar(90, 90, 90, 255));
+
+            cv::Mat reference = frame.clone();
+            double reference_ms = bench_ms([&]() {
+                overlay_reference(reference, labels, 0.f, kx, 0.f, ky);
+            });
+
+            cv::Mat blended = frame.clone();
+            blend_seg_labels(blended.data, w, ht, (int)blended.step[0], 3, labels, 0.f, kx, 0.f, ky, opaque);
+            const bool same = cv::norm(reference, blended, cv::NORM_INF) == 0;
+
+            cv::Mat rgb = frame.clone();
+            double rgb_ms = bench_ms([&]() {
+                blend_seg_labels(rgb.data, w, ht, (int)rgb.step[0], 3, labels, 0.f, kx, 0.f, ky, style);
+            });
+
+            cv::Mat rgba = frame_rgba.clone();
+            double rgba_ms = bench_ms([&]() {
+                blend_seg_labels(rgba.data, w, ht, (int)rgba.step[0], 4, labels, 0.f, kx, 0.f, ky, style);
+            });
+
+            fprintf(stderr, "seg_blend  %dx%d  horizon %.2f\n", w, ht, horizons[h]);
+            fprintf(stderr, "  overwrite %8.3f ms %7.1f Mpix/s  blend rgb %8.3f ms %7.1f Mpix/s  rgba %8.3f ms %7.1f Mpix/s  opaque matches = %s\n",
+                    reference_ms, mpix / reference_ms * 1000, rgb_ms, mpix / rgb_ms * 1000, rgba_ms, mpix / rgba_ms * 1000, same ? "yes" : "no");
+        }
+    }
+}
+
+// stand-in for the ANativeWindow surface, an rgba buffer that remembers when it was posted
+struct HostSurface
+{
+    int width;
+    int height;
+    std::vector<unsigned char> pixels;
+    std::vector<int64_t> posted;
+
+    HostSurface(int w, int h)
+        : width(w), height(h), pixels(w * h * 4)
+    {
+    }
+
+    unsigned char* lock()
+    {
+        return pixels.data();
+    }
+
+    void unlock_and_post()
+    {
+        posted.push_back(frame_timestamp_now());
+    }
+};
+
+struct BenchFrame
+{
+    std::vector<unsigned char> nv21;
+    int seq;
+};
+
+// conversion plus a busy wait standing in for zoom, composite and text
+static void render_frame(const unsigned char* nv21, HostSurface& surface, int64_t render_cost)
+{
+    const int64_t start = frame_timestamp_now();
+
+    const int w = surface.width;
+    const int h = surface.height;
+    nv21_to_rgba(nv21, w, nv21 + w * h, w, w, h, surface.lock(), w * 4);
+
+    while (frame_timestamp_now() - start < render_cost)
+    {
+    }
+
+    surface.unlock_and_post();
+}
+
+class BenchRenderLoop : public RenderLoop
+{
+public:
+    BenchRenderLoop(TripleBuffer<BenchFrame>& _frames, HostSurface& _surface, int64_t _render_cost)
+        : RenderLoop(new PeriodicVsync(16666667)), frames(_frames), surface(_surface), render_cost(_render_cost)
+    {
+    }
+
+    virtual ~BenchRenderLoop()
+    {
+        stop();
+    }
+
+protected:
+    virtual bool render(int64_t vsync)
+    {
+        if (!frames.acquire())
+            return false;
+
+        render_frame(frames.read_buffer().nv21.data(), surface, render_cost);
+        return true;
+    }
+
+private:
+    TripleBuffer<BenchFrame>& frames;
+    HostSurface& surface;
+    int64_t render_cost;
+};
+
+static void print_post_intervals(const char* mode, const HostSurface& surface, int delivered, int dropped, double callback_ms)
+{
+    double sum = 0;
+    double sqsum = 0;
+    double max_interval = 0;
+    const int n = (int)surface.posted.size() - 1;
+    for (int i = 0; i < n; i++)
+    {
+        const double interval = (surface.posted[i + 1] - surface.posted[i]) / 1000000.0;
+        sum += interval;
+        sqsum += interval * interval;
+        max_interval = std::max(max_interval, interval);
+    }
+
+    const double mean = n > 0 ? sum / n : 0;
+    const double stddev = n > 0 ? sqrt(std::max(sqsum / n - mean * mean, 0.0)) : 0;
+
+    fprintf(stderr, "  %-13s presented %4d/%d  dropped %3d  interval %6.2f +- %5.2f ms  max %6.2f ms  callback %6.3f ms\n",
+            mode, (int)surface.posted.size(), delivered, dropped, mean, stddev, max_interval, callback_ms);
+}
+
+// camera at 30 fps, display at 60 Hz, rendering either inside the camera callback or on the render thread
+static void bench_render_pacing()
+{
+    const int w = 1280;
+    const int h = 720;
+    const int frames = std::max(g_loops, 30);
+    const int64_t camera_period = 33333333;
+    const int render_costs_ms[3] = {4, 20, 40};
+
+    std::vector<unsigned char> nv21;
+    fill_nv21(nv21, w, h);
+
+    for (int c = 0; c < 3; c++)
+    {
+        const int64_t render_cost = render_costs_ms[c] * 1000000LL;
+
+        fprintf(stderr, "render_pacing  %dx%d  camera 30 fps  vsync 60 Hz  render %d ms  %d frames\n", w, h, render_costs_ms[c], frames);
+
+        // old path, the callback renders and posts before the reader can deliver the next image
+        {
+            HostSurface surface(w, h);
+            int delivered = 0;
+            int dropped = 0;
+            double callback_sum = 0;
+
+            const int64_t start = frame_timestamp_now();
+            for (int i = 0; i < frames; i++)
+            {
+                const int64_t arrival = start + i * camera_period;
+                const int64_t now = frame_timestamp_now();
+                if (now > arrival + camera_period)
+                {
+                    // the image reader replaced this frame while the callback was busy
+                    dropped++;
+                    continue;
+                }
+                if (now < arrival)
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(arrival - now));
+
+                const int64_t t0 = frame_timestamp_now();
+                render_frame(nv21.data(), surface, render_cost);
+                callback_sum += (frame_timestamp_now() - t0) / 1000000.0;
+                delivered++;
+            }
+
+            print_post_intervals("camera thread", surface, delivered, dropped, delivered > 0 ? callback_sum / delivered : 0);
+        }
+
+        // callback only copies into the triple buffer, the render thread presents on vsync
+        {
+            HostSurface surface(w, h);
+            TripleBuffer<BenchFrame> buffer;
+            int delivered = 0;
+            int dropped = 0;
+            double callback_sum = 0;
+
+            BenchRenderLoop loop(buffer, surface, render_cost);
+            loop.start();
+
+            const int64_t start = frame_timestamp_now();
+            for (int i = 0; i < frames; i++)
+            {
+                const int64_t arrival = start + i * camera_period;
+                const int64_t now = frame_timestamp_now();
+                if (now < arrival)
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(arrival - now));
+
+                const int64_t t0 = frame_timestamp_now();
+                BenchFrame& frame = buffer.write_buffer();
+                frame.nv21.assign(nv21.begin(), nv21.end());
+                frame.seq = i;
+                if (buffer.publish())
+                    dropped++;
+                callback_sum += (frame_timestamp_now() - t0) / 1000000.0;
+                delivered++;
+            }
+            std::this_thread::sleep_for(std::chrono::nanoseconds(camera_period));
+            loop.stop();
+
+            print_post_intervals("render thread", surface, delivered, dropped, callback_sum / delivered);
+
+            const PacingStats pacing = loop.pacing_stats();
+            fprintf(stderr, "  %-13s vsyncs %d  late %d  vsync->post %.2f ms  period %.2f ms\n",
+                    "", (int)pacing.vsyncs, (int)pacing.late, pacing.render_mean, pacing.vsync_period);
+        }
+    }
+}
+
+struct DualFrame
+{
+    std::vector<unsigned char> pixels;
+    int64_t timestamp;
+    int seq;
+};
+
+// fills the frame with its seq so a torn or mismatched slot shows up
+static void write_dual_frame(DualFrame& frame, int size, int64_t timestamp, int seq)
+{
+    frame.pixels.assign(size, (unsigned char)seq);
+    frame.timestamp = timestamp;
+    frame.seq = seq;
+}
+
+static bool dual_frame_intact(const DualFrame& frame)
+{
+    return frame.pixels.front() == (unsigned char)frame.seq && frame.pixels.back() == (unsigned char)frame.seq;
+}
+
+class DualStreamRenderLoop : public RenderLoop
+{
+public:
+    DualStreamRenderLoop(TripleBuffer<DualFrame>& _display, TimestampRing<DualFrame>& _inference)
+        : RenderLoop(new PeriodicVsync(16666667)), display(_display), inference(_inference),
+          presented(0), paired(0), fallback(0), missing(0), mismatched(0), torn(0), reordered(0), last_fed(0)
+    {
+    }
+
+    virtual ~DualStreamRenderLoop()
+    {
+        stop();
+    }
+
+protected:
+    // same pairing as NdkCameraWindow::render_newest
+    virtual bool render(int64_t vsync)
+    {
+        if (!display.acquire())
+            return false;
+
+        const DualFrame& frame = display.read_buffer();
+        if (!dual_frame_intact(frame))
+            torn++;
+        presented++;
+
+        if (inference.acquire(frame.timestamp, 1000000))
+        {
+            paired++;
+            if (inference.read_buffer().seq != frame.seq)
+                mismatched++;
+        }
+        else if (inference.acquire_newest())
+        {
+            fallback++;
+        }
+        else
+        {
+            missing++;
+            return true;
+        }
+
+        const DualFrame& fed = inference.read_buffer();
+        if (!dual_frame_intact(fed) || fed.timestamp != inference.read_timestamp())
+            torn++;
+        if (fed.timestamp <= last_fed)
+            reordered++;
+        last_fed = fed.timestamp;
+        return true;
+    }
+
+private:
+    TripleBuffer<DualFrame>& display;
+    TimestampRing<DualFrame>& inference;
+
+public:
+    int presented;
+    int paired;
+    int fallback;
+    int missing;
+    int mismatched;
+    int torn;
+    int reordered;
+    int64_t last_fed;
+};
+
+// stream size policy on a typical camera, then a synthetic 30 fps capture delivered on two callback threads
+// with independent delivery jitter and inference frames lost, paired on a 60 Hz render thread
+static void bench_dual_stream()
+{
+    const StreamSize camera_sizes[] = {{4000, 3000}, {1920, 1440}, {1920, 1080}, {1440, 1080}, {1280, 960}, {1280, 720}, {960, 720}, {800, 600}, {720, 480}, {640, 480}, {640, 360}, {352, 288}, {320, 240}, {176, 144}};
+    const std::vector<StreamSize> available(camera_sizes, camera_sizes + sizeof(camera_sizes) / sizeof(camera_sizes[0]));
+    const int windows[4][2] = {{1080, 2400}, {720, 1280}, {1440, 3200}, {480, 640}};
+
+    fprintf(stderr, "dual_stream  sizes for yolopv2 320 + yolov8 640\n");
+    for (int i = 0; i < 4; i++)
+    {
+        const StreamSizes sizes = choose_stream_sizes(available, windows[i][0], windows[i][1], 320, 640);
+        fprintf(stderr, "  window %4dx%-4d  display %4dx%-4d  inference %4dx%-4d  %s\n", windows[i][0], windows[i][1],
+                sizes.display.width, sizes.display.height, sizes.inference.width, sizes.inference.height, sizes.dual() ? "dual" : "single");
+    }
+
+    const int frames = std::max(g_loops, 30);
+    const int64_t camera_period = 33333333;
+    const int display_size = 1920 * 1080 * 3 / 2;
+    const int inference_size = 640 * 360 * 3 / 2;
+    const int loss_percents[3] = {0, 5, 20};
+
+    for (int l = 0; l < 3; l++)
+    {
+        TripleBuffer<DualFrame> display;
+        TimestampRing<DualFrame> inference;
+
+        DualStreamRenderLoop loop(display, inference);
+        loop.start();
+
+        const int64_t start = frame_timestamp_now() + camera_period;
+
+        // both callbacks see the same sensor timestamp, each arrives 0~12 ms after capture
+        std::thread display_thread([&]() {
+            std::mt19937 rng(1);
+            std::uniform_int_distribution<int> jitter(0, 12000000);
+            for (int i = 0; i < frames; i++)
+            {
+                const int64_t timestamp = start + i * camera_period;
+                std::this_thread::sleep_for(std::chrono::nanoseconds(std::max(timestamp + jitter(rng) - frame_timestamp_now(), (int64_t)0)));
+
+                write_dual_frame(display.write_buffer(), display_size, timestamp, i);
+                display.publish();
+            }
+        });
+
+        std::thread inference_thread([&]() {
+            std::mt19937 rng(2);
+            std::uniform_int_distribution<int> jitter(0, 12000000);
+            std::uniform_int_distribution<int> percent(0, 99);
+            for (int i = 0; i < frames; i++)
+            {
+                const int64_t timestamp = start + i * camera_period;
+                const int64_t delay = jitter(rng);
+                if (percent(rng) < loss_percents[l])
+                    continue;
+
+                std::this_thread::sleep_for(std::chrono::nanoseconds(std::max(timestamp + delay - frame_timestamp_now(), (int64_t)0)));
+
+                write_dual_frame(inference.write_buffer(), inference_size, timestamp, i);
+                inference.publish(timestamp);
+            }
+        });
+
+        display_thread.join();
+        inference_thread.join();
+        std::this_thread::sleep_for(std::chrono::nanoseconds(camera_period));
+        loop.stop();
+
+        const bool ok = loop.mismatched == 0 && loop.torn == 0 && loop.reordered == 0;
+        if (!ok)
+            g_failed = 1;
+        fprintf(stderr, "dual_stream  %d frames  inference loss %d%%\n", frames, loss_percents[l]);
+        fprintf(stderr, "  presented %d  paired %d  newest %d  none %d  mismatched %d  torn %d  reordered %d  %s\n",
+                loop.presented, loop.paired, loop.fallback, loop.missing, loop.mismatched, loop.torn, loop.reordered, ok ? "ok" : "FAILED");
+    }
+}
+
+// the zoom the app used before, upscale the whole view and copy the center back out
+static void zoom_view_reference(cv::Mat& rgb, float zoom)
+{
+    if (zoom == 1.f)
+        return;
+
+    cv::Mat zoomed;
+    cv::resize(rgb, zoomed, cv::Size(), zoom, zoom, cv::INTER_LINEAR);
+    zoomed(cv::Rect((zoomed.cols - rgb.cols) / 2, (zoomed.rows - rgb.rows) / 2, rgb.cols, rgb.rows)).copyTo(rgb);
+}
+
+// upright rgba of a roi, rotated through a scratch nv21 like NdkCameraWindow
+static void roi_to_rgba(const Nv21Roi& roi, std::vector<unsigned char>& scratch, cv::Mat& rgba)
+{
+    const int w = roi.upright_w();
+    const int h = roi.upright_h();
+    scratch.resize(w * h * 3 / 2);
+
+    const unsigned char* y = roi.nv21 + roi.roi_y * roi.width + roi.roi_x;
+    const unsigned char* vu = roi.nv21 + roi.width * roi.height + roi.roi_y / 2 * roi.width + roi.roi_x;
+    ncnn::kanna_rotate_c1(y, roi.roi_w, roi.roi_h, roi.width, scratch.data(), w, h, w, roi.rotate_type);
+    ncnn::kanna_rotate_c2(vu, roi.roi_w / 2, roi.roi_h / 2, roi.width, scratch.data() + w * h, w / 2, h / 2, w, roi.rotate_type);
+    nv21_to_rgba(scratch.data(), w, scratch.data() + w * h, w, w, h, rgba.data, (int)rgba.step[0]);
+}
+
+// the MainActivity zoom range on a 1920x1080 portrait preview, display and both network inputs
+static void bench_zoom()
+{
+    const int width = 1920;
+    const int height = 1080;
+    const int rotate_type = 6;
+    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
+    const float zooms[5] = {1.f, 1.5f, 2.f, 2.5f, 3.f};
+
+    std::vector<unsigned char> nv21;
+    fill_nv21(nv21, width, height);
+
+    const Nv21Roi roi = {nv21.data(), width, height, 0, 0, width, height, rotate_type};
+    const int view_w = roi.upright_w();
+    const int view_h = roi.upright_h();
+
+    std::vector<unsigned char> scratch;
+    cv::Mat full(view_h, view_w, CV_8UC4);
+    cv::Mat display(view_h, view_w, CV_8UC4);
+    cv::Mat crop;
+
+    fprintf(stderr, "zoom  %dx%d rotate %d  display %dx%d  inputs 320 + 640\n", width, height, rotate_type, view_w, view_h);
+    for (int z = 0; z < 5; z++)
+    {
+        const float zoom = zooms[z];
+        const Nv21Roi zoom_roi = nv21_roi_zoom(roi, zoom);
+
+        double display_old_ms = bench_ms([&]() {
+            roi_to_rgba(roi, scratch, full);
+            zoom_view_reference(full, zoom);
+        });
+
+        double display_new_ms = bench_ms([&]() {
+            if (zoom_roi.roi_w == roi.roi_w && zoom_roi.roi_h == roi.roi_h)
+            {
+                roi_to_rgba(roi, scratch, display);
+                return;
+            }
+            crop.create(zoom_roi.upright_h(), zoom_roi.upright_w(), CV_8UC4);
+            roi_to_rgba(zoom_roi, scratch, crop);
+            cv::resize(crop, display, display.size(), 0, 0, cv::INTER_LINEAR);
+        });
+
+        // old network input, the zoomed full view letterboxed
+        cv::Mat rgb;
+        ncnn::Mat old_320, old_640;
+        double input_old_ms = bench_ms([&]() {
+            roi_to_rgba(roi, scratch, full);
+            zoom_view_reference(full, zoom);
+            cv::cvtColor(full, rgb, cv::COLOR_RGBA2RGB);
+            letterbox_chain(rgb.data, view_w, view_h, 320, ncnn::Mat::PIXEL_RGB2BGR, 114.f, norm_vals, old_320);
+            letterbox_chain(rgb.data, view_w, view_h, 640, ncnn::Mat::PIXEL_RGB2BGR, 0.f, norm_vals, old_640);
+        });
+
+        Nv21Resampler resampler_320, resampler_640;
+        ncnn::Mat new_320, new_640;
+        double input_new_ms = bench_ms([&]() {
+            letterbox_fused(resampler_320, zoom_roi, 320, 114.f, norm_vals, new_320);
+            letterbox_fused(resampler_640, zoom_roi, 640, 0.f, norm_vals, new_640);
+        });
+
+        // both views are the same picture, up to resampling
+        roi_to_rgba(roi, scratch, full);
+        zoom_view_reference(full, zoom);
+        const double display_diff = cv::norm(full, display, cv::NORM_L1) / (view_w * view_h * 3);
+
+        const double old_mpix = view_w * zoom * view_h * zoom / 1000000.0;
+        fprintf(stderr, "  zoom %.1f  display old %7.3f ms (%5.1f Mpix scratch)  new %7.3f ms  mean diff %.2f   inputs old %7.3f ms  new %7.3f ms\n",
+                zoom, display_old_ms, old_mpix, display_new_ms, display_diff, input_old_ms, input_new_ms);
+    }
+}
+
+// both network inputs of a frame, two full nv21 resamples vs one resample and a derived level
+static void bench_input_pyramid()
+{
+    const int width = 1920;
+    const int height = 1080;
+    const float norm_vals[3] = {1 / 255.f, 1 / 255.f, 1 / 255.f};
+    const int rotate_types[2] = {1, 6};
+
+    std::vector<unsigned char> nv21;
+    fill_nv21(nv21, width, height);
+
+    // reused across frames like the preprocess stage does
+    ncnn::PoolAllocator allocator;
+    allocator.set_size_compare_ratio(0.f);
+
+    for (int r = 0; r < 2; r++)
+    {
+        const Nv21Roi roi = {nv21.data(), width, height, 0, 0, width, height, rotate_types[r]};
+        const int img_w = roi.upright_w();
+        const int img_h = roi.upright_h();
+        const Letterbox lb_320 = make_letterbox(img_w, img_h, 320, 32);
+        const Letterbox lb_640 = make_letterbox(img_w, img_h, 640, 32);
+
+        Nv21Resampler resampler_320, resampler_640;
+        ncnn::Mat old_320, old_640;
+        double old_ms = bench_ms([&]() {
+            nv21_roi_to_tensor(resampler_320, roi, ncnn::Mat::PIXEL_BGR, lb_320.w, lb_320.h, lb_320.top, lb_320.bottom, lb_320.left, lb_320.right, 114.f, 0, norm_vals, old_320);
+            nv21_roi_to_tensor(resampler_640, roi, ncnn::Mat::PIXEL_BGR, lb_640.w, lb_640.h, lb_640.top, lb_640.bottom, lb_640.left, lb_640.right, 0.f, 0, norm_vals, old_640);
+        });
+
+        InputPyramid pyramid;
+        ncnn::Mat new_320, new_640;
+        double new_ms = bench_ms([&]() {
+            pyramid.build(roi, lb_640.w, lb_640.h);
+            pyramid.make_input(lb_320, ncnn::Mat::PIXEL_BGR, 114.f, 0, norm_vals, new_320, &allocator);
+            pyramid.make_input(lb_640, ncnn::Mat::PIXEL_BGR, 0.f, 0, norm_vals, new_640, &allocator);
+            new_320.release();
+            new_640.release();
+        });
+
+        pyramid.build(roi, lb_640.w, lb_640.h);
+        pyramid.make_input(lb_320, ncnn::Mat::PIXEL_BGR, 114.f, 0, norm_vals, new_320);
+        pyramid.make_input(lb_640, ncnn::Mat::PIXEL_BGR, 0.f, 0, norm_vals, new_640);
+
+        // 640 is the same resample, 320 is a box average of it instead of a direct bilinear
+        fprintf(stderr, "input_pyramid  %dx%d rotate %d  320 %dx%d  640 %dx%d  two resamples %7.3f ms  pyramid %7.3f ms  max diff 320 %.4f  640 %.6f\n",
+                width, height, rotate_types[r], old_320.w, old_320.h, old_640.w, old_640.h, old_ms, new_ms,
+                max_abs_diff(old_320, new_320), max_abs_diff(old_640, new_640));
+    }
+}
+
+// the models of the optimize_models target against the originals in the same dir
+// per frame latency, and how far each output moved with the fusions and fp16 weights
+static void bench_optimized_models(const char* model_dir)
+{
+    const char* yolopv2_outputs[] = {"677", "769", "det0", "det1", "det2"};
+    const char* yolov8n_outputs[] = {"output"};
+
+    struct
+    {
+        const char* name;
+        int w;
+        int h;
+        const char* const* outputs;
+        int output_count;
+    } models[2] = {
+        {"yolopv2", 320, 192, yolopv2_outputs, 5},
+        {"yolov8n", 640, 384, yolov8n_outputs, 1},
+    };
+
+    for (int m = 0; m < 2; m++)
+    {
+        const std::string opt_name = std::string(models[m].name) + ".opt";
+
+        ncnn::Net original;
+        ncnn::Net optimized;
+        if (load_net(original, model_dir, models[m].name) != 0 || load_net(optimized, model_dir, opt_name.c_str()) != 0)
+            return;
+
+        // something image like, a constant input would hide a wrong bias
+        ncnn::Mat in(models[m].w, models[m].h, 3);
+        for (int q = 0; q < 3; q++)
+        {
+            float* ptr = in.channel(q);
+            for (int i = 0; i < in.w * in.h; i++)
+            {
+                ptr[i] = 0.5f + 0.4f * sinf(i * 0.013f + q);
+            }
+        }
+
+        const double original_ms = bench_ms([&]() {
+            ncnn::Extractor ex = original.create_extractor();
+            ex.input("images", in);
+            for (int i = 0; i < models[m].output_count; i++)
+            {
+                ncnn::Mat out;
+                ex.extract(models[m].outputs[i], out);
+            }
+        });
+        const double optimized_ms = bench_ms([&]() {
+            ncnn::Extractor ex = optimized.create_extractor();
+            ex.input("images", in);
+            for (int i = 0; i < models[m].output_count; i++)
+            {
+                ncnn::Mat out;
+                ex.extract(models[m].outputs[i], out);
+            }
+        });
+
+        fprintf(stderr, "optimized_models  %-8s %dx%d  original %8.3f ms  optimized %8.3f ms\n",
+                models[m].name, in.w, in.h, original_ms, optimized_ms);
+
+        ncnn::Extractor ex0 = original.create_extractor();
+        ncnn::Extractor ex1 = optimized.create_extractor();
+        ex0.input("images", in);
+        ex1.input("images", in);
+        for (int i = 0; i < models[m].output_count; i++)
+        {
+            ncnn::Mat out0, out1;
+            ex0.extract(models[m].outputs[i], out0);
+            ex1.extract(models[m].outputs[i], out1);
+
+            ncnn::Mat zero;
+            zero.create_like(out0);
+            zero.fill(0.f);
+
+            fprintf(stderr, "    %-6s max diff %.5f  max abs %.3f\n", models[m].outputs[i], max_abs_diff(out0, out1), max_abs_diff(out0, zero));
+        }
+    }
+}
+
+// a blob the app extracts by the index from the generated header
+struct NamedBlob
+{
+    const char* name;
+    int index;
+};
+
+// text param vs the binary param of the build, parse time per load
+// the binary graph is checked layer by layer against the text one, and the header indices against the blob names
+static void bench_param_format(const char* model_dir)
+{
+    const NamedBlob yolopv2_blobs[] = {
+        {"images", yolopv2_param_id::BLOB_images},
+        {"677", yolopv2_param_id::BLOB_677},
+        {"769", yolopv2_param_id::BLOB_769},
+        {"det0", yolopv2_param_id::BLOB_det0},
+        {"det1", yolopv2_param_id::BLOB_det1},
+        {"det2", yolopv2_param_id::BLOB_det2},
+    };
+    const NamedBlob yolov8n_blobs[] = {
+        {"images", yolov8n_param_id::BLOB_images},
+        {"output", yolov8n_param_id::BLOB_output},
+    };
+
+    struct
+    {
+        const char* name;
+        const NamedBlob* blobs;
+        int blob_count;
+    } models[2] = {
+        {"yolopv2", yolopv2_blobs, sizeof(yolopv2_blobs) / sizeof(NamedBlob)},
+        {"yolov8n", yolov8n_blobs, sizeof(yolov8n_blobs) / sizeof(NamedBlob)},
+    };
+
+    for (int m = 0; m < 2; m++)
+    {
+        const std::string textpath = std::string(model_dir) + "/" + models[m].name + ".param";
+        const std::string binpath = textpath + ".bin";
+
+        ncnn::Net text_net;
+        ncnn::Net bin_net;
+        if (text_net.load_param(textpath.c_str()) != 0 || bin_net.load_param_bin(binpath.c_str()) != 0)
+        {
+            fprintf(stderr, "load %s or %s failed\n", textpath.c_str(), binpath.c_str());
+            return;
+        }
+
+        // same layers wired to the same blobs
+        bool same_graph = text_net.layers().size() == bin_net.layers().size() && text_net.blobs().size() == bin_net.blobs().size();
+        for (size_t i = 0; same_graph && i < text_net.layers().size(); i++)
+        {
+            const ncnn::Layer* a = text_net.layers()[i];
+            const ncnn::Layer* b = bin_net.layers()[i];
+            same_graph = a->typeindex == b->typeindex && a->bottoms == b->bottoms && a->tops == b->tops;
+        }
+
+        int stale = 0;
+        for (int i = 0; i < models[m].blob_count; i++)
+        {
+            const NamedBlob& blob = models[m].blobs[i];
+            if (blob.index >= (int)text_net.blobs().size() || text_net.blobs()[blob.index].name != blob.name)
+                stale++;
+        }
+
+        const double text_ms = bench_ms([&]() {
+            ncnn::Net net;
+            net.load_param(textpath.c_str());
+        });
+        const double bin_ms = bench_ms([&]() {
+            ncnn::Net net;
+            net.load_param_bin(binpath.c_str());
+        });
+
+        fprintf(stderr, "param_format  %-8s %3d layers  text %7.3f ms  binary %7.3f ms  graph %s  stale indices %d\n",
+                models[m].name, (int)text_net.layers().size(), text_ms, bin_ms, same_graph ? "same" : "DIFFERENT", stale);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* name = argc > 1 ? argv[1] : 0;
+    if (argc > 2)
+    {
+        g_loops = atoi(argv[2]);
+    }
+
+    const char* model_dir = argc > 3 ? argv[3] : ".";
+
+    if (!name || strcmp(name, "yuv420_888") == 0)
+        bench_yuv420_888();
+
+    if (!name || strcmp(name, "nv21_tensor") == 0)
+        bench_nv21_tensor();
+
+    if (!name || strcmp(name, "triple_buffer") == 0)
+        bench_triple_buffer();
+
+    if (!name || strcmp(name, "dfl_decode") == 0)
+        bench_dfl_decode();
+
+    if (!name || strcmp(name, "nms") == 0)
+        bench_nms();
+
+    if (!name || strcmp(name, "rank") == 0)
+        bench_rank();
+
+    if (!name || strcmp(name, "seg_blend") == 0)
+        bench_seg_blend();
+
+    if (!name || strcmp(name, "render_pacing") == 0)
+        bench_render_pacing();
+
+    if (!name || strcmp(name, "dual_stream") == 0)
+        bench_dual_stream();
+
+    if (!name || strcmp(name, "zoom") == 0)
+        bench_zoom();
+
+    if (!name || strcmp(name, "input_pyramid") == 0)
+        bench_input_pyramid();
+
+    // needs the models, only on request
+    if (name && strcmp(name, "nets") == 0)
+        bench_nets(model_dir);
+
+    if (name && strcmp(name, "single_net") == 0)
+        bench_single_net(model_dir);
+
+    if (name && strcmp(name, "model_load") == 0)
+        bench_model_load(model_dir);
+
+    if (name && strcmp(name, "prune_heads") == 0)
+        bench_prune_heads(model_dir);
+
+    if (name && strcmp(name, "param_format") == 0)
+        bench_param_format(model_dir);
+
+    if (name && strcmp(name, "optimized_models") == 0)
+        bench_optimized_models(model_dir);
+
+    return g_failed;
+}
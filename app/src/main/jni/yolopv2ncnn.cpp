@@ -22,6 +22,7 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "yolopv2.h"
+#include "compositor.h"
 #include "ndkcamera.h"
 #include <chrono>
 #include <mutex>
@@ -31,36 +32,85 @@
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, TAG, __VA_ARGS__)
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, TAG, __VA_ARGS__)
 
-static std::unique_ptr<Yolopv2> g_yolopv2;
+// loadModel 在锁外等待加载完成, 期间可能被替换, 用 shared_ptr 保证等待的对象还活着
+static std::shared_ptr<Yolopv2> g_yolopv2;
 static std::mutex g_mutex;
 
 bool g_enable_drivable_area = true;
 bool g_enable_lane_detection = true;
 bool g_enable_object_detection = true;
+bool g_enable_single_network = false;
 float g_zoom = 1.0f;
 
 static TimingInfo g_timing_info;
+static int64_t g_rendered_frames = 0;
 static std::chrono::time_point<std::chrono::high_resolution_clock> g_last_frame_time;
 
 class MyNdkCamera : public NdkCameraWindow {
 public:
-    virtual void on_image_render(cv::Mat &rgb) const;
+    virtual void on_image_render(cv::Mat &rgba, float zoom, const Nv21Roi &roi, int64_t timestamp) const;
 };
 
-void MyNdkCamera::on_image_render(cv::Mat &rgb) const {
-    TimingInfo timing_info;
+void MyNdkCamera::on_image_render(cv::Mat &rgba, float zoom, const Nv21Roi &roi, int64_t timestamp) const {
+    TimingInfo timing_info = TimingInfo();
+    std::vector<StageStats> stage_stats;
+    int net_states[NET_COUNT] = {NET_LOADING, NET_LOADING};
     {
         std::lock_guard<std::mutex> lock(g_mutex);
         if (g_yolopv2) {
-            g_yolopv2->updateLatestFrame(rgb);
-            cv::Mat processed = g_yolopv2->getLatestProcessedFrame();
-            if (!processed.empty()) {
-                processed.copyTo(rgb);
+            if (roi.nv21) {
+                g_yolopv2->updateLatestFrame(roi, timestamp);
             }
-            timing_info = g_yolopv2->getLatestTimingInfo();
+
+            // 显示最新的相机画面(已按 zoom 放大), 叠加最新的推理结果
+            DetectionResult result;
+            if (g_yolopv2->getLatestResult(result, &timing_info)) {
+                composite_result(rgba, zoom, result, &timing_info);
+            }
+            stage_stats = g_yolopv2->getStageStats();
+            net_states[NET_YOLOPV2] = g_yolopv2->getNetState(NET_YOLOPV2);
+            net_states[NET_YOLOV8] = g_yolopv2->getNetState(NET_YOLOV8);
         }
     }
 
+    // 采集 -> 显示 的端到端延迟, 即叠加的结果有多旧
+    double capture_to_display = 0;
+    if (timing_info.capture_timestamp != 0) {
+        capture_to_display = (frame_timestamp_now() - timing_info.capture_timestamp) / 1000000.0;
+    }
+
+    // 每帧整帧像素拷贝次数
+    g_rendered_frames++;
+    const double copies_per_frame = (double) frame_copy_counter().count / g_rendered_frames;
+    const double reallocs_per_frame = (double) frame_copy_counter().reallocs / g_rendered_frames;
+
+    // 渲染线程的呈现节奏
+    const PacingStats pacing = pacing_stats();
+
+    static const char* state_names[] = {"loading", "ready", "failed", "skipped"};
+
+    char line_buf[10][64];
+    sprintf(line_buf[0], "Pre: %.1f ms", timing_info.preprocess);
+    sprintf(line_buf[1], "Model: %.1f ms", timing_info.model_inference);
+    sprintf(line_buf[2], "L/A: %.1f ms", timing_info.lane_and_area);
+    sprintf(line_buf[3], "Obj Det: %.1f ms", timing_info.object_detection);
+    sprintf(line_buf[4], "Cap->Inf: %.1f ms  Cap->Disp: %.1f ms", timing_info.capture_to_inference, capture_to_display);
+    sprintf(line_buf[5], "Drop: %d inf  %d disp", timing_info.dropped_before_inference, timing_info.dropped_before_display);
+    sprintf(line_buf[7], "Copy: %.2f /frame  Realloc: %.2f /frame", copies_per_frame, reallocs_per_frame);
+    sprintf(line_buf[8], "Disp: %.1f +- %.1f ms  late %d", pacing.interval_mean, pacing.interval_stddev, (int) pacing.late);
+    sprintf(line_buf[9], "Net: yolopv2 %s  yolov8 %s", state_names[net_states[NET_YOLOPV2]], state_names[net_states[NET_YOLOV8]]);
+
+    // 各级占用率, 接近 100% 的那一级就是瓶颈
+    line_buf[6][0] = '\0';
+    if (stage_stats.size() == STAGE_COUNT) {
+        sprintf(line_buf[6], "Busy%%: %d %d %d %d %d",
+                (int) (stage_stats[STAGE_PREPROCESS].occupancy * 100),
+                (int) (stage_stats[STAGE_YOLOPV2].occupancy * 100),
+                (int) (stage_stats[STAGE_YOLOV8].occupancy * 100),
+                (int) (stage_stats[STAGE_POSTPROCESS].occupancy * 100),
+                (int) (stage_stats[STAGE_COMPOSE].occupancy * 100));
+    }
+
 //    // 计算 FPS
 //    auto current_time = std::chrono::high_resolution_clock::now();
 //    double fps = 1000.0 / std::chrono::duration_cast<std::chrono::milliseconds>(current_time - g_last_frame_time).count();
@@ -69,9 +119,7 @@ void MyNdkCamera::on_image_render(cv::Mat &rgb) const {
     // 准备时间信息字符串
     std::vector<std::string> info_lines = {
 //            "FPS: " + std::to_string(static_cast<int>(std::round(fps))),
-            "Model: " + std::to_string(static_cast<int>(timing_info.model_inference)) + " ms",
-            "L/A: " + std::to_string(static_cast<int>(timing_info.lane_and_area)) + " ms",
-            "Obj Det: " + std::to_string(static_cast<int>(timing_info.object_detection)) + " ms",
+            line_buf[0], line_buf[1], line_buf[2], line_buf[3], line_buf[4], line_buf[5], line_buf[6], line_buf[7], line_buf[8], line_buf[9],
     };
 
     // 绘制时间信息
@@ -79,16 +127,17 @@ void MyNdkCamera::on_image_render(cv::Mat &rgb) const {
     int font_face = cv::FONT_HERSHEY_SIMPLEX;
     double font_scale = 0.4;
     int thickness = 1;
-    cv::Scalar text_color(255, 255, 255);  // 白色
-    cv::Scalar bg_color(0, 0, 0, 128);     // 半透明黑色背景
+    // 画在 rgba 窗口缓冲区上, alpha 要给 255
+    cv::Scalar text_color(255, 255, 255, 255);  // 白色
+    cv::Scalar bg_color(0, 0, 0, 255);          // 黑色背景
 
     int y = 10;
     for (const auto& line : info_lines) {
         cv::Size text_size = cv::getTextSize(line, font_face, font_scale, thickness, &base_line);
-        cv::rectangle(rgb, cv::Point(5, y - text_size.height),
+        cv::rectangle(rgba, cv::Point(5, y - text_size.height),
                       cv::Point(10 + text_size.width, y + base_line),
                       bg_color, cv::FILLED);
-        cv::putText(rgb, line, cv::Point(10, y), font_face, font_scale, text_color, thickness);
+        cv::putText(rgba, line, cv::Point(10, y), font_face, font_scale, text_color, thickness);
         y += text_size.height + 5;
     }
 }
@@ -100,6 +149,8 @@ extern "C" {
 JNIEXPORT jint JNI_OnLoad(JavaVM* vm, void* reserved) {
     LOGI("JNI_OnLoad");
     g_camera.reset(new MyNdkCamera());
+    // 推理流尺寸是常量, 在相机打开前定下来, 加载模型时不用再重开相机
+    g_camera->set_inference_targets(Yolopv2::getYolopv2TargetSize(), Yolopv2::getYolov8TargetSize());
     return JNI_VERSION_1_4;
 }
 
@@ -121,18 +172,30 @@ Java_com_tencent_yolopv2ncnn_Yolopv2Ncnn_loadModel(JNIEnv* env, jobject thiz, jo
     }
 
     bool use_gpu = (int)core == 1;
+
+    // 旧模型的析构要等加载和流水线线程结束, 在锁外进行, 渲染线程每帧都要拿 g_mutex
+    // 先释放再加载新模型, 两份权重不同时占内存
+    std::shared_ptr<Yolopv2> yolopv2;
     {
         std::lock_guard<std::mutex> lock(g_mutex);
         if (use_gpu && ncnn::get_gpu_count() == 0) {
             return JNI_FALSE;
         }
+        yolopv2.swap(g_yolopv2);
+    }
+    yolopv2.reset();
+
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        // 两个网络在后台并行加载, 流水线马上启动, 先就绪的网络先出结果
         g_yolopv2.reset(new Yolopv2());
-        if (g_yolopv2->load(mgr, use_gpu) == 0) {
-            g_yolopv2->startThreads();
-            return JNI_TRUE;
-        }
-        return JNI_FALSE;
+        g_yolopv2->startLoading(mgr, use_gpu);
+        g_yolopv2->startThreads();
+        yolopv2 = g_yolopv2;
     }
+
+    // 只为了返回加载结果, 渲染线程照常显示
+    return yolopv2->waitLoaded() == 0 ? JNI_TRUE : JNI_FALSE;
 }
 
 JNIEXPORT jboolean JNICALL
@@ -177,9 +240,17 @@ Java_com_tencent_yolopv2ncnn_Yolopv2Ncnn_enableObjectDetection(JNIEnv *env, jobj
     g_enable_object_detection = enable;
 }
 
+JNIEXPORT void JNICALL
+Java_com_tencent_yolopv2ncnn_Yolopv2Ncnn_enableSingleNetwork(JNIEnv *env, jobject thiz, jboolean enable) {
+    g_enable_single_network = enable;
+}
+
 JNIEXPORT void JNICALL
 Java_com_tencent_yolopv2ncnn_Yolopv2Ncnn_setZoom(JNIEnv *env, jobject thiz, jfloat zoom) {
     g_zoom = zoom;
+    if (g_camera) {
+        g_camera->set_zoom(zoom);
+    }
     __android_log_print(ANDROID_LOG_DEBUG, "Yolopv2Ncnn", "Zoom set to %f", g_zoom);
 }
 
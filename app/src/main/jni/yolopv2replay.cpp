@@ -0,0 +1,321 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+// headless linux driver, replays a recording through the same Yolopv2 / Yolov8 pipeline as the app
+//
+// usage: yolopv2replay [-f nv21|yuv420p|images] [-s WxH] [-r fps] [-t rotate_type] [-o outdir] [-d depth] [-c] [-j yolopv2_threads,yolov8_threads] [-a yolopv2_mask,yolov8_mask] [-g] [-m] [-n] [-k] model_dir source
+//   -r 0 replays as fast as possible, every frame waits for its inference to finish
+//   -n reads the weights into memory instead of mapping the .bin files
+//   -m takes objects from yolopv2's own detection heads instead of running yolov8
+//   -k keeps the whole yolopv2 graph, by default the layers only the unused outputs need are pruned at load
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "compositor.h"
+#include "replaysource.h"
+#include "yolopv2.h"
+
+bool g_enable_drivable_area = true;
+bool g_enable_lane_detection = true;
+bool g_enable_object_detection = true;
+bool g_enable_single_network = false;
+float g_zoom = 1.0f;
+
+static std::unique_ptr<Yolopv2> g_yolopv2;
+
+class HeadlessReplay : public ReplaySource
+{
+public:
+    HeadlessReplay();
+    virtual ~HeadlessReplay();
+    virtual void on_image(const unsigned char* nv21, int nv21_width, int nv21_height, int64_t timestamp) const;
+
+public:
+    int rotate_type;
+    bool wait_processed;
+    const char* output_dir;
+
+    mutable int frame_count;
+    mutable TimingInfo timing_sum;
+    mutable TimingInfo timing_last;
+    mutable int latency_count;
+    mutable double capture_to_display_sum;
+};
+
+HeadlessReplay::HeadlessReplay()
+{
+    rotate_type = 1;
+    wait_processed = false;
+    output_dir = 0;
+
+    frame_count = 0;
+    memset(&timing_sum, 0, sizeof(timing_sum));
+    memset(&timing_last, 0, sizeof(timing_last));
+    latency_count = 0;
+    capture_to_display_sum = 0;
+}
+
+HeadlessReplay::~HeadlessReplay()
+{
+    // stop the replay thread before on_image stops being ours
+    close();
+}
+
+void HeadlessReplay::on_image(const unsigned char* nv21, int nv21_width, int nv21_height, int64_t timestamp) const
+{
+    const Nv21Roi roi = {nv21, nv21_width, nv21_height, 0, 0, nv21_width, nv21_height, rotate_type};
+
+    int frame_id = g_yolopv2->updateLatestFrame(roi, timestamp);
+    if (wait_processed)
+    {
+        g_yolopv2->waitProcessedFrame(frame_id);
+    }
+
+    // the replay thread stands in for the display, every delivered frame shows the latest result
+    TimingInfo timing = TimingInfo();
+    DetectionResult result;
+    const bool has_result = g_yolopv2->getLatestResult(result, &timing);
+
+    if (output_dir && has_result)
+    {
+        // upright rgb of this frame with the latest result composited, same as NdkCameraWindow::render_newest
+        const int w = roi.upright_w();
+        const int h = roi.upright_h();
+
+        cv::Mat nv21_rotated(h + h / 2, w, CV_8UC1);
+        ncnn::kanna_rotate_yuv420sp(nv21, nv21_width, nv21_height, nv21_rotated.data, w, h, rotate_type);
+
+        cv::Mat rgb(h, w, CV_8UC3);
+        ncnn::yuv420sp2rgb(nv21_rotated.data, w, h, rgb.data);
+
+        zoom_view(rgb, g_zoom);
+        composite_result(rgb, g_zoom, result, &timing);
+
+        char path[256];
+        sprintf(path, "%s/%06d.png", output_dir, frame_count);
+
+        cv::Mat bgr;
+        cv::cvtColor(rgb, bgr, cv::COLOR_RGB2BGR);
+        cv::imwrite(path, bgr);
+    }
+
+    timing_last = timing;
+    if (has_result)
+    {
+        timing_sum.capture_to_inference += timing.capture_to_inference;
+        capture_to_display_sum += (frame_timestamp_now() - timing.capture_timestamp) / 1000000.0;
+        latency_count++;
+    }
+
+    timing_sum.preprocess += timing.preprocess;
+    timing_sum.model_inference += timing.model_inference;
+    timing_sum.lane_and_area += timing.lane_and_area;
+    timing_sum.object_detection += timing.object_detection;
+    timing_sum.lane_area_draw += timing.lane_area_draw;
+    timing_sum.object_drawing += timing.object_drawing;
+    timing_sum.total_time += timing.total_time;
+
+    frame_count++;
+}
+
+// hex cpu bitmask, bit i enables cpu i, parsing stops at the first non hex character
+static ncnn::CpuSet parse_cpu_mask(const char* s)
+{
+    unsigned long long bits = strtoull(s, 0, 16);
+
+    ncnn::CpuSet mask;
+    mask.disable_all();
+    for (int i = 0; i < 64; i++)
+    {
+        if (bits & (1ULL << i))
+            mask.enable(i);
+    }
+    return mask;
+}
+
+static void print_usage()
+{
+    fprintf(stderr, "usage: yolopv2replay [-f nv21|yuv420p|images] [-s WxH] [-r fps] [-t rotate_type] [-o outdir] [-d depth] [-c] [-j yolopv2_threads,yolov8_threads] [-a yolopv2_mask,yolov8_mask] [-g] [-m] [-n] [-k] model_dir source\n");
+}
+
+int main(int argc, char** argv)
+{
+    int format = REPLAY_NV21;
+    int width = 0;
+    int height = 0;
+    float fps = 30.f;
+    int rotate_type = 1;
+    const char* output_dir = 0;
+    int depth = 2;
+    bool concurrent = false;
+    NetThreadConfig yolopv2_config;
+    yolopv2_config.num_threads = ncnn::get_big_cpu_count();
+    yolopv2_config.affinity = ncnn::get_cpu_thread_affinity_mask(0);
+    NetThreadConfig yolov8_config = yolopv2_config;
+    bool use_gpu = false;
+    bool map_weights = true;
+    bool prune_outputs = true;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:s:r:t:o:d:cj:a:gmnk")) != -1)
+    {
+        switch (opt)
+        {
+        case 'f':
+            if (strcmp(optarg, "nv21") == 0)
+                format = REPLAY_NV21;
+            else if (strcmp(optarg, "yuv420p") == 0)
+                format = REPLAY_YUV420P;
+            else if (strcmp(optarg, "images") == 0)
+                format = REPLAY_IMAGES;
+            else
+            {
+                print_usage();
+                return -1;
+            }
+            break;
+        case 's':
+            sscanf(optarg, "%dx%d", &width, &height);
+            break;
+        case 'r':
+            fps = atof(optarg);
+            break;
+        case 't':
+            rotate_type = atoi(optarg);
+            break;
+        case 'o':
+            output_dir = optarg;
+            break;
+        case 'd':
+            depth = atoi(optarg);
+            break;
+        case 'c':
+            concurrent = true;
+            break;
+        case 'j':
+            sscanf(optarg, "%d,%d", &yolopv2_config.num_threads, &yolov8_config.num_threads);
+            break;
+        case 'a':
+        {
+            const char* comma = strchr(optarg, ',');
+            if (!comma)
+            {
+                print_usage();
+                return -1;
+            }
+            yolopv2_config.affinity = parse_cpu_mask(optarg);
+            yolov8_config.affinity = parse_cpu_mask(comma + 1);
+            break;
+        }
+        case 'g':
+            use_gpu = true;
+            break;
+        case 'm':
+            g_enable_single_network = true;
+            break;
+        case 'n':
+            map_weights = false;
+            break;
+        case 'k':
+            prune_outputs = false;
+            break;
+        default:
+            print_usage();
+            return -1;
+        }
+    }
+
+    if (argc - optind != 2)
+    {
+        print_usage();
+        return -1;
+    }
+
+    const char* model_dir = argv[optind];
+    const char* source_path = argv[optind + 1];
+
+    g_yolopv2.reset(new Yolopv2());
+    g_yolopv2->setPruneUnusedOutputs(prune_outputs);
+    if (g_yolopv2->load(model_dir, use_gpu, map_weights) != 0)
+    {
+        fprintf(stderr, "load models from %s failed\n", model_dir);
+        return -1;
+    }
+    g_yolopv2->setPipelineDepth(depth);
+    g_yolopv2->setNetThreads(yolopv2_config, yolov8_config, concurrent);
+    g_yolopv2->startThreads();
+
+    HeadlessReplay replay;
+    replay.rotate_type = rotate_type;
+    replay.wait_processed = fps <= 0.f;
+    replay.output_dir = output_dir;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (replay.open(source_path, format, width, height, fps) != 0)
+    {
+        return -1;
+    }
+
+    while (!replay.finished())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    replay.close();
+
+    auto end = std::chrono::steady_clock::now();
+
+    std::vector<StageStats> stage_stats = g_yolopv2->getStageStats();
+    g_yolopv2->stopThreads();
+
+    const double elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+    const int n = std::max(replay.frame_count, 1);
+
+    fprintf(stderr, "frames %d  elapsed %.1f ms  %.2f fps\n", replay.frame_count, elapsed, replay.frame_count * 1000.0 / elapsed);
+    fprintf(stderr, "avg  pre %.2f  model %.2f  l/a %.2f  obj %.2f  mask draw %.2f  box draw %.2f  total %.2f ms\n",
+            replay.timing_sum.preprocess / n, replay.timing_sum.model_inference / n,
+            replay.timing_sum.lane_and_area / n, replay.timing_sum.object_detection / n,
+            replay.timing_sum.lane_area_draw / n, replay.timing_sum.object_drawing / n, replay.timing_sum.total_time / n);
+
+    const int ln = std::max(replay.latency_count, 1);
+    fprintf(stderr, "avg  capture->inference %.2f  capture->display %.2f ms\n",
+            replay.timing_sum.capture_to_inference / ln, replay.capture_to_display_sum / ln);
+    fprintf(stderr, "dropped  before inference %d  before display %d\n",
+            replay.timing_last.dropped_before_inference, replay.timing_last.dropped_before_display);
+
+    const FrameCopyCounter& copies = frame_copy_counter();
+    fprintf(stderr, "frame copies  %.2f /frame  %.1f KB /frame  reallocs %.2f /frame\n", (double)copies.count / n, copies.bytes / 1024.0 / n, (double)copies.reallocs / n);
+
+    fprintf(stderr, "stage      frames  busy%%   busy ms  wait ms  blocked ms\n");
+    for (size_t i = 0; i < stage_stats.size(); i++)
+    {
+        const StageStats& s = stage_stats[i];
+        fprintf(stderr, "%-9s  %6d  %5.1f  %7.2f  %7.2f  %10.2f\n", s.name, (int)s.frames, s.occupancy * 100,
+                s.avg_busy, s.avg_queue_wait, s.avg_blocked);
+    }
+
+    return 0;
+}
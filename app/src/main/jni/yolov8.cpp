@@ -19,215 +19,21 @@
 
 #include "cpu.h"
 
-static float fast_exp(float x)
-{
-    union {
-        uint32_t i;
-        float f;
-    } v{};
-    v.i = (1 << 23) * (1.4426950409 * x + 126.93490512f);
-    return v.f;
-}
-
-static float sigmoid(float x)
-{
-    return 1.0f / (1.0f + fast_exp(-x));
-}
-static float intersection_area(const Object& a, const Object& b)
-{
-    cv::Rect_<float> inter = a.rect & b.rect;
-    return inter.area();
-}
-
-static void qsort_descent_inplace(std::vector<Object>& faceobjects, int left, int right)
-{
-    int i = left;
-    int j = right;
-    float p = faceobjects[(left + right) / 2].prob;
-
-    while (i <= j)
-    {
-        while (faceobjects[i].prob > p)
-            i++;
-
-        while (faceobjects[j].prob < p)
-            j--;
-
-        if (i <= j)
-        {
-            // swap
-            std::swap(faceobjects[i], faceobjects[j]);
-
-            i++;
-            j--;
-        }
-    }
-
-    //     #pragma omp parallel sections
-    {
-        //         #pragma omp section
-        {
-            if (left < j) qsort_descent_inplace(faceobjects, left, j);
-        }
-        //         #pragma omp section
-        {
-            if (i < right) qsort_descent_inplace(faceobjects, i, right);
-        }
-    }
-}
-
-static void qsort_descent_inplace(std::vector<Object>& faceobjects)
-{
-    if (faceobjects.empty())
-        return;
-
-    qsort_descent_inplace(faceobjects, 0, faceobjects.size() - 1);
-}
-
-static void nms_sorted_bboxes(const std::vector<Object>& faceobjects, std::vector<int>& picked, float nms_threshold)
-{
-    picked.clear();
-
-    const int n = faceobjects.size();
-
-    std::vector<float> areas(n);
-    for (int i = 0; i < n; i++)
-    {
-        areas[i] = faceobjects[i].rect.width * faceobjects[i].rect.height;
-    }
-
-    for (int i = 0; i < n; i++)
-    {
-        const Object& a = faceobjects[i];
-
-        int keep = 1;
-        for (int j = 0; j < (int)picked.size(); j++)
-        {
-            const Object& b = faceobjects[picked[j]];
-
-            // intersection over union
-            float inter_area = intersection_area(a, b);
-            float union_area = areas[i] + areas[picked[j]] - inter_area;
-            // float IoU = inter_area / union_area
-            if (inter_area / union_area > nms_threshold)
-                keep = 0;
-        }
-
-        if (keep)
-            picked.push_back(i);
-    }
-}
-static void generate_grids_and_stride(const int target_w, const int target_h, std::vector<int>& strides, std::vector<GridAndStride>& grid_strides)
-{
-    for (int i = 0; i < (int)strides.size(); i++)
-    {
-        int stride = strides[i];
-        int num_grid_w = target_w / stride;
-        int num_grid_h = target_h / stride;
-        for (int g1 = 0; g1 < num_grid_h; g1++)
-        {
-            for (int g0 = 0; g0 < num_grid_w; g0++)
-            {
-                GridAndStride gs;
-                gs.grid0 = g0;
-                gs.grid1 = g1;
-                gs.stride = stride;
-                grid_strides.push_back(gs);
-            }
-        }
-    }
-}
-static void generate_proposals(std::vector<GridAndStride> grid_strides, const ncnn::Mat& pred, float prob_threshold, std::vector<Object>& objects)
-{
-    const int num_points = grid_strides.size();
-    const int num_class = 80;
-    const int reg_max_1 = 16;
-
-    for (int i = 0; i < num_points; i++)
-    {
-        const float* scores = pred.row(i) + 4 * reg_max_1;
-
-        // find label with max score
-        int label = -1;
-        float score = -FLT_MAX;
-        for (int k = 0; k < num_class; k++)
-        {
-            float confidence = scores[k];
-            if (confidence > score)
-            {
-                label = k;
-                score = confidence;
-            }
-        }
-        float box_prob = sigmoid(score);
-        if (box_prob >= prob_threshold)
-        {
-            ncnn::Mat bbox_pred(reg_max_1, 4, (void*)pred.row(i));
-            {
-                ncnn::Layer* softmax = ncnn::create_layer("Softmax");
-
-                ncnn::ParamDict pd;
-                pd.set(0, 1); // axis
-                pd.set(1, 1);
-                softmax->load_param(pd);
-
-                ncnn::Option opt;
-                opt.num_threads = 1;
-                opt.use_packing_layout = false;
-
-                softmax->create_pipeline(opt);
-
-                softmax->forward_inplace(bbox_pred, opt);
-
-                softmax->destroy_pipeline(opt);
-
-                delete softmax;
-            }
-
-            float pred_ltrb[4];
-            for (int k = 0; k < 4; k++)
-            {
-                float dis = 0.f;
-                const float* dis_after_sm = bbox_pred.row(k);
-                for (int l = 0; l < reg_max_1; l++)
-                {
-                    dis += l * dis_after_sm[l];
-                }
-
-                pred_ltrb[k] = dis * grid_strides[i].stride;
-            }
-
-            float pb_cx = (grid_strides[i].grid0 + 0.5f) * grid_strides[i].stride;
-            float pb_cy = (grid_strides[i].grid1 + 0.5f) * grid_strides[i].stride;
-
-            float x0 = pb_cx - pred_ltrb[0];
-            float y0 = pb_cy - pred_ltrb[1];
-            float x1 = pb_cx + pred_ltrb[2];
-            float y1 = pb_cy + pred_ltrb[3];
-
-            Object obj;
-            obj.rect.x = x0;
-            obj.rect.y = y0;
-            obj.rect.width = x1 - x0;
-            obj.rect.height = y1 - y0;
-            obj.label = label;
-            obj.prob = box_prob;
-
-            objects.push_back(obj);
-        }
-    }
-}
+// yolov8s shares the graph of yolov8n, so the blob indices hold for both
+#include "yolov8n.id.h"
 
 Yolov8::Yolov8()
 {
     blob_pool_allocator.set_size_compare_ratio(0.f);
     workspace_pool_allocator.set_size_compare_ratio(0.f);
-}
 
+    pre_nms_topk = 1000;
+}
 
-int Yolov8::load(AAssetManager* mgr, const char* modeltype, int _target_size, const float* _mean_vals, const float* _norm_vals, bool use_gpu)
+void Yolov8::prepare(int _target_size, const float* _mean_vals, const float* _norm_vals, bool use_gpu)
 {
     yolov8.clear();
+    weights.close();
     blob_pool_allocator.clear();
     workspace_pool_allocator.clear();
 
@@ -244,14 +50,6 @@ int Yolov8::load(AAssetManager* mgr, const char* modeltype, int _target_size, co
     yolov8.opt.blob_allocator = &blob_pool_allocator;
     yolov8.opt.workspace_allocator = &workspace_pool_allocator;
 
-    char parampath[256];
-    char modelpath[256];
-    sprintf(parampath, "yolov8%s.param", modeltype);
-    sprintf(modelpath, "yolov8%s.bin", modeltype);
-
-    yolov8.load_param(mgr, parampath);
-    yolov8.load_model(mgr, modelpath);
-
     target_size = _target_size;
     mean_vals[0] = _mean_vals[0];
     mean_vals[1] = _mean_vals[1];
@@ -259,62 +57,65 @@ int Yolov8::load(AAssetManager* mgr, const char* modeltype, int _target_size, co
     norm_vals[0] = _norm_vals[0];
     norm_vals[1] = _norm_vals[1];
     norm_vals[2] = _norm_vals[2];
+}
 
-    return 0;
+void Yolov8::set_num_threads(int num_threads)
+{
+    yolov8.opt.num_threads = num_threads;
 }
 
-int Yolov8::detect(const cv::Mat& rgb, std::vector<Object>& objects, float prob_threshold, float nms_threshold)
+void Yolov8::set_pre_nms_topk(int topk)
 {
-    int width = rgb.cols;
-    int height = rgb.rows;
-
-    // pad to multiple of 32
-    int w = width;
-    int h = height;
-    float scale = 1.f;
-    if (w > h)
-    {
-        scale = (float)target_size / w;
-        w = target_size;
-        h = h * scale;
-    }
-    else
-    {
-        scale = (float)target_size / h;
-        h = target_size;
-        w = w * scale;
-    }
+    pre_nms_topk = topk;
+}
 
-    ncnn::Mat in = ncnn::Mat::from_pixels_resize(rgb.data, ncnn::Mat::PIXEL_RGB2BGR, width, height, w, h);
+#if __ANDROID__
+int Yolov8::load(AAssetManager* mgr, const char* modeltype, int _target_size, const float* _mean_vals, const float* _norm_vals, bool use_gpu, bool map_weights)
+{
+    prepare(_target_size, _mean_vals, _norm_vals, use_gpu);
 
-    // pad to target_size rectangle
-    int wpad = (w + 31) / 32 * 32 - w;
-    int hpad = (h + 31) / 32 * 32 - h;
-    ncnn::Mat in_pad;
-    ncnn::copy_make_border(in, in_pad, hpad / 2, hpad - hpad / 2, wpad / 2, wpad - wpad / 2, ncnn::BORDER_CONSTANT, 0.f);
+    char parampath[256];
+    char modelpath[256];
+    sprintf(parampath, "yolov8%s.param.bin", modeltype);
+    sprintf(modelpath, "yolov8%s.bin", modeltype);
+
+    return load_net_timed(yolov8, weights, mgr, parampath, modelpath, map_weights, phases);
+}
+#else
+int Yolov8::load(const char* model_dir, const char* modeltype, int _target_size, const float* _mean_vals, const float* _norm_vals, bool use_gpu, bool map_weights)
+{
+    prepare(_target_size, _mean_vals, _norm_vals, use_gpu);
+
+    char parampath[256];
+    char modelpath[256];
+    sprintf(parampath, "%s/yolov8%s.param.bin", model_dir, modeltype);
+    sprintf(modelpath, "%s/yolov8%s.bin", model_dir, modeltype);
 
-    in_pad.substract_mean_normalize(0, norm_vals);
+    return load_net_timed(yolov8, weights, parampath, modelpath, map_weights, phases);
+}
+#endif
 
+int Yolov8::detect(const ncnn::Mat& in_pad, const Letterbox& lb, int width, int height, std::vector<Object>& objects, float prob_threshold, float nms_threshold, int max_det)
+{
     ncnn::Extractor ex = yolov8.create_extractor();
 
-    ex.input("images", in_pad);
+    ex.input(yolov8n_param_id::BLOB_images, in_pad);
 
     std::vector<Object> proposals;
     
     ncnn::Mat out;
-    ex.extract("output", out);
+    ex.extract(yolov8n_param_id::BLOB_output, out);
 
-    std::vector<int> strides = {8, 16, 32}; // might have stride=64
-    std::vector<GridAndStride> grid_strides;
-    generate_grids_and_stride(in_pad.w, in_pad.h, strides, grid_strides);
-    generate_proposals(grid_strides, out, prob_threshold, proposals);
+    const int strides[3] = {8, 16, 32}; // might have stride=64
+    update_anchor_table(anchors, in_pad.w, in_pad.h, strides, 3);
+    generate_dfl_proposals(anchors, out, 80, 16, prob_threshold, proposals);
 
-    // sort all proposals by score from highest to lowest
-    qsort_descent_inplace(proposals);
+    // keep the pre_nms_topk best proposals, sorted by score from highest to lowest
+    rank_proposals(proposals, pre_nms_topk);
 
-    // apply nms with nms_threshold
+    // apply per class nms with nms_threshold
     std::vector<int> picked;
-    nms_sorted_bboxes(proposals, picked, nms_threshold);
+    nms_sorted_bboxes(proposals, picked, nms_threshold, false, max_det);
 
     int count = picked.size();
 
@@ -324,10 +125,10 @@ int Yolov8::detect(const cv::Mat& rgb, std::vector<Object>& objects, float prob_
         objects[i] = proposals[picked[i]];
 
         // adjust offset to original unpadded
-        float x0 = (objects[i].rect.x - (wpad / 2)) / scale;
-        float y0 = (objects[i].rect.y - (hpad / 2)) / scale;
-        float x1 = (objects[i].rect.x + objects[i].rect.width - (wpad / 2)) / scale;
-        float y1 = (objects[i].rect.y + objects[i].rect.height - (hpad / 2)) / scale;
+        float x0 = (objects[i].rect.x - lb.left) / lb.scale;
+        float y0 = (objects[i].rect.y - lb.top) / lb.scale;
+        float x1 = (objects[i].rect.x + objects[i].rect.width - lb.left) / lb.scale;
+        float y1 = (objects[i].rect.y + objects[i].rect.height - lb.top) / lb.scale;
 
         // clip
         x0 = std::max(std::min(x0, (float)(width - 1)), 0.f);
@@ -402,7 +203,8 @@ int Yolov8::draw(cv::Mat& rgb, const std::vector<Object>& objects)
         const unsigned char* color = colors[color_index % 19];
         color_index++;
 
-        cv::Scalar cc(color[0], color[1], color[2]);
+        // alpha 255 for rgba window buffers, ignored on rgb
+        cv::Scalar cc(color[0], color[1], color[2], 255);
 
         cv::rectangle(rgb, obj.rect, cc, 2);
 
@@ -421,7 +223,7 @@ int Yolov8::draw(cv::Mat& rgb, const std::vector<Object>& objects)
 
         cv::rectangle(rgb, cv::Rect(cv::Point(x, y), cv::Size(label_size.width, label_size.height + baseLine)), cc, -1);
 
-        cv::Scalar textcc = (color[0] + color[1] + color[2] >= 381) ? cv::Scalar(0, 0, 0) : cv::Scalar(255, 255, 255);
+        cv::Scalar textcc = (color[0] + color[1] + color[2] >= 381) ? cv::Scalar(0, 0, 0, 255) : cv::Scalar(255, 255, 255, 255);
 
         cv::putText(rgb, text, cv::Point(x, y + label_size.height), cv::FONT_HERSHEY_SIMPLEX, 0.5, textcc, 1);
     }
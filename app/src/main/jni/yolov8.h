@@ -16,37 +16,72 @@
 
 #include <net.h>
 
-struct Object
-{
-    cv::Rect_<float> rect;
-    int label;
-    float prob;
-};
-struct GridAndStride
-{
-    int grid0;
-    int grid1;
-    int stride;
-};
+#include "detpost.h"
+#include "inputpyramid.h"
+#include "modelbuffer.h"
+
 class Yolov8
 {
 public:
     Yolov8();
 
-//    int load(const char* modeltype, int target_size, const float* mean_vals, const float* norm_vals, bool use_gpu = false);
+    // map_weights references the .bin in place from the mapped asset or file instead of reading it into the net
+#if __ANDROID__
+    int load(AAssetManager* mgr, const char* modeltype, int target_size, const float* mean_vals, const float* norm_vals, bool use_gpu = false, bool map_weights = true);
+#else
+    // model_dir holds yolov8{modeltype}.param and .bin
+    int load(const char* model_dir, const char* modeltype, int target_size, const float* mean_vals, const float* norm_vals, bool use_gpu = false, bool map_weights = true);
+#endif
+
+    // whether the loaded weights are file backed rather than copied
+    bool weights_mapped() const
+    {
+        return weights.mapped();
+    }
+
+    // param, weight and pipeline timings of the last load
+    const LoadPhases& load_phases() const
+    {
+        return phases;
+    }
 
-    int load(AAssetManager* mgr, const char* modeltype, int target_size, const float* mean_vals, const float* norm_vals, bool use_gpu = false);
+    // in_pad is a width x height image letterboxed as lb into input_size() and normalized by 1/255 in bgr order,
+    // see InputPyramid, objects are returned in width x height coordinates
+    // at most max_det of the highest scoring objects are kept
+    int detect(const ncnn::Mat& in_pad, const Letterbox& lb, int width, int height, std::vector<Object>& objects, float prob_threshold = 0.3f, float nms_threshold = 0.45f, int max_det = 300);
 
-    int detect(const cv::Mat& rgb, std::vector<Object>& objects, float prob_threshold = 0.3f, float nms_threshold = 0.45f);
+    // long side of the letterboxed input
+    int input_size() const
+    {
+        return target_size;
+    }
 
-    int draw(cv::Mat& rgb, const std::vector<Object>& objects);
+    // stateless, safe to call from the display thread while detect runs
+    static int draw(cv::Mat& rgb, const std::vector<Object>& objects);
+
+    // threads used by the next detect calls, the caller binds its own affinity
+    void set_num_threads(int num_threads);
+
+    // proposals kept for nms, ranked by score, <= 0 keeps all
+    void set_pre_nms_topk(int topk);
+
+private:
+    void prepare(int target_size, const float* mean_vals, const float* norm_vals, bool use_gpu);
 
 private:
+    // declared before the net, which references it until destroyed
+    ModelBuffer weights;
     ncnn::Net yolov8;
     int target_size;
     float mean_vals[3];
     float norm_vals[3];
+    int pre_nms_topk;
     ncnn::UnlockedPoolAllocator blob_pool_allocator;
     ncnn::PoolAllocator workspace_pool_allocator;
+
+    LoadPhases phases;
+
+    // anchor centers and strides, rebuilt only when the padded input size changes
+    AnchorTable anchors;
 };
 
@@ -0,0 +1,239 @@
+// generated by tools/ncnnparam2bin.py from yolov8n.param, do not edit
+#ifndef NCNN_INCLUDE_GUARD_yolov8n_id_h
+#define NCNN_INCLUDE_GUARD_yolov8n_id_h
+namespace yolov8n_param_id {
+const int BLOB_images = 0;
+const int BLOB_128 = 1;
+const int BLOB_130 = 2;
+const int BLOB_131 = 3;
+const int BLOB_133 = 4;
+const int BLOB_134 = 5;
+const int BLOB_136 = 6;
+const int BLOB_136_splitncnn_0 = 7;
+const int BLOB_136_splitncnn_1 = 8;
+const int BLOB_141 = 9;
+const int BLOB_146 = 10;
+const int BLOB_146_splitncnn_0 = 11;
+const int BLOB_146_splitncnn_1 = 12;
+const int BLOB_146_splitncnn_2 = 13;
+const int BLOB_147 = 14;
+const int BLOB_149 = 15;
+const int BLOB_150 = 16;
+const int BLOB_152 = 17;
+const int BLOB_153 = 18;
+const int BLOB_154 = 19;
+const int BLOB_155 = 20;
+const int BLOB_157 = 21;
+const int BLOB_158 = 22;
+const int BLOB_160 = 23;
+const int BLOB_161 = 24;
+const int BLOB_163 = 25;
+const int BLOB_163_splitncnn_0 = 26;
+const int BLOB_163_splitncnn_1 = 27;
+const int BLOB_168 = 28;
+const int BLOB_173 = 29;
+const int BLOB_173_splitncnn_0 = 30;
+const int BLOB_173_splitncnn_1 = 31;
+const int BLOB_173_splitncnn_2 = 32;
+const int BLOB_174 = 33;
+const int BLOB_176 = 34;
+const int BLOB_177 = 35;
+const int BLOB_179 = 36;
+const int BLOB_180 = 37;
+const int BLOB_180_splitncnn_0 = 38;
+const int BLOB_180_splitncnn_1 = 39;
+const int BLOB_180_splitncnn_2 = 40;
+const int BLOB_181 = 41;
+const int BLOB_183 = 42;
+const int BLOB_184 = 43;
+const int BLOB_186 = 44;
+const int BLOB_187 = 45;
+const int BLOB_188 = 46;
+const int BLOB_189 = 47;
+const int BLOB_191 = 48;
+const int BLOB_191_splitncnn_0 = 49;
+const int BLOB_191_splitncnn_1 = 50;
+const int BLOB_192 = 51;
+const int BLOB_194 = 52;
+const int BLOB_195 = 53;
+const int BLOB_197 = 54;
+const int BLOB_197_splitncnn_0 = 55;
+const int BLOB_197_splitncnn_1 = 56;
+const int BLOB_202 = 57;
+const int BLOB_207 = 58;
+const int BLOB_207_splitncnn_0 = 59;
+const int BLOB_207_splitncnn_1 = 60;
+const int BLOB_207_splitncnn_2 = 61;
+const int BLOB_208 = 62;
+const int BLOB_210 = 63;
+const int BLOB_211 = 64;
+const int BLOB_213 = 65;
+const int BLOB_214 = 66;
+const int BLOB_214_splitncnn_0 = 67;
+const int BLOB_214_splitncnn_1 = 68;
+const int BLOB_214_splitncnn_2 = 69;
+const int BLOB_215 = 70;
+const int BLOB_217 = 71;
+const int BLOB_218 = 72;
+const int BLOB_220 = 73;
+const int BLOB_221 = 74;
+const int BLOB_222 = 75;
+const int BLOB_223 = 76;
+const int BLOB_225 = 77;
+const int BLOB_225_splitncnn_0 = 78;
+const int BLOB_225_splitncnn_1 = 79;
+const int BLOB_226 = 80;
+const int BLOB_228 = 81;
+const int BLOB_229 = 82;
+const int BLOB_231 = 83;
+const int BLOB_231_splitncnn_0 = 84;
+const int BLOB_231_splitncnn_1 = 85;
+const int BLOB_236 = 86;
+const int BLOB_241 = 87;
+const int BLOB_241_splitncnn_0 = 88;
+const int BLOB_241_splitncnn_1 = 89;
+const int BLOB_241_splitncnn_2 = 90;
+const int BLOB_242 = 91;
+const int BLOB_244 = 92;
+const int BLOB_245 = 93;
+const int BLOB_247 = 94;
+const int BLOB_248 = 95;
+const int BLOB_249 = 96;
+const int BLOB_250 = 97;
+const int BLOB_252 = 98;
+const int BLOB_253 = 99;
+const int BLOB_255 = 100;
+const int BLOB_255_splitncnn_0 = 101;
+const int BLOB_255_splitncnn_1 = 102;
+const int BLOB_256 = 103;
+const int BLOB_256_splitncnn_0 = 104;
+const int BLOB_256_splitncnn_1 = 105;
+const int BLOB_257 = 106;
+const int BLOB_257_splitncnn_0 = 107;
+const int BLOB_257_splitncnn_1 = 108;
+const int BLOB_258 = 109;
+const int BLOB_259 = 110;
+const int BLOB_260 = 111;
+const int BLOB_262 = 112;
+const int BLOB_262_splitncnn_0 = 113;
+const int BLOB_262_splitncnn_1 = 114;
+const int BLOB_267 = 115;
+const int BLOB_268 = 116;
+const int BLOB_269 = 117;
+const int BLOB_271 = 118;
+const int BLOB_271_splitncnn_0 = 119;
+const int BLOB_271_splitncnn_1 = 120;
+const int BLOB_276 = 121;
+const int BLOB_281 = 122;
+const int BLOB_281_splitncnn_0 = 123;
+const int BLOB_281_splitncnn_1 = 124;
+const int BLOB_282 = 125;
+const int BLOB_284 = 126;
+const int BLOB_285 = 127;
+const int BLOB_287 = 128;
+const int BLOB_288 = 129;
+const int BLOB_289 = 130;
+const int BLOB_291 = 131;
+const int BLOB_291_splitncnn_0 = 132;
+const int BLOB_291_splitncnn_1 = 133;
+const int BLOB_296 = 134;
+const int BLOB_297 = 135;
+const int BLOB_298 = 136;
+const int BLOB_300 = 137;
+const int BLOB_300_splitncnn_0 = 138;
+const int BLOB_300_splitncnn_1 = 139;
+const int BLOB_305 = 140;
+const int BLOB_310 = 141;
+const int BLOB_310_splitncnn_0 = 142;
+const int BLOB_310_splitncnn_1 = 143;
+const int BLOB_311 = 144;
+const int BLOB_313 = 145;
+const int BLOB_314 = 146;
+const int BLOB_316 = 147;
+const int BLOB_317 = 148;
+const int BLOB_318 = 149;
+const int BLOB_320 = 150;
+const int BLOB_320_splitncnn_0 = 151;
+const int BLOB_320_splitncnn_1 = 152;
+const int BLOB_320_splitncnn_2 = 153;
+const int BLOB_321 = 154;
+const int BLOB_323 = 155;
+const int BLOB_324 = 156;
+const int BLOB_325 = 157;
+const int BLOB_327 = 158;
+const int BLOB_327_splitncnn_0 = 159;
+const int BLOB_327_splitncnn_1 = 160;
+const int BLOB_332 = 161;
+const int BLOB_337 = 162;
+const int BLOB_337_splitncnn_0 = 163;
+const int BLOB_337_splitncnn_1 = 164;
+const int BLOB_338 = 165;
+const int BLOB_340 = 166;
+const int BLOB_341 = 167;
+const int BLOB_343 = 168;
+const int BLOB_344 = 169;
+const int BLOB_345 = 170;
+const int BLOB_347 = 171;
+const int BLOB_347_splitncnn_0 = 172;
+const int BLOB_347_splitncnn_1 = 173;
+const int BLOB_347_splitncnn_2 = 174;
+const int BLOB_348 = 175;
+const int BLOB_350 = 176;
+const int BLOB_351 = 177;
+const int BLOB_352 = 178;
+const int BLOB_354 = 179;
+const int BLOB_354_splitncnn_0 = 180;
+const int BLOB_354_splitncnn_1 = 181;
+const int BLOB_359 = 182;
+const int BLOB_364 = 183;
+const int BLOB_364_splitncnn_0 = 184;
+const int BLOB_364_splitncnn_1 = 185;
+const int BLOB_365 = 186;
+const int BLOB_367 = 187;
+const int BLOB_368 = 188;
+const int BLOB_370 = 189;
+const int BLOB_371 = 190;
+const int BLOB_372 = 191;
+const int BLOB_374 = 192;
+const int BLOB_374_splitncnn_0 = 193;
+const int BLOB_374_splitncnn_1 = 194;
+const int BLOB_376 = 195;
+const int BLOB_378 = 196;
+const int BLOB_379 = 197;
+const int BLOB_381 = 198;
+const int BLOB_382 = 199;
+const int BLOB_383 = 200;
+const int BLOB_385 = 201;
+const int BLOB_386 = 202;
+const int BLOB_388 = 203;
+const int BLOB_389 = 204;
+const int BLOB_390 = 205;
+const int BLOB_391 = 206;
+const int BLOB_393 = 207;
+const int BLOB_394 = 208;
+const int BLOB_396 = 209;
+const int BLOB_397 = 210;
+const int BLOB_398 = 211;
+const int BLOB_400 = 212;
+const int BLOB_401 = 213;
+const int BLOB_403 = 214;
+const int BLOB_404 = 215;
+const int BLOB_405 = 216;
+const int BLOB_406 = 217;
+const int BLOB_408 = 218;
+const int BLOB_409 = 219;
+const int BLOB_411 = 220;
+const int BLOB_412 = 221;
+const int BLOB_413 = 222;
+const int BLOB_415 = 223;
+const int BLOB_416 = 224;
+const int BLOB_418 = 225;
+const int BLOB_419 = 226;
+const int BLOB_420 = 227;
+const int BLOB_427 = 228;
+const int BLOB_434 = 229;
+const int BLOB_441 = 230;
+const int BLOB_442 = 231;
+const int BLOB_output = 232;
+} // namespace yolov8n_param_id
+#endif // NCNN_INCLUDE_GUARD_yolov8n_id_h
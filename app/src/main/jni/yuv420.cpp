@@ -0,0 +1,784 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#include "yuv420.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif // __ARM_NEON
+#if __SSE2__
+#include <emmintrin.h>
+#endif // __SSE2__
+
+static void copy_plane_y(const Yuv420Plane& y, int width, int height, unsigned char* dst)
+{
+    if (y.pixel_stride == 1)
+    {
+        if (y.row_stride == width)
+        {
+            memcpy(dst, y.data, width * height);
+            return;
+        }
+
+        for (int i = 0; i < height; i++)
+        {
+            memcpy(dst, y.data + y.row_stride * i, width);
+            dst += width;
+        }
+        return;
+    }
+
+    for (int i = 0; i < height; i++)
+    {
+        const unsigned char* ptr = y.data + y.row_stride * i;
+        for (int j = 0; j < width; j++)
+        {
+            dst[0] = ptr[0];
+            dst++;
+            ptr += y.pixel_stride;
+        }
+    }
+}
+
+// vu interleaved source, each row is already nv21
+static void copy_row_vu(const unsigned char* vu, int n, unsigned char* dst)
+{
+    memcpy(dst, vu, n * 2);
+}
+
+// uv interleaved source, swap each byte pair
+static void copy_row_uv(const unsigned char* uv, int n, unsigned char* dst)
+{
+    int i = 0;
+#if __ARM_NEON
+    for (; i + 15 < n; i += 16)
+    {
+        uint8x16_t _p0 = vld1q_u8(uv);
+        uint8x16_t _p1 = vld1q_u8(uv + 16);
+        vst1q_u8(dst, vrev16q_u8(_p0));
+        vst1q_u8(dst + 16, vrev16q_u8(_p1));
+
+        uv += 32;
+        dst += 32;
+    }
+#elif __SSE2__
+    for (; i + 15 < n; i += 16)
+    {
+        __m128i _p0 = _mm_loadu_si128((const __m128i*)uv);
+        __m128i _p1 = _mm_loadu_si128((const __m128i*)(uv + 16));
+        _p0 = _mm_or_si128(_mm_slli_epi16(_p0, 8), _mm_srli_epi16(_p0, 8));
+        _p1 = _mm_or_si128(_mm_slli_epi16(_p1, 8), _mm_srli_epi16(_p1, 8));
+        _mm_storeu_si128((__m128i*)dst, _p0);
+        _mm_storeu_si128((__m128i*)(dst + 16), _p1);
+
+        uv += 32;
+        dst += 32;
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[0] = uv[1];
+        dst[1] = uv[0];
+
+        uv += 2;
+        dst += 2;
+    }
+}
+
+// planar u and v source, interleave as vu
+static void copy_row_planar(const unsigned char* u, const unsigned char* v, int n, unsigned char* dst)
+{
+    int i = 0;
+#if __ARM_NEON
+    for (; i + 15 < n; i += 16)
+    {
+        uint8x16x2_t _vu;
+        _vu.val[0] = vld1q_u8(v);
+        _vu.val[1] = vld1q_u8(u);
+        vst2q_u8(dst, _vu);
+
+        u += 16;
+        v += 16;
+        dst += 32;
+    }
+#elif __SSE2__
+    for (; i + 15 < n; i += 16)
+    {
+        __m128i _v = _mm_loadu_si128((const __m128i*)v);
+        __m128i _u = _mm_loadu_si128((const __m128i*)u);
+        _mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi8(_v, _u));
+        _mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi8(_v, _u));
+
+        u += 16;
+        v += 16;
+        dst += 32;
+    }
+#endif
+    for (; i < n; i++)
+    {
+        dst[0] = v[0];
+        dst[1] = u[0];
+
+        u++;
+        v++;
+        dst += 2;
+    }
+}
+
+static void copy_plane_vu(const Yuv420Plane& u, const Yuv420Plane& v, int width, int height, unsigned char* dst)
+{
+    const int w = width / 2;
+    const int h = height / 2;
+
+    if (u.pixel_stride == 2 && v.pixel_stride == 2 && u.data == v.data + 1 && u.row_stride == v.row_stride)
+    {
+        for (int i = 0; i < h; i++)
+        {
+            copy_row_vu(v.data + v.row_stride * i, w, dst);
+            dst += w * 2;
+        }
+        return;
+    }
+
+    if (u.pixel_stride == 2 && v.pixel_stride == 2 && v.data == u.data + 1 && u.row_stride == v.row_stride)
+    {
+        for (int i = 0; i < h; i++)
+        {
+            copy_row_uv(u.data + u.row_stride * i, w, dst);
+            dst += w * 2;
+        }
+        return;
+    }
+
+    if (u.pixel_stride == 1 && v.pixel_stride == 1)
+    {
+        for (int i = 0; i < h; i++)
+        {
+            copy_row_planar(u.data + u.row_stride * i, v.data + v.row_stride * i, w, dst);
+            dst += w * 2;
+        }
+        return;
+    }
+
+    for (int i = 0; i < h; i++)
+    {
+        const unsigned char* v_ptr = v.data + v.row_stride * i;
+        const unsigned char* u_ptr = u.data + u.row_stride * i;
+        for (int j = 0; j < w; j++)
+        {
+            dst[0] = v_ptr[0];
+            dst[1] = u_ptr[0];
+            dst += 2;
+            v_ptr += v.pixel_stride;
+            u_ptr += u.pixel_stride;
+        }
+    }
+}
+
+void yuv420_888_to_nv21(const Yuv420Plane& y, const Yuv420Plane& u, const Yuv420Plane& v, int width, int height, unsigned char* nv21)
+{
+    copy_plane_y(y, width, height, nv21);
+    copy_plane_vu(u, v, width, height, nv21 + width * height);
+}
+
+static inline unsigned char clamp_u8(int v)
+{
+    return (unsigned char)std::min(std::max(v, 0), 255);
+}
+
+void nv21_to_rgba(const unsigned char* y, int y_stride, const unsigned char* vu, int vu_stride, int w, int h, unsigned char* rgba, int rgba_stride)
+{
+    // R = ((Y << 6) + 90 * V) >> 6
+    // G = ((Y << 6) - 46 * V - 22 * U) >> 6
+    // B = ((Y << 6) + 113 * U) >> 6
+    for (int i = 0; i + 1 < h; i += 2)
+    {
+        const unsigned char* yptr0 = y + i * y_stride;
+        const unsigned char* yptr1 = yptr0 + y_stride;
+        const unsigned char* vuptr = vu + i / 2 * vu_stride;
+        unsigned char* outptr0 = rgba + i * rgba_stride;
+        unsigned char* outptr1 = outptr0 + rgba_stride;
+
+        int j = 0;
+#if __ARM_NEON
+        const uint8x8_t _128 = vdup_n_u8(128);
+        const uint8x8_t _255 = vdup_n_u8(255);
+        for (; j + 7 < w; j += 8)
+        {
+            // v0 u0 v1 u1 v2 u2 v3 u3 minus 128, then one v and one u per pixel
+            int16x8_t _vu = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(vuptr), _128));
+            int16x4x2_t _vvuu = vuzp_s16(vget_low_s16(_vu), vget_high_s16(_vu));
+            int16x4_t _v = _vvuu.val[0];
+            int16x4_t _u = _vvuu.val[1];
+
+            int16x4x2_t _r2 = vzip_s16(vmul_n_s16(_v, 90), vmul_n_s16(_v, 90));
+            int16x4_t _g4 = vmla_n_s16(vmul_n_s16(_v, -46), _u, -22);
+            int16x4x2_t _g2 = vzip_s16(_g4, _g4);
+            int16x4x2_t _b2 = vzip_s16(vmul_n_s16(_u, 113), vmul_n_s16(_u, 113));
+            int16x8_t _ruv = vcombine_s16(_r2.val[0], _r2.val[1]);
+            int16x8_t _guv = vcombine_s16(_g2.val[0], _g2.val[1]);
+            int16x8_t _buv = vcombine_s16(_b2.val[0], _b2.val[1]);
+
+            int16x8_t _y0 = vreinterpretq_s16_u16(vshll_n_u8(vld1_u8(yptr0), 6));
+            int16x8_t _y1 = vreinterpretq_s16_u16(vshll_n_u8(vld1_u8(yptr1), 6));
+
+            uint8x8x4_t _rgba0;
+            _rgba0.val[0] = vqshrun_n_s16(vaddq_s16(_y0, _ruv), 6);
+            _rgba0.val[1] = vqshrun_n_s16(vaddq_s16(_y0, _guv), 6);
+            _rgba0.val[2] = vqshrun_n_s16(vaddq_s16(_y0, _buv), 6);
+            _rgba0.val[3] = _255;
+            vst4_u8(outptr0, _rgba0);
+
+            uint8x8x4_t _rgba1;
+            _rgba1.val[0] = vqshrun_n_s16(vaddq_s16(_y1, _ruv), 6);
+            _rgba1.val[1] = vqshrun_n_s16(vaddq_s16(_y1, _guv), 6);
+            _rgba1.val[2] = vqshrun_n_s16(vaddq_s16(_y1, _buv), 6);
+            _rgba1.val[3] = _255;
+            vst4_u8(outptr1, _rgba1);
+
+            yptr0 += 8;
+            yptr1 += 8;
+            vuptr += 8;
+            outptr0 += 32;
+            outptr1 += 32;
+        }
+#elif __SSE2__
+        const __m128i _zero = _mm_setzero_si128();
+        const __m128i _128 = _mm_set1_epi16(128);
+        const __m128i _255 = _mm_set1_epi8((char)255);
+        for (; j + 7 < w; j += 8)
+        {
+            __m128i _vu = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)vuptr), _zero), _128);
+            __m128i _v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(_vu, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+            __m128i _u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(_vu, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+
+            __m128i _ruv = _mm_mullo_epi16(_v, _mm_set1_epi16(90));
+            __m128i _guv = _mm_add_epi16(_mm_mullo_epi16(_v, _mm_set1_epi16(-46)), _mm_mullo_epi16(_u, _mm_set1_epi16(-22)));
+            __m128i _buv = _mm_mullo_epi16(_u, _mm_set1_epi16(113));
+
+            for (int k = 0; k < 2; k++)
+            {
+                const unsigned char* yptr = k == 0 ? yptr0 : yptr1;
+                unsigned char* outptr = k == 0 ? outptr0 : outptr1;
+
+                __m128i _y = _mm_slli_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)yptr), _zero), 6);
+                __m128i _r = _mm_srai_epi16(_mm_add_epi16(_y, _ruv), 6);
+                __m128i _g = _mm_srai_epi16(_mm_add_epi16(_y, _guv), 6);
+                __m128i _b = _mm_srai_epi16(_mm_add_epi16(_y, _buv), 6);
+
+                // r g b a bytes, interleaved into 8 rgba pixels
+                __m128i _rg = _mm_unpacklo_epi8(_mm_packus_epi16(_r, _r), _mm_packus_epi16(_g, _g));
+                __m128i _ba = _mm_unpacklo_epi8(_mm_packus_epi16(_b, _b), _255);
+                _mm_storeu_si128((__m128i*)outptr, _mm_unpacklo_epi16(_rg, _ba));
+                _mm_storeu_si128((__m128i*)(outptr + 16), _mm_unpackhi_epi16(_rg, _ba));
+            }
+
+            yptr0 += 8;
+            yptr1 += 8;
+            vuptr += 8;
+            outptr0 += 32;
+            outptr1 += 32;
+        }
+#endif
+        for (; j + 1 < w; j += 2)
+        {
+            const int v = vuptr[0] - 128;
+            const int u = vuptr[1] - 128;
+            const int ruv = 90 * v;
+            const int guv = -46 * v - 22 * u;
+            const int buv = 113 * u;
+
+            for (int k = 0; k < 2; k++)
+            {
+                const int y00 = yptr0[k] << 6;
+                outptr0[k * 4] = clamp_u8((y00 + ruv) >> 6);
+                outptr0[k * 4 + 1] = clamp_u8((y00 + guv) >> 6);
+                outptr0[k * 4 + 2] = clamp_u8((y00 + buv) >> 6);
+                outptr0[k * 4 + 3] = 255;
+
+                const int y10 = yptr1[k] << 6;
+                outptr1[k * 4] = clamp_u8((y10 + ruv) >> 6);
+                outptr1[k * 4 + 1] = clamp_u8((y10 + guv) >> 6);
+                outptr1[k * 4 + 2] = clamp_u8((y10 + buv) >> 6);
+                outptr1[k * 4 + 3] = 255;
+            }
+
+            yptr0 += 2;
+            yptr1 += 2;
+            vuptr += 2;
+            outptr0 += 8;
+            outptr1 += 8;
+        }
+    }
+}
+
+Nv21Roi nv21_roi_zoom(const Nv21Roi& roi, float zoom)
+{
+    if (zoom <= 1.f)
+        return roi;
+
+    Nv21Roi r = roi;
+    r.roi_w = std::max((int)(roi.roi_w / zoom) / 2 * 2, 2);
+    r.roi_h = std::max((int)(roi.roi_h / zoom) / 2 * 2, 2);
+    r.roi_x = roi.roi_x + (roi.roi_w - r.roi_w) / 4 * 2;
+    r.roi_y = roi.roi_y + (roi.roi_h - r.roi_h) / 4 * 2;
+    return r;
+}
+
+void nv21_roi_crop(const Nv21Roi& roi, unsigned char* dst)
+{
+    const unsigned char* y = roi.nv21 + roi.roi_y * roi.width + roi.roi_x;
+    for (int i = 0; i < roi.roi_h; i++)
+    {
+        memcpy(dst, y, roi.roi_w);
+        y += roi.width;
+        dst += roi.roi_w;
+    }
+
+    const unsigned char* vu = roi.nv21 + roi.width * roi.height + roi.roi_y / 2 * roi.width + roi.roi_x;
+    for (int i = 0; i < roi.roi_h / 2; i++)
+    {
+        memcpy(dst, vu, roi.roi_w);
+        vu += roi.width;
+        dst += roi.roi_w;
+    }
+}
+
+// byte offset of upright pixel (x, y) is base + x * xstep + y * ystep
+// for a plane of sw x sh samples, sample size elemsize and row stride bytes
+static void resolve_rotate_steps(int rotate_type, int sw, int sh, int elemsize, int stride, int& base, int& xstep, int& ystep)
+{
+    const int right = (sw - 1) * elemsize;
+    const int bottom = (sh - 1) * stride;
+
+    switch (rotate_type)
+    {
+    default:
+    case 1:
+        base = 0;
+        xstep = elemsize;
+        ystep = stride;
+        break;
+    case 2:
+        base = right;
+        xstep = -elemsize;
+        ystep = stride;
+        break;
+    case 3:
+        base = bottom + right;
+        xstep = -elemsize;
+        ystep = -stride;
+        break;
+    case 4:
+        base = bottom;
+        xstep = elemsize;
+        ystep = -stride;
+        break;
+    case 5:
+        base = 0;
+        xstep = stride;
+        ystep = elemsize;
+        break;
+    case 6:
+        base = bottom;
+        xstep = -stride;
+        ystep = elemsize;
+        break;
+    case 7:
+        base = bottom + right;
+        xstep = -stride;
+        ystep = -elemsize;
+        break;
+    case 8:
+        base = right;
+        xstep = stride;
+        ystep = -elemsize;
+        break;
+    }
+}
+
+// bilinear source index and weight for each of the dst samples, same as ncnn resize_bilinear
+static void resolve_bilinear(int srcw, int w, int* ofs, float* alpha)
+{
+    const float scale = (float)srcw / w;
+    for (int i = 0; i < w; i++)
+    {
+        float fx = (float)((i + 0.5f) * scale - 0.5f);
+        int sx = (int)floorf(fx);
+        fx -= sx;
+
+        if (sx < 0)
+        {
+            sx = 0;
+            fx = 0.f;
+        }
+        if (sx >= srcw - 1)
+        {
+            sx = srcw - 2;
+            fx = 1.f;
+        }
+
+        ofs[i] = sx;
+        alpha[i] = fx;
+    }
+}
+
+// yuv to rgb with the same coefficients as ncnn::yuv420sp2rgb, then normalize into three planes
+static void yuv_row_to_planes(const float* yrow, const float* urow, const float* vrow, int w, const float* mean, const float* norm, float* outptr0, float* outptr1, float* outptr2)
+{
+    // outptr0 / outptr1 / outptr2 already ordered as r g b or b g r by the caller
+    int i = 0;
+#if __ARM_NEON
+    float32x4_t _zero = vdupq_n_f32(0.f);
+    float32x4_t _255 = vdupq_n_f32(255.f);
+    float32x4_t _mean0 = vdupq_n_f32(mean[0]);
+    float32x4_t _mean1 = vdupq_n_f32(mean[1]);
+    float32x4_t _mean2 = vdupq_n_f32(mean[2]);
+    float32x4_t _norm0 = vdupq_n_f32(norm[0]);
+    float32x4_t _norm1 = vdupq_n_f32(norm[1]);
+    float32x4_t _norm2 = vdupq_n_f32(norm[2]);
+    for (; i + 3 < w; i += 4)
+    {
+        float32x4_t _y = vld1q_f32(yrow + i);
+        float32x4_t _u = vld1q_f32(urow + i);
+        float32x4_t _v = vld1q_f32(vrow + i);
+
+        float32x4_t _r = vmlaq_n_f32(_y, _v, 1.40625f);
+        float32x4_t _g = vmlaq_n_f32(vmlaq_n_f32(_y, _v, -0.71875f), _u, -0.34375f);
+        float32x4_t _b = vmlaq_n_f32(_y, _u, 1.765625f);
+
+        _r = vminq_f32(vmaxq_f32(_r, _zero), _255);
+        _g = vminq_f32(vmaxq_f32(_g, _zero), _255);
+        _b = vminq_f32(vmaxq_f32(_b, _zero), _255);
+
+        vst1q_f32(outptr0 + i, vmulq_f32(vsubq_f32(_r, _mean0), _norm0));
+        vst1q_f32(outptr1 + i, vmulq_f32(vsubq_f32(_g, _mean1), _norm1));
+        vst1q_f32(outptr2 + i, vmulq_f32(vsubq_f32(_b, _mean2), _norm2));
+    }
+#elif __SSE2__
+    __m128 _zero = _mm_set1_ps(0.f);
+    __m128 _255 = _mm_set1_ps(255.f);
+    __m128 _mean0 = _mm_set1_ps(mean[0]);
+    __m128 _mean1 = _mm_set1_ps(mean[1]);
+    __m128 _mean2 = _mm_set1_ps(mean[2]);
+    __m128 _norm0 = _mm_set1_ps(norm[0]);
+    __m128 _norm1 = _mm_set1_ps(norm[1]);
+    __m128 _norm2 = _mm_set1_ps(norm[2]);
+    for (; i + 3 < w; i += 4)
+    {
+        __m128 _y = _mm_loadu_ps(yrow + i);
+        __m128 _u = _mm_loadu_ps(urow + i);
+        __m128 _v = _mm_loadu_ps(vrow + i);
+
+        __m128 _r = _mm_add_ps(_y, _mm_mul_ps(_v, _mm_set1_ps(1.40625f)));
+        __m128 _g = _mm_sub_ps(_y, _mm_add_ps(_mm_mul_ps(_v, _mm_set1_ps(0.71875f)), _mm_mul_ps(_u, _mm_set1_ps(0.34375f))));
+        __m128 _b = _mm_add_ps(_y, _mm_mul_ps(_u, _mm_set1_ps(1.765625f)));
+
+        _r = _mm_min_ps(_mm_max_ps(_r, _zero), _255);
+        _g = _mm_min_ps(_mm_max_ps(_g, _zero), _255);
+        _b = _mm_min_ps(_mm_max_ps(_b, _zero), _255);
+
+        _mm_storeu_ps(outptr0 + i, _mm_mul_ps(_mm_sub_ps(_r, _mean0), _norm0));
+        _mm_storeu_ps(outptr1 + i, _mm_mul_ps(_mm_sub_ps(_g, _mean1), _norm1));
+        _mm_storeu_ps(outptr2 + i, _mm_mul_ps(_mm_sub_ps(_b, _mean2), _norm2));
+    }
+#endif
+    for (; i < w; i++)
+    {
+        float r = yrow[i] + 1.40625f * vrow[i];
+        float g = yrow[i] - 0.71875f * vrow[i] - 0.34375f * urow[i];
+        float b = yrow[i] + 1.765625f * urow[i];
+
+        r = std::min(std::max(r, 0.f), 255.f);
+        g = std::min(std::max(g, 0.f), 255.f);
+        b = std::min(std::max(b, 0.f), 255.f);
+
+        outptr0[i] = (r - mean[0]) * norm[0];
+        outptr1[i] = (g - mean[1]) * norm[1];
+        outptr2[i] = (b - mean[2]) * norm[2];
+    }
+}
+
+void fill_border(ncnn::Mat& out, int top, int bottom, int left, int right, float pad_value, const float* mean, const float* norm)
+{
+    const int outw = out.w;
+    const int outh = out.h;
+    const int w = outw - left - right;
+    const int h = outh - top - bottom;
+
+    for (int q = 0; q < 3; q++)
+    {
+        const float v = (pad_value - mean[q]) * norm[q];
+        float* ptr = out.channel(q);
+        for (int i = 0; i < outh; i++)
+        {
+            if (i < top || i >= top + h)
+            {
+                for (int j = 0; j < outw; j++)
+                    ptr[j] = v;
+            }
+            else
+            {
+                for (int j = 0; j < left; j++)
+                    ptr[j] = v;
+                for (int j = left + w; j < outw; j++)
+                    ptr[j] = v;
+            }
+            ptr += outw;
+        }
+    }
+}
+
+// out = p0 * (1 - alpha) + p1 * alpha with per element weights, the horizontal bilinear pass
+static void lerp_row(const float* p0, const float* p1, const float* alpha, int n, float* out)
+{
+    int i = 0;
+#if __ARM_NEON
+    float32x4_t _one = vdupq_n_f32(1.f);
+    for (; i + 3 < n; i += 4)
+    {
+        float32x4_t _a1 = vld1q_f32(alpha + i);
+        float32x4_t _a0 = vsubq_f32(_one, _a1);
+        vst1q_f32(out + i, vmlaq_f32(vmulq_f32(vld1q_f32(p0 + i), _a0), vld1q_f32(p1 + i), _a1));
+    }
+#elif __SSE2__
+    __m128 _one = _mm_set1_ps(1.f);
+    for (; i + 3 < n; i += 4)
+    {
+        __m128 _a1 = _mm_loadu_ps(alpha + i);
+        __m128 _a0 = _mm_sub_ps(_one, _a1);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(p0 + i), _a0), _mm_mul_ps(_mm_loadu_ps(p1 + i), _a1)));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        out[i] = p0[i] * (1.f - alpha[i]) + p1[i] * alpha[i];
+    }
+}
+
+// out = r0 * b0 + r1 * b1, the vertical bilinear pass
+static void lerp_rows(const float* r0, const float* r1, float b0, float b1, int n, float* out)
+{
+    int i = 0;
+#if __ARM_NEON
+    float32x4_t _b0 = vdupq_n_f32(b0);
+    float32x4_t _b1 = vdupq_n_f32(b1);
+    for (; i + 3 < n; i += 4)
+    {
+        vst1q_f32(out + i, vmlaq_f32(vmulq_f32(vld1q_f32(r0 + i), _b0), vld1q_f32(r1 + i), _b1));
+    }
+#elif __SSE2__
+    __m128 _b0 = _mm_set1_ps(b0);
+    __m128 _b1 = _mm_set1_ps(b1);
+    for (; i + 3 < n; i += 4)
+    {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(r0 + i), _b0), _mm_mul_ps(_mm_loadu_ps(r1 + i), _b1)));
+    }
+#endif
+    for (; i < n; i++)
+    {
+        out[i] = r0[i] * b0 + r1[i] * b1;
+    }
+}
+
+Nv21Resampler::Nv21Resampler()
+    : width(0), roi_w(0), roi_h(0), rotate_type(0), w(0), h(0)
+{
+}
+
+void Nv21Resampler::prepare(const Nv21Roi& roi, int _w, int _h)
+{
+    if (roi.width == width && roi.roi_w == roi_w && roi.roi_h == roi_h && roi.rotate_type == rotate_type && _w == w && _h == h)
+        return;
+
+    width = roi.width;
+    roi_w = roi.roi_w;
+    roi_h = roi.roi_h;
+    rotate_type = roi.rotate_type;
+    w = _w;
+    h = _h;
+
+    const int srcw = roi.upright_w();
+    const int srch = roi.upright_h();
+
+    // upright pixel to frame byte offset, for luma and for vu pairs, relative to the roi origin
+    int y_xstep;
+    resolve_rotate_steps(rotate_type, roi_w, roi_h, 1, width, y_base, y_xstep, y_ystep);
+    int vu_xstep;
+    resolve_rotate_steps(rotate_type, roi_w / 2, roi_h / 2, 2, width, vu_base, vu_xstep, vu_ystep);
+
+    std::vector<int> xofs(w);
+    alpha.resize(w);
+    resolve_bilinear(srcw, w, xofs.data(), alpha.data());
+
+    yofs.resize(h);
+    beta.resize(h);
+    resolve_bilinear(srch, h, yofs.data(), beta.data());
+
+    // per column luma offsets of both taps and the vu pair under each of them,
+    // so chroma is interpolated like the rgb of ncnn::yuv420sp2rgb followed by resize_bilinear
+    xofs_y0.resize(w);
+    xofs_y1.resize(w);
+    xofs_vu0.resize(w);
+    xofs_vu1.resize(w);
+    for (int j = 0; j < w; j++)
+    {
+        const int sx = xofs[j];
+        xofs_y0[j] = sx * y_xstep;
+        xofs_y1[j] = (sx + 1) * y_xstep;
+        xofs_vu0[j] = sx / 2 * vu_xstep;
+        xofs_vu1[j] = (sx + 1) / 2 * vu_xstep;
+    }
+
+    taps.resize(w * 4);
+    luma_rows.resize(w * 2);
+    chroma_rows.resize(w * 4);
+    rowbuf.resize(w * 3);
+}
+
+// slot of a two row cache holding row index, filled by the caller when index is not cached
+// rows are asked for in ascending order within a resample, so the lower cached row is the one to replace
+static int cache_slot(int* indices, int index, bool& cached)
+{
+    cached = true;
+    if (indices[0] == index)
+        return 0;
+    if (indices[1] == index)
+        return 1;
+
+    cached = false;
+    const int slot = indices[0] < indices[1] ? 0 : 1;
+    indices[slot] = index;
+    return slot;
+}
+
+const float* Nv21Resampler::luma_row(const unsigned char* y_origin, int sy)
+{
+    bool cached;
+    float* row = luma_rows.data() + cache_slot(luma_indices, sy, cached) * w;
+    if (cached)
+        return row;
+
+    const unsigned char* ptr = y_origin + y_base + sy * y_ystep;
+
+    // the taps are scattered for rotated rois, gather them, then blend the whole row
+    float* t0 = taps.data();
+    float* t1 = t0 + w;
+    for (int j = 0; j < w; j++)
+    {
+        t0[j] = ptr[xofs_y0[j]];
+        t1[j] = ptr[xofs_y1[j]];
+    }
+
+    lerp_row(t0, t1, alpha.data(), w, row);
+    return row;
+}
+
+const float* Nv21Resampler::chroma_row(const unsigned char* vu_origin, int sy)
+{
+    bool cached;
+    float* row = chroma_rows.data() + cache_slot(chroma_indices, sy / 2, cached) * w * 2;
+    if (cached)
+        return row;
+
+    const unsigned char* ptr = vu_origin + vu_base + sy / 2 * vu_ystep;
+
+    float* v0 = taps.data();
+    float* v1 = v0 + w;
+    float* u0 = v1 + w;
+    float* u1 = u0 + w;
+    for (int j = 0; j < w; j++)
+    {
+        const unsigned char* vu0 = ptr + xofs_vu0[j];
+        const unsigned char* vu1 = ptr + xofs_vu1[j];
+        v0[j] = vu0[0] - 128.f;
+        u0[j] = vu0[1] - 128.f;
+        v1[j] = vu1[0] - 128.f;
+        u1[j] = vu1[1] - 128.f;
+    }
+
+    lerp_row(v0, v1, alpha.data(), w, row);
+    lerp_row(u0, u1, alpha.data(), w, row + w);
+    return row;
+}
+
+void Nv21Resampler::resample(const Nv21Roi& roi, int _w, int _h, float* const* planes, int stride, const float* mean, const float* norm)
+{
+    prepare(roi, _w, _h);
+
+    const unsigned char* y_origin = roi.nv21 + roi.roi_y * roi.width + roi.roi_x;
+    const unsigned char* vu_origin = roi.nv21 + roi.width * roi.height + roi.roi_y / 2 * roi.width + roi.roi_x;
+
+    // horizontally resampled source rows of this frame, two rows of luma share one row of chroma
+    luma_indices[0] = luma_indices[1] = -1;
+    chroma_indices[0] = chroma_indices[1] = -1;
+
+    float* yrow = rowbuf.data();
+    float* vrow = yrow + w;
+    float* urow = vrow + w;
+
+    for (int i = 0; i < h; i++)
+    {
+        const int sy = yofs[i];
+        const float b0 = 1.f - beta[i];
+        const float b1 = beta[i];
+
+        const float* y0 = luma_row(y_origin, sy);
+        const float* y1 = luma_row(y_origin, sy + 1);
+        lerp_rows(y0, y1, b0, b1, w, yrow);
+
+        // v and u rows are adjacent in the cache and in rowbuf
+        const float* vu0 = chroma_row(vu_origin, sy);
+        const float* vu1 = chroma_row(vu_origin, sy + 1);
+        lerp_rows(vu0, vu1, b0, b1, w * 2, vrow);
+
+        yuv_row_to_planes(yrow, urow, vrow, w, mean, norm, planes[0] + i * stride, planes[1] + i * stride, planes[2] + i * stride);
+    }
+}
+
+void nv21_roi_to_tensor(Nv21Resampler& resampler, const Nv21Roi& roi, int type, int w, int h, int top, int bottom, int left, int right, float pad_value, const float* mean_vals, const float* norm_vals, ncnn::Mat& out, ncnn::Allocator* allocator)
+{
+    const int outw = w + left + right;
+    const int outh = h + top + bottom;
+    out.create(outw, outh, 3, 4u, allocator);
+    if (out.empty())
+        return;
+
+    const float zero_mean[3] = {0.f, 0.f, 0.f};
+    const float unit_norm[3] = {1.f, 1.f, 1.f};
+    const float* mean = mean_vals ? mean_vals : zero_mean;
+    const float* norm = norm_vals ? norm_vals : unit_norm;
+
+    // r g b plane order, swapped for bgr
+    const int swap_rb = type == ncnn::Mat::PIXEL_BGR;
+    float* planes[3] = {out.channel(swap_rb ? 2 : 0), out.channel(1), out.channel(swap_rb ? 0 : 2)};
+    const float plane_mean[3] = {mean[swap_rb ? 2 : 0], mean[1], mean[swap_rb ? 0 : 2]};
+    const float plane_norm[3] = {norm[swap_rb ? 2 : 0], norm[1], norm[swap_rb ? 0 : 2]};
+
+    // border
+    fill_border(out, top, bottom, left, right, pad_value, mean, norm);
+
+    for (int q = 0; q < 3; q++)
+    {
+        planes[q] += top * outw + left;
+    }
+
+    resampler.resample(roi, w, h, planes, outw, plane_mean, plane_norm);
+}
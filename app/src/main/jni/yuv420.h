@@ -0,0 +1,120 @@
+// Tencent is pleased to support the open source community by making ncnn available.
+//
+// Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+//
+// Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// https://opensource.org/licenses/BSD-3-Clause
+//
+// Unless required by applicable law or agreed to in writing, software distributed
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the
+// specific language governing permissions and limitations under the License.
+
+#ifndef YUV420_H
+#define YUV420_H
+
+#include <mat.h>
+
+// one plane of an android YUV_420_888 image
+struct Yuv420Plane
+{
+    const unsigned char* data;
+    int row_stride;
+    int pixel_stride;
+};
+
+// repack YUV_420_888 planes into a contiguous nv21 buffer of width * height * 3 / 2 bytes
+// row stride and pixel stride are honored for every plane, the common layouts
+// (packed y, interleaved vu / uv, planar u v) take a row copy or simd deinterleave path
+void yuv420_888_to_nv21(const Yuv420Plane& y, const Yuv420Plane& u, const Yuv420Plane& v, int width, int height, unsigned char* nv21);
+
+// region of a nv21 frame and the kanna rotate type that brings it upright
+struct Nv21Roi
+{
+    const unsigned char* nv21;
+    int width;
+    int height;
+
+    // in frame coordinates, even aligned
+    int roi_x;
+    int roi_y;
+    int roi_w;
+    int roi_h;
+
+    // 1~8, same as ncnn::kanna_rotate_c1
+    int rotate_type;
+
+    int upright_w() const { return rotate_type >= 5 ? roi_h : roi_w; }
+    int upright_h() const { return rotate_type >= 5 ? roi_w : roi_h; }
+};
+
+// nv21 to rgba with alpha 255, same integer coefficients as ncnn::yuv420sp2rgb
+// the planes may be a region of a larger frame and rgba a locked window buffer, w and h even
+void nv21_to_rgba(const unsigned char* y, int y_stride, const unsigned char* vu, int vu_stride, int w, int h, unsigned char* rgba, int rgba_stride);
+
+// the centered 1 / zoom part of roi, even aligned, zoom <= 1 returns roi
+Nv21Roi nv21_roi_zoom(const Nv21Roi& roi, float zoom);
+
+// copy the roi out as a compact roi_w x roi_h nv21 image, rotation is not applied
+void nv21_roi_crop(const Nv21Roi& roi, unsigned char* dst);
+
+// set the top, bottom, left and right margins of a planar 3 channel mat to (pad_value - mean) * norm
+// mean and norm are per channel and must not be null
+void fill_border(ncnn::Mat& out, int top, int bottom, int left, int right, float pad_value, const float* mean, const float* norm);
+
+// bilinear resample of a roi into upright float planes, luma and chroma alike
+// the per row and per column taps are kept until the frame stride, roi size, rotation or output size changes
+// each source row is gathered and horizontally blended once, the blends and the color conversion are simd
+class Nv21Resampler
+{
+public:
+    Nv21Resampler();
+
+    // planes and the per plane mean / norm in output order, values are (c - mean) * norm with c in 0~255
+    // each plane is w x h with a row stride of stride floats
+    void resample(const Nv21Roi& roi, int w, int h, float* const* planes, int stride, const float* mean, const float* norm);
+
+private:
+    void prepare(const Nv21Roi& roi, int w, int h);
+    // upright source row sy resampled to the w output columns, luma, or v - 128 then u - 128
+    // cached until two other rows are asked for, within one resample
+    const float* luma_row(const unsigned char* y_origin, int sy);
+    const float* chroma_row(const unsigned char* vu_origin, int sy);
+
+private:
+    int width;
+    int roi_w;
+    int roi_h;
+    int rotate_type;
+    int w;
+    int h;
+
+    int y_base;
+    int y_ystep;
+    int vu_base;
+    int vu_ystep;
+    std::vector<int> xofs_y0;
+    std::vector<int> xofs_y1;
+    std::vector<int> xofs_vu0;
+    std::vector<int> xofs_vu1;
+    std::vector<float> alpha;
+    std::vector<int> yofs;
+    std::vector<float> beta;
+
+    std::vector<float> taps;
+    std::vector<float> luma_rows;
+    std::vector<float> chroma_rows;
+    int luma_indices[2];
+    int chroma_indices[2];
+    std::vector<float> rowbuf;
+};
+
+// crop, rotate upright, convert to rgb or bgr (type is ncnn::Mat::PIXEL_RGB or PIXEL_BGR),
+// bilinear resize to w x h, pad with pad_value and normalize into a planar 3 channel mat, in one pass
+// mean_vals and norm_vals may be null, same as ncnn::Mat::substract_mean_normalize
+// resampler keeps its tables across calls, out is allocated from allocator, the default one when null
+void nv21_roi_to_tensor(Nv21Resampler& resampler, const Nv21Roi& roi, int type, int w, int h, int top, int bottom, int left, int right, float pad_value, const float* mean_vals, const float* norm_vals, ncnn::Mat& out, ncnn::Allocator* allocator = 0);
+
+#endif // YUV420_H
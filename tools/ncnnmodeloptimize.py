@@ -0,0 +1,499 @@
+#!/usr/bin/env python3
+# Tencent is pleased to support the open source community by making ncnn available.
+#
+# Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+#
+# Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+# in compliance with the License. You may obtain a copy of the License at
+#
+# https://opensource.org/licenses/BSD-3-Clause
+#
+# Unless required by applicable law or agreed to in writing, software distributed
+# under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied. See the License for the
+# specific language governing permissions and limitations under the License.
+
+# offline graph optimization of an ncnn model converted from onnx, writing the optimized model
+# and a layer by layer diff against the original
+#
+# usage: ncnnmodeloptimize.py [--fp32] [--keep=blob,...] model.param model.bin opt.param opt.bin opt.diff
+#
+#  - with --keep, the layers feeding none of the listed blobs are cut out of the graph
+#  - BatchNorm after Convolution / Deconvolution / InnerProduct is folded into the weights
+#  - ReLU / Clip / Sigmoid / Mish / HardSwish after them becomes the fused activation
+#  - both also go through a channel Concat of such layers, into each layer's slice of the channels
+#  - the yolor implicit layers of the yolopv2 heads are folded into the head convolutions,
+#    MemoryData + BinaryOp Add in front of a convolution without padding into its bias,
+#    MemoryData + BinaryOp Mul after it into its weights and bias
+#  - convolution weights are stored as fp16 unless --fp32
+#
+# Swish stays a layer of its own, ncnn has no fused swish activation
+# the names of the blobs kept are unchanged, so the outputs are extracted the same way
+
+import math
+import os
+import struct
+import sys
+from array import array
+
+MAGIC = 7767517
+
+TAG_FP16 = 0x01306B47
+TAG_INT8 = 0x000D4B38
+TAG_FP32 = 0x0002C056
+
+WEIGHTED = ("Convolution", "Deconvolution", "InnerProduct")
+
+WEIGHTLESS = (
+    "BinaryOp", "Clip", "Concat", "Crop", "Dropout", "Eltwise", "Flatten", "HardSigmoid", "HardSwish",
+    "Input", "Interp", "Mish", "Noop", "Permute", "Pooling", "ReLU", "Reshape", "Sigmoid", "Slice",
+    "Softmax", "Split", "Swish", "TanH", "UnaryOp",
+)
+
+
+class Layer(object):
+    def __init__(self, type, name, bottoms, tops, params):
+        self.type = type
+        self.name = name
+        self.bottoms = bottoms
+        self.tops = tops
+        self.params = params  # id -> value string, in file order
+        self.weights = []     # arrays of float32 in load order
+        self.notes = []
+
+    def get_int(self, pid, default=0):
+        return int(self.params[pid]) if pid in self.params else default
+
+    def get_float(self, pid, default=0.0):
+        return float(self.params[pid]) if pid in self.params else default
+
+    def set(self, pid, value):
+        self.params[pid] = value
+
+
+class Reader(object):
+    def __init__(self, data):
+        self.data = data
+        self.offset = 0
+
+    def raw(self, count):
+        # ModelBin type 1, float32 without a flag
+        values = array("f")
+        values.frombytes(self.data[self.offset:self.offset + count * 4])
+        self.offset += count * 4
+        if len(values) != count:
+            raise ValueError("model bin ends early")
+        if sys.byteorder != "little":
+            values.byteswap()
+        return values
+
+    def tagged(self, count):
+        # ModelBin type 0, a 4 byte flag picks the storage
+        flag = self.data[self.offset:self.offset + 4]
+        tag = struct.unpack("<I", flag)[0]
+        self.offset += 4
+
+        if tag == TAG_FP16:
+            halves = struct.unpack_from("<%de" % count, self.data, self.offset)
+            self.offset += (count * 2 + 3) // 4 * 4
+            return array("f", halves)
+
+        if tag == TAG_INT8:
+            raise ValueError("int8 weights are not supported")
+
+        if tag == TAG_FP32 or flag == b"\0\0\0\0":
+            return self.raw(count)
+
+        # 256 entry table of quantized values
+        table = self.raw(256)
+        indices = self.data[self.offset:self.offset + count]
+        self.offset += (count + 3) // 4 * 4
+        return array("f", [table[i] for i in indices])
+
+
+def read_param(path):
+    with open(path) as f:
+        lines = [line.split() for line in f if line.strip()]
+
+    if int(lines[0][0]) != MAGIC:
+        raise ValueError("%s: not an ncnn param file" % path)
+
+    layer_count = int(lines[1][0])
+    layers = []
+    for tokens in lines[2:2 + layer_count]:
+        bottom_count, top_count = int(tokens[2]), int(tokens[3])
+        bottoms = tokens[4:4 + bottom_count]
+        tops = tokens[4 + bottom_count:4 + bottom_count + top_count]
+        params = {}
+        for param in tokens[4 + bottom_count + top_count:]:
+            key, _, value = param.partition("=")
+            params[int(key)] = value
+        layers.append(Layer(tokens[0], tokens[1], bottoms, tops, params))
+    return layers
+
+
+def read_weights(layers, path):
+    with open(path, "rb") as f:
+        reader = Reader(f.read())
+
+    for layer in layers:
+        if layer.type in WEIGHTED:
+            if layer.get_int(8) != 0:
+                raise ValueError("%s: int8 layers are not supported" % layer.name)
+            layer.weights.append(reader.tagged(layer.get_int(6)))
+            if layer.get_int(5):
+                layer.weights.append(reader.raw(layer.get_int(0)))
+        elif layer.type == "BatchNorm":
+            for _ in range(4):
+                layer.weights.append(reader.raw(layer.get_int(0)))
+        elif layer.type == "MemoryData":
+            count = 1
+            for pid in (0, 1, 11, 2):
+                count *= max(layer.get_int(pid), 1)
+            layer.weights.append(reader.raw(count))
+        elif layer.type not in WEIGHTLESS:
+            raise ValueError("%s: layer type %s is not supported" % (layer.name, layer.type))
+
+    if reader.offset != len(reader.data):
+        raise ValueError("%s: %d bytes left after the last layer" % (path, len(reader.data) - reader.offset))
+
+
+class Graph(object):
+    def __init__(self, layers):
+        self.layers = layers
+
+    def producer(self, blob):
+        for layer in self.layers:
+            if blob in layer.tops:
+                return layer
+        return None
+
+    def consumers(self, blob):
+        return [layer for layer in self.layers if blob in layer.bottoms]
+
+    def only_consumer(self, blob):
+        consumers = self.consumers(blob)
+        return consumers[0] if len(consumers) == 1 else None
+
+    def remove(self, layer, reason):
+        self.layers.remove(layer)
+        layer.notes.append(reason)
+
+
+def prune_unused(graph, outputs):
+    needed = set(outputs)
+    missing = needed - set(b for layer in graph.layers for b in layer.tops)
+    if missing:
+        raise ValueError("no layer produces %s" % ", ".join(sorted(missing)))
+
+    for layer in reversed(list(graph.layers)):
+        if any(top in needed for top in layer.tops):
+            needed.update(layer.bottoms)
+        else:
+            graph.remove(layer, "feeds none of %s" % ",".join(outputs))
+
+    # split outputs left without a consumer, and splits left with one output
+    for split in list(graph.layers):
+        if split.type != "Split":
+            continue
+
+        tops = [top for top in split.tops if top in outputs or graph.consumers(top)]
+        if len(tops) == len(split.tops):
+            continue
+
+        if len(tops) == 1 and tops[0] not in outputs:
+            for consumer in graph.consumers(tops[0]):
+                consumer.bottoms[consumer.bottoms.index(tops[0])] = split.bottoms[0]
+            graph.remove(split, "one output left")
+        else:
+            split.notes.append("%d -> %d outputs" % (len(split.tops), len(tops)))
+            split.tops = tops
+
+
+def bias_of(layer):
+    # a zero bias is added where the fold needs one
+    if not layer.get_int(5):
+        layer.set(5, "1")
+        layer.weights.append(array("f", [0.0] * layer.get_int(0)))
+        layer.notes.append("5=1")
+    return layer.weights[1]
+
+
+def channel_constant(graph, blob, channels):
+    # per channel MemoryData feeding only this blob's one consumer
+    layer = graph.producer(blob)
+    if layer is None or layer.type != "MemoryData" or len(graph.consumers(blob)) != 1:
+        return None
+    if layer.get_int(0) != 1 or layer.get_int(1) != 1 or layer.get_int(11) != 0 or layer.get_int(2) != channels:
+        return None
+    return layer
+
+
+def fold_implicit_add(graph):
+    # conv(x + a) = conv(x) + W a while nothing is padded with zeros
+    for op in list(graph.layers):
+        if op.type != "BinaryOp" or op.get_int(0) != 0 or op.get_int(1) != 0 or len(op.bottoms) != 2:
+            continue
+
+        conv = graph.only_consumer(op.tops[0])
+        if conv is None or conv.type != "Convolution":
+            continue
+        pad = conv.get_int(4)
+        if any(conv.get_int(pid, pad) != 0 for pid in (4, 14, 15, 16)):
+            continue
+
+        num_output = conv.get_int(0)
+        kernel = conv.get_int(1) * conv.get_int(11, conv.get_int(1))
+        num_input = conv.get_int(6) // num_output // kernel
+
+        for i in range(2):
+            mem = channel_constant(graph, op.bottoms[i], num_input)
+            if mem is not None:
+                break
+        else:
+            continue
+
+        a = mem.weights[0]
+        weight = conv.weights[0]
+        bias = bias_of(conv)
+        for o in range(num_output):
+            acc = 0.0
+            base = o * num_input * kernel
+            for c in range(num_input):
+                row = base + c * kernel
+                acc += a[c] * sum(weight[row:row + kernel])
+            bias[o] += acc
+
+        conv.bottoms[conv.bottoms.index(op.tops[0])] = op.bottoms[1 - i]
+        conv.notes.append("bias += W * %s" % mem.name)
+        graph.remove(op, "folded into %s bias" % conv.name)
+        graph.remove(mem, "folded into %s bias" % conv.name)
+
+
+def fold_implicit_mul(graph):
+    # m * (W x + b) = (m W) x + m b
+    for op in list(graph.layers):
+        if op.type != "BinaryOp" or op.get_int(0) != 2 or op.get_int(1) != 0 or len(op.bottoms) != 2:
+            continue
+
+        for i in range(2):
+            conv = graph.producer(op.bottoms[1 - i])
+            if conv is None or conv.type != "Convolution" or conv.get_int(9) != 0:
+                continue
+            if graph.only_consumer(conv.tops[0]) is not op:
+                continue
+            mem = channel_constant(graph, op.bottoms[i], conv.get_int(0))
+            if mem is not None:
+                break
+        else:
+            continue
+
+        m = mem.weights[0]
+        num_output = conv.get_int(0)
+        weight = conv.weights[0]
+        per_output = len(weight) // num_output
+        for o in range(num_output):
+            for k in range(o * per_output, (o + 1) * per_output):
+                weight[k] *= m[o]
+        if conv.get_int(5):
+            bias = conv.weights[1]
+            for o in range(num_output):
+                bias[o] *= m[o]
+
+        conv.tops[0] = op.tops[0]
+        conv.notes.append("W, b *= %s" % mem.name)
+        graph.remove(op, "folded into %s weights" % conv.name)
+        graph.remove(mem, "folded into %s weights" % conv.name)
+
+
+def fusable_producers(graph, blob):
+    # the weighted layers whose outputs make up blob, with their first channel in it
+    # either one layer or a channel Concat of layers, each with no activation yet and no other consumer
+    layer = graph.producer(blob)
+    if layer is None:
+        return None
+
+    if layer.type == "Concat":
+        if layer.get_int(0) != 0:
+            return None
+        parts = [graph.producer(b) for b in layer.bottoms]
+        if any(p is None or p.type not in ("Convolution", "Deconvolution") for p in parts):
+            return None
+        if any(graph.only_consumer(p.tops[0]) is not layer for p in parts):
+            return None
+    else:
+        parts = [layer]
+
+    producers = []
+    first = 0
+    for part in parts:
+        if part.type not in WEIGHTED or part.get_int(9) != 0 or graph.only_consumer(part.tops[0]) is None:
+            return None
+        producers.append((part, first))
+        first += part.get_int(0)
+    return producers
+
+
+def pass_through(graph, layer, blob, producers, note):
+    # the layer's output now comes out of the producers, or out of their Concat
+    top = graph.producer(blob)
+    top.tops[0] = layer.tops[0]
+    for part, _ in producers:
+        part.notes.append(note)
+    graph.remove(layer, "fused into %s" % ", ".join(part.name for part, _ in producers))
+
+
+def fuse_batchnorm(graph):
+    for bn in list(graph.layers):
+        if bn.type != "BatchNorm":
+            continue
+
+        producers = fusable_producers(graph, bn.bottoms[0])
+        if producers is None or graph.only_consumer(bn.bottoms[0]) is not bn:
+            continue
+
+        slope, mean, var, beta = bn.weights
+        eps = bn.get_float(1)
+        for layer, first in producers:
+            num_output = layer.get_int(0)
+            weight = layer.weights[0]
+            bias = bias_of(layer)
+            per_output = len(weight) // num_output
+            for o in range(num_output):
+                c = first + o
+                scale = slope[c] / math.sqrt(var[c] + eps)
+                for k in range(o * per_output, (o + 1) * per_output):
+                    weight[k] *= scale
+                bias[o] = (bias[o] - mean[c]) * scale + beta[c]
+
+        pass_through(graph, bn, bn.bottoms[0], producers, "W, b fused %s" % bn.name)
+
+
+def activation_of(layer):
+    # activation_type and activation_params of the fused form, None when there is none
+    if layer.type == "ReLU":
+        slope = layer.get_float(0)
+        return (1, []) if slope == 0 else (2, [slope])
+    if layer.type == "Clip":
+        return 3, [layer.get_float(0, -3.402823466e+38), layer.get_float(1, 3.402823466e+38)]
+    if layer.type == "Sigmoid":
+        return 4, []
+    if layer.type == "Mish":
+        return 5, []
+    if layer.type == "HardSwish":
+        return 6, [layer.get_float(0, 0.2), layer.get_float(1, 0.5)]
+    return None
+
+
+def fuse_activation(graph):
+    for act in list(graph.layers):
+        fused = activation_of(act)
+        if fused is None:
+            continue
+
+        producers = fusable_producers(graph, act.bottoms[0])
+        if producers is None or graph.only_consumer(act.bottoms[0]) is not act:
+            continue
+
+        activation_type, activation_params = fused
+        note = "9=%d" % activation_type
+        if activation_params:
+            value = ",".join([str(len(activation_params))] + ["%e" % v for v in activation_params])
+            note += " 10=" + value
+        for layer, _ in producers:
+            layer.set(9, str(activation_type))
+            if activation_params:
+                layer.set(-23310, value)
+
+        pass_through(graph, act, act.bottoms[0], producers, note)
+
+
+def pack_raw(values):
+    return struct.pack("<%df" % len(values), *values)
+
+
+def pack_tagged(values, fp16):
+    if not fp16:
+        return struct.pack("<I", 0) + pack_raw(values)
+
+    try:
+        data = struct.pack("<%de" % len(values), *values)
+    except OverflowError:
+        clamped = [max(min(v, 65504.0), -65504.0) for v in values]
+        data = struct.pack("<%de" % len(clamped), *clamped)
+    return struct.pack("<I", TAG_FP16) + data + b"\0" * (-len(data) % 4)
+
+
+def write_model(layers, param_path, bin_path, fp16):
+    blobs = []
+    seen = set()
+    for layer in layers:
+        for blob in layer.bottoms + layer.tops:
+            if blob not in seen:
+                seen.add(blob)
+                blobs.append(blob)
+
+    with open(param_path, "w") as f:
+        f.write("%d\n%d %d\n" % (MAGIC, len(layers), len(blobs)))
+        for layer in layers:
+            fields = ["%-24s %-24s %d %d" % (layer.type, layer.name, len(layer.bottoms), len(layer.tops))]
+            fields += layer.bottoms + layer.tops
+            fields += ["%d=%s" % (pid, value) for pid, value in layer.params.items()]
+            f.write(" ".join(fields) + "\n")
+
+    size = 0
+    with open(bin_path, "wb") as f:
+        for layer in layers:
+            for i, values in enumerate(layer.weights):
+                if layer.type in WEIGHTED and i == 0:
+                    data = pack_tagged(values, fp16)
+                    if fp16:
+                        layer.notes.append("fp16 weights")
+                else:
+                    data = pack_raw(values)
+                f.write(data)
+                size += len(data)
+    return len(blobs), size
+
+
+def main(argv):
+    args = [a for a in argv[1:] if not a.startswith("--")]
+    fp16 = "--fp32" not in argv
+    keep = [a[len("--keep="):] for a in argv[1:] if a.startswith("--keep=")]
+    outputs = keep[0].split(",") if keep and keep[0] else []
+    if len(args) != 5:
+        sys.stderr.write("usage: ncnnmodeloptimize.py [--fp32] [--keep=blob,...] model.param model.bin opt.param opt.bin opt.diff\n")
+        return 1
+
+    param_path, bin_path, opt_param_path, opt_bin_path, diff_path = args
+
+    layers = read_param(param_path)
+    read_weights(layers, bin_path)
+    original = list(layers)
+    blob_count = len(set(b for layer in layers for b in layer.bottoms + layer.tops))
+
+    graph = Graph(layers)
+    if outputs:
+        prune_unused(graph, outputs)
+    fold_implicit_add(graph)
+    fold_implicit_mul(graph)
+    fuse_batchnorm(graph)
+    fuse_activation(graph)
+
+    opt_blob_count, opt_size = write_model(graph.layers, opt_param_path, opt_bin_path, fp16)
+
+    kept = set(id(layer) for layer in graph.layers)
+    with open(diff_path, "w") as f:
+        f.write("# %s -> %s\n" % (param_path, opt_param_path))
+        f.write("# layers %d -> %d  blobs %d -> %d  weights %d -> %d bytes\n"
+                % (len(original), len(graph.layers), blob_count, opt_blob_count, os.path.getsize(bin_path), opt_size))
+        for layer in original:
+            if not layer.notes:
+                continue
+            mark = "~" if id(layer) in kept else "-"
+            f.write("%s %-16s %-32s %s\n" % (mark, layer.type, layer.name, ", ".join(layer.notes)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
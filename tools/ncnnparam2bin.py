@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+# Tencent is pleased to support the open source community by making ncnn available.
+#
+# Copyright (C) 2021 THL A29 Limited, a Tencent company. All rights reserved.
+#
+# Licensed under the BSD 3-Clause License (the "License"); you may not use this file except
+# in compliance with the License. You may obtain a copy of the License at
+#
+# https://opensource.org/licenses/BSD-3-Clause
+#
+# Unless required by applicable law or agreed to in writing, software distributed
+# under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+# CONDITIONS OF ANY KIND, either express or implied. See the License for the
+# specific language governing permissions and limitations under the License.
+
+# text .param -> binary .param.bin for Net::load_param_bin, plus a header of blob indices
+# the same output as ncnn's ncnn2mem, without building ncnn's tools for the host
+#
+# usage: ncnnparam2bin.py layer_type_enum.h model.param model.param.bin model.id.h
+#
+# layer type indices are taken from the layer_type_enum.h of the ncnn the app links,
+# blob indices follow Net::load_param, so they also hold for the text param
+
+import re
+import struct
+import sys
+
+MAGIC = 7767517
+END_OF_PARAMS = -233
+ARRAY_ID_BASE = -23300
+
+
+def read_layer_types(path):
+    types = {}
+    with open(path) as f:
+        for line in f:
+            m = re.match(r"\s*(\w+)\s*=\s*(\d+)\s*,", line)
+            if m:
+                types[m.group(1)] = int(m.group(2))
+    return types
+
+
+def is_float(vstr):
+    # the look ahead of ParamDict::load_param
+    return "." in vstr or "e" in vstr.lower()
+
+
+def pack_value(vstr):
+    if is_float(vstr):
+        return struct.pack("<f", float(vstr))
+    return struct.pack("<i", int(vstr))
+
+
+def sanitize(name):
+    return re.sub(r"[^0-9A-Za-z]", "_", name)
+
+
+def convert(types, param_path):
+    with open(param_path) as f:
+        tokens_per_line = [line.split() for line in f if line.strip()]
+
+    if int(tokens_per_line[0][0]) != MAGIC:
+        raise ValueError("%s: not an ncnn param file" % param_path)
+
+    layer_count, blob_count = int(tokens_per_line[1][0]), int(tokens_per_line[1][1])
+
+    blob_index = {}
+    blob_names = []
+    out = bytearray(struct.pack("<iii", MAGIC, layer_count, blob_count))
+
+    for tokens in tokens_per_line[2:2 + layer_count]:
+        layer_type, layer_name = tokens[0], tokens[1]
+        bottom_count, top_count = int(tokens[2]), int(tokens[3])
+        bottoms = tokens[4:4 + bottom_count]
+        tops = tokens[4 + bottom_count:4 + bottom_count + top_count]
+        params = tokens[4 + bottom_count + top_count:]
+
+        if layer_type not in types:
+            raise ValueError("%s: layer %s has type %s unknown to this ncnn" % (param_path, layer_name, layer_type))
+
+        out += struct.pack("<iii", types[layer_type], bottom_count, top_count)
+
+        for name in bottoms:
+            if name not in blob_index:
+                # Net::load_param creates a blob for a bottom nobody produced
+                blob_index[name] = len(blob_names)
+                blob_names.append(name)
+            out += struct.pack("<i", blob_index[name])
+
+        for name in tops:
+            blob_index[name] = len(blob_names)
+            blob_names.append(name)
+            out += struct.pack("<i", blob_index[name])
+
+        for param in params:
+            key, _, value = param.partition("=")
+            pid = int(key)
+            out += struct.pack("<i", pid)
+            if pid <= ARRAY_ID_BASE:
+                values = value.split(",")
+                count = int(values[0])
+                out += struct.pack("<i", count)
+                for v in values[1:1 + count]:
+                    out += pack_value(v)
+            else:
+                out += pack_value(value)
+
+        out += struct.pack("<i", END_OF_PARAMS)
+
+    return bytes(out), blob_names
+
+
+def write_header(path, model, blob_names):
+    guard = "NCNN_INCLUDE_GUARD_%s_id_h" % sanitize(model)
+    used = set()
+    lines = []
+    for i, name in enumerate(blob_names):
+        ident = "BLOB_" + sanitize(name)
+        if ident in used:
+            ident += "_%d" % i
+        used.add(ident)
+        lines.append("const int %s = %d;" % (ident, i))
+
+    with open(path, "w") as f:
+        f.write("// generated by tools/ncnnparam2bin.py from %s.param, do not edit\n" % model)
+        f.write("#ifndef %s\n#define %s\n" % (guard, guard))
+        f.write("namespace %s_param_id {\n" % sanitize(model))
+        f.write("\n".join(lines))
+        f.write("\n} // namespace %s_param_id\n" % sanitize(model))
+        f.write("#endif // %s\n" % guard)
+
+
+def main(argv):
+    if len(argv) != 5:
+        sys.stderr.write("usage: ncnnparam2bin.py layer_type_enum.h model.param model.param.bin model.id.h\n")
+        return 1
+
+    enum_path, param_path, bin_path, header_path = argv[1:]
+    types = read_layer_types(enum_path)
+    data, blob_names = convert(types, param_path)
+
+    with open(bin_path, "wb") as f:
+        f.write(data)
+
+    model = re.sub(r"\.param$", "", param_path.replace("\\", "/").split("/")[-1])
+    write_header(header_path, model, blob_names)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))